@@ -24,7 +24,27 @@
 
 #include "juce_libsamplerate.h"
 
+#include <complex>
+
 //==============================================================================
+#include "src_wrappers/SRCArena.cpp"
+#include "src_wrappers/SRCTrace.cpp"
 #include "src_wrappers/libsamplerate_SRC.cpp"
+#include "src_wrappers/SRCFastInterpolator.cpp"
+#include "src_wrappers/SRCSincConverter.cpp"
+#include "src_wrappers/SRCMultistageConverter.cpp"
+#include "src_wrappers/SRCChannelWorkerPool.cpp"
 #include "src_wrappers/SRCAudioSource.cpp"
+#include "src_wrappers/SRCLoopRegionSource.cpp"
+#include "src_wrappers/SRCReadAheadSource.cpp"
+#include "src_wrappers/SRCReadAheadScheduler.cpp"
 #include "src_wrappers/SRCAudioTransportSource.cpp"
+#include "src_wrappers/SRCResampledAssetCache.cpp"
+#include "src_wrappers/SRCSampler.cpp"
+#include "src_wrappers/SRCMultiStreamConverter.cpp"
+#include "src_wrappers/SRCPlaylistSource.cpp"
+#include "src_wrappers/SRCMultiRateMixerSource.cpp"
+#include "src_wrappers/SRCFanOutSource.cpp"
+#include "src_wrappers/SRCResamplingWriter.cpp"
+#include "src_wrappers/SRCWaveformPyramid.cpp"
+#include "src_wrappers/SRCDeviceRateAdapter.cpp"
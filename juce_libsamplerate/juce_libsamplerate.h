@@ -30,8 +30,45 @@
 
 #define JUCE_LIBSAMPLERATE_H_INCLUDED
 
+//==============================================================================
+/** Config: JUCE_LIBSAMPLERATE_TRACING
+    Records SRCTrace spans around every conversion call, into a lock-free ring per
+    thread, which SRCTrace::Exporter can write as Chrome trace JSON. When disabled,
+    the trace macros compile to nothing.
+*/
+#ifndef JUCE_LIBSAMPLERATE_TRACING
+ #define JUCE_LIBSAMPLERATE_TRACING 0
+#endif
+
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_events/juce_events.h>
+
+#if JUCE_MODULE_AVAILABLE_juce_audio_formats
+ #include <juce_audio_formats/juce_audio_formats.h>
+#endif
+
+#if JUCE_MODULE_AVAILABLE_juce_audio_devices
+ #include <juce_audio_devices/juce_audio_devices.h>
+#endif
+
+#include "src_wrappers/SRCArena.h"
+#include "src_wrappers/SRCTrace.h"
 #include "src_wrappers/libsamplerate_SRC.h"
+#include "src_wrappers/SRCFastInterpolator.h"
+#include "src_wrappers/SRCSincConverter.h"
+#include "src_wrappers/SRCMultistageConverter.h"
+#include "src_wrappers/SRCChannelWorkerPool.h"
 #include "src_wrappers/SRCAudioSource.h"
+#include "src_wrappers/SRCLoopRegionSource.h"
+#include "src_wrappers/SRCReadAheadSource.h"
+#include "src_wrappers/SRCReadAheadScheduler.h"
 #include "src_wrappers/SRCAudioTransportSource.h"
+#include "src_wrappers/SRCResampledAssetCache.h"
+#include "src_wrappers/SRCSampler.h"
+#include "src_wrappers/SRCMultiStreamConverter.h"
+#include "src_wrappers/SRCPlaylistSource.h"
+#include "src_wrappers/SRCMultiRateMixerSource.h"
+#include "src_wrappers/SRCFanOutSource.h"
+#include "src_wrappers/SRCResamplingWriter.h"
+#include "src_wrappers/SRCWaveformPyramid.h"
+#include "src_wrappers/SRCDeviceRateAdapter.h"
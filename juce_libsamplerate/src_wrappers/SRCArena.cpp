@@ -0,0 +1,114 @@
+/*
+ ==============================================================================
+ Copyright (c) 2019, Tal Aviram
+ All rights reserved.
+
+ This code is released under 2-clause BSD license. Please see the
+ file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#include "SRCArena.h"
+
+namespace juce
+{
+
+namespace SRCArenaHelpers
+{
+    static thread_local SRCArena::ScopedAllocationHook* activeHook = nullptr;
+
+    static char* alignUp (char* pointer) noexcept
+    {
+        const auto address = (pointer_sized_uint) pointer;
+        return pointer + ((SRCArena::alignment - (address % SRCArena::alignment)) % SRCArena::alignment);
+    }
+}
+
+//==============================================================================
+SRCArena::SRCArena (void* const memoryToUse, const size_t sizeInBytes) noexcept
+{
+    jassert (memoryToUse != nullptr || sizeInBytes == 0);
+
+    auto* block = static_cast<char*> (memoryToUse);
+    start = SRCArenaHelpers::alignUp (block);
+    size = sizeInBytes > (size_t) (start - block) ? sizeInBytes - (size_t) (start - block) : 0;
+}
+
+SRCArena::SRCArena (const size_t sizeInBytes)
+    : ownedMemory (sizeInBytes + alignment - 1)
+{
+    start = SRCArenaHelpers::alignUp (ownedMemory.get());
+    size = sizeInBytes;
+}
+
+SRCArena::~SRCArena()
+{
+}
+
+size_t SRCArena::getAlignedSize (const size_t numBytes) noexcept
+{
+    return (numBytes + alignment - 1) / alignment * alignment;
+}
+
+void* SRCArena::allocate (const size_t numBytes) noexcept
+{
+    const auto alignedSize = getAlignedSize (numBytes);
+
+    if (alignedSize > size - used)
+    {
+        // use getRequiredArenaSize() to find how much space is needed
+        jassertfalse;
+        return nullptr;
+    }
+
+    auto* block = start + used;
+    used += alignedSize;
+    zeromem (block, alignedSize);
+    return block;
+}
+
+bool SRCArena::contains (const void* const pointer) const noexcept
+{
+    const auto* p = static_cast<const char*> (pointer);
+    return p >= start && p < start + size;
+}
+
+//==============================================================================
+SRCArena::ScopedAllocationHook::ScopedAllocationHook (SRCArena* const arenaToUse) noexcept
+    : arena (arenaToUse), previous (SRCArenaHelpers::activeHook)
+{
+    SRCArenaHelpers::activeHook = this;
+}
+
+SRCArena::ScopedAllocationHook::~ScopedAllocationHook()
+{
+    jassert (SRCArenaHelpers::activeHook == this);
+    SRCArenaHelpers::activeHook = previous;
+}
+
+void* SRCArena::callocHook (const size_t numElements, const size_t elementSize) noexcept
+{
+    auto* hook = SRCArenaHelpers::activeHook;
+
+    if (hook == nullptr)
+        return std::calloc (numElements, elementSize);
+
+    const auto numBytes = numElements * elementSize;
+    hook->bytesRequested += getAlignedSize (numBytes);
+
+    return hook->arena != nullptr ? hook->arena->allocate (numBytes)
+                                  : std::calloc (numElements, elementSize);
+}
+
+void SRCArena::freeHook (void* const pointer) noexcept
+{
+    auto* hook = SRCArenaHelpers::activeHook;
+
+    // arena memory is only ever released with the arena itself
+    if (hook != nullptr && hook->arena != nullptr && hook->arena->contains (pointer))
+        return;
+
+    std::free (pointer);
+}
+
+} // namespace juce
@@ -0,0 +1,111 @@
+/*
+ ==============================================================================
+    Copyright (c) 2019, Tal Aviram
+    All rights reserved.
+
+    This code is released under 2-clause BSD license. Please see the
+    file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#pragma once
+
+namespace juce
+{
+
+//==============================================================================
+/**
+ A block of memory that converter state is placed into, front to back.
+
+ Every allocation is zeroed and starts on a cache line, and nothing is freed on its own:
+ the whole arena is released (or reset) once nothing uses it any more. The memory can be
+ owned by the arena or be a block the caller set aside, e.g. when the app starts.
+
+ libsamplerate allocates its converter state with calloc(). While a ScopedAllocationHook
+ is active on a thread, those allocations are taken from an arena instead, so the state
+ of a converter ends up next to the buffers that feed it.
+
+ @see SRCAudioSource::getRequiredArenaSize
+
+ @tags{Audio}
+ */
+class SRCArena
+{
+public:
+    enum { alignment = 64 };
+
+    //==============================================================================
+    /** Creates an arena that uses a block owned by the caller.
+        The block must outlive the arena and everything placed in it.
+     */
+    SRCArena (void* memoryToUse, size_t sizeInBytes) noexcept;
+
+    /** Creates an arena that allocates and owns a block of the given size. */
+    explicit SRCArena (size_t sizeInBytes);
+
+    /** Destructor. */
+    ~SRCArena();
+
+    //==============================================================================
+    /** Returns a zeroed, cache-line aligned block, or nullptr if the arena is full. */
+    void* allocate (size_t numBytes) noexcept;
+
+    /** Returns a zeroed, cache-line aligned array, or nullptr if the arena is full. */
+    template <typename Type>
+    Type* allocateArray (size_t numElements) noexcept    { return static_cast<Type*> (allocate (sizeof (Type) * numElements)); }
+
+    /** Forgets every allocation. Nothing that was placed in the arena may be used afterwards. */
+    void reset() noexcept                               { used = 0; }
+
+    /** Returns true if the pointer lies inside this arena's block. */
+    bool contains (const void* pointer) const noexcept;
+
+    size_t getSize() const noexcept                     { return size; }
+    size_t getBytesUsed() const noexcept                { return used; }
+
+    /** Returns the space an allocation of numBytes takes up, including its alignment. */
+    static size_t getAlignedSize (size_t numBytes) noexcept;
+
+    //==============================================================================
+    /**
+     Routes libsamplerate's allocations on the calling thread to an arena while it exists.
+
+     With a nullptr arena, allocations still come from the heap, but are counted, which is
+     how the size of a converter's state is found. Hooks can be nested.
+
+     State that libsamplerate created inside an arena must never be passed to src_delete(),
+     as its memory goes when the arena does.
+     */
+    class ScopedAllocationHook
+    {
+    public:
+        explicit ScopedAllocationHook (SRCArena* arenaToUse) noexcept;
+        ~ScopedAllocationHook();
+
+        /** Returns the arena space the allocations made so far would take. */
+        size_t getBytesRequested() const noexcept     { return bytesRequested; }
+
+    private:
+        friend class SRCArena;
+
+        SRCArena* const arena;
+        ScopedAllocationHook* const previous;
+        size_t bytesRequested = 0;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedAllocationHook)
+    };
+
+    /** The calloc() and free() that libsamplerate is compiled with. */
+    static void* callocHook (size_t numElements, size_t elementSize) noexcept;
+    static void freeHook (void* pointer) noexcept;
+
+private:
+    //==============================================================================
+    HeapBlock<char> ownedMemory;
+    char* start = nullptr;
+    size_t size = 0, used = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SRCArena)
+};
+
+} // namespace juce
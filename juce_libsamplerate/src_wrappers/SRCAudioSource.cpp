@@ -12,39 +12,181 @@
 
 namespace juce
 {
+
+namespace SRCAudioSourceHelpers
+{
+    // counts what src_new() asks for, as the size of libsamplerate's state is private to it
+    static size_t measureConverterStateSize (const libsamplerate::SRC::ResamplerQuality quality)
+    {
+        const SRCArena::ScopedAllocationHook hook (nullptr);
+        int error = 0;
+        libsamplerate::src_delete (libsamplerate::src_new (quality, 1, &error));
+        return hook.getBytesRequested();
+    }
+
+    static size_t getConverterStateSize (const libsamplerate::SRC::ResamplerQuality quality)
+    {
+        static const size_t sizes[] = { measureConverterStateSize (libsamplerate::SRC::SRC_SINC_BEST_QUALITY),
+                                        measureConverterStateSize (libsamplerate::SRC::SRC_SINC_MEDIUM_QUALITY),
+                                        measureConverterStateSize (libsamplerate::SRC::SRC_SINC_FASTEST),
+                                        measureConverterStateSize (libsamplerate::SRC::SRC_ZERO_ORDER_HOLD),
+                                        measureConverterStateSize (libsamplerate::SRC::SRC_LINEAR) };
+
+        jassert (isPositiveAndBelow ((int) quality, numElementsInArray (sizes)));
+        return sizes[(int) quality];
+    }
+}
+
 SRCAudioSource::SRCAudioSource (AudioSource* const inputSource,
                                 const bool deleteInputWhenDeleted,
                                 const libsamplerate::SRC::ResamplerQuality quality,
-                                const int channels)
+                                const int channels,
+                                const SRCCoefficientTable::Layout coefficientLayout)
 : input (inputSource, deleteInputWhenDeleted),
   conversionType (quality),
   numChannels (channels)
 {
     jassert (input != nullptr);
-    resamplers_.malloc (numChannels);
-    for (auto channel = 0; channel < numChannels; channel++)
-    {
-        resamplers_[channel] = libsamplerate::src_new (quality, 1, &src_error);
-    }
+
+    if (! SRCFastInterpolator::supportsQuality (quality)
+         && coefficientLayout != SRCCoefficientTable::original && SRCCoefficientTable::supportsQuality (quality))
+        sincConverter.reset (new SRCSincConverter (SRCCoefficientTable::getTable (quality, coefficientLayout), numChannels));
+
+    const auto useLibsamplerate = ! SRCFastInterpolator::supportsQuality (quality) && sincConverter == nullptr;
+    ownedArena.reset (new SRCArena (getStateSize (quality, numChannels, useLibsamplerate, 0)));
+    createState (*ownedArena, useLibsamplerate, 0);
+}
+
+SRCAudioSource::SRCAudioSource (AudioSource* const inputSource,
+                                const bool deleteInputWhenDeleted,
+                                SRCArena& arena,
+                                const int maxBlockSize,
+                                const double maxSamplesInPerOutputSample,
+                                const libsamplerate::SRC::ResamplerQuality quality,
+                                const int channels)
+: input (inputSource, deleteInputWhenDeleted),
+  conversionType (quality),
+  numChannels (channels)
+{
+    jassert (input != nullptr && maxBlockSize > 0 && maxSamplesInPerOutputSample > 0);
+
+    createState (arena, ! SRCFastInterpolator::supportsQuality (quality), getFixedBufferSize (maxBlockSize, maxSamplesInPerOutputSample));
 }
 
 SRCAudioSource::~SRCAudioSource()
 {
-    for (auto channel = 0; channel < numChannels; channel++)
+    // the converter state goes with the arena, so it isn't passed to src_delete(), and the
+    // interpolator placed there is only destroyed
+    if (fastInterpolator != nullptr)
+        fastInterpolator->~SRCFastInterpolator();
+}
+
+size_t SRCAudioSource::getRequiredArenaSize (const libsamplerate::SRC::ResamplerQuality quality,
+                                             const int channels,
+                                             const int maxBlockSize,
+                                             const double maxSamplesInPerOutputSample)
+{
+    return getStateSize (quality, channels, ! SRCFastInterpolator::supportsQuality (quality),
+                         getFixedBufferSize (maxBlockSize, maxSamplesInPerOutputSample));
+}
+
+int SRCAudioSource::getFixedBufferSize (const int maxBlockSize, const double maxSamplesInPerOutputSample) noexcept
+{
+    // the same headroom prepareToPlay() and getNextAudioBlock() leave
+    return (int) std::ceil (maxBlockSize * maxSamplesInPerOutputSample) + 32;
+}
+
+size_t SRCAudioSource::getStateSize (const libsamplerate::SRC::ResamplerQuality quality, const int channels,
+                                     const bool useLibsamplerate, const int fixedBufferSize)
+{
+    const auto numPointers = (size_t) channels;
+
+    auto size = SRCArena::getAlignedSize (sizeof (libsamplerate::SRC_STATE*) * numPointers)
+              + SRCArena::getAlignedSize (sizeof (libsamplerate::SRC_DATA) * numPointers)
+              + SRCArena::getAlignedSize (sizeof (const float*) * numPointers)
+              + SRCArena::getAlignedSize (sizeof (float*) * numPointers);
+
+    if (fixedBufferSize > 0)
+        size += SRCArena::getAlignedSize (sizeof (float*) * numPointers)
+              + numPointers * SRCArena::getAlignedSize (sizeof (float) * (size_t) fixedBufferSize);
+
+    if (useLibsamplerate)
+        size += numPointers * SRCAudioSourceHelpers::getConverterStateSize (quality);
+    else if (SRCFastInterpolator::supportsQuality (quality))
+        size += SRCFastInterpolator::getRequiredArenaSize (channels);
+
+    return size;
+}
+
+void SRCAudioSource::createState (SRCArena& arena, const bool useLibsamplerate, const int fixedBufferSize)
+{
+    const auto numPointers = (size_t) numChannels;
+    const auto bytesUsedBefore = arena.getBytesUsed();
+
+    resamplers_ = arena.allocateArray<libsamplerate::SRC_STATE*> (numPointers);
+    data_ = arena.allocateArray<libsamplerate::SRC_DATA> (numPointers);
+    srcBuffers = arena.allocateArray<const float*> (numPointers);
+    destBuffers = arena.allocateArray<float*> (numPointers);
+
+    if (fixedBufferSize > 0)
     {
-        resamplers_[channel] = libsamplerate::src_delete (resamplers_[channel]);
-        jassert (resamplers_[channel] == nullptr);
+        auto** channelData = arena.allocateArray<float*> (numPointers);
+
+        for (auto channel = 0; channel < numChannels; channel++)
+            channelData[channel] = arena.allocateArray<float> ((size_t) fixedBufferSize);
+
+        buffer.setDataToReferTo (channelData, numChannels, fixedBufferSize);
+        bufferIsFixed = true;
     }
+
+    if (SRCFastInterpolator::supportsQuality (conversionType))
+    {
+        jassert (fastInterpolator == nullptr);
+        fastInterpolator = new (arena.allocate (sizeof (SRCFastInterpolator))) SRCFastInterpolator (conversionType, numChannels, arena);
+    }
+    else if (useLibsamplerate)
+    {
+        const SRCArena::ScopedAllocationHook hook (&arena);
+
+        for (auto channel = 0; channel < numChannels; channel++)
+        {
+            resamplers_[channel] = libsamplerate::src_new (conversionType, 1, &src_error);
+            jassert (resamplers_[channel] != nullptr);
+        }
+    }
+
+    stateSize = arena.getBytesUsed() - bytesUsedBefore;
 }
 
 void SRCAudioSource::setResamplingRatio (const double samplesInPerOutputSample, bool shouldSmooth)
 {
     jassert (samplesInPerOutputSample > 0);
+
+    // outside the range given to setRatioRange(), the converters and buffer are too small
+    jassert (ratioRange.getEnd() <= 0.0 || (samplesInPerOutputSample >= ratioRange.getStart()
+                                            && samplesInPerOutputSample <= ratioRange.getEnd()));
+
+    if (multistageConverter != nullptr && ! multistageConverter->hasStagesFor (samplesInPerOutputSample))
+    {
+        // rebuilding the stages allocates, so it waits for the block being rendered
+        const ScopedLock callbackSl (callbackLock);
+        multistageConverter->setResamplingRatio (samplesInPerOutputSample);
+    }
+
     const SpinLock::ScopedLockType sl (ratioLock);
     ratio = samplesInPerOutputSample;
     if (!shouldSmooth)
     {
-        for (auto channel = 0; channel < numChannels; channel++)
+        if (multistageConverter != nullptr)
+            multistageConverter->setResamplingRatio (ratio);
+
+        if (fastInterpolator != nullptr)
+            fastInterpolator->setResamplingRatio (ratio);
+
+        if (sincConverter != nullptr)
+            sincConverter->setResamplingRatio (ratio);
+
+        for (auto channel = 0; channel < numChannels && resamplers_[channel] != nullptr; channel++)
         {
             libsamplerate::src_set_ratio (resamplers_[channel], jmax (0.0, jmax (0.0, 1.0 / ratio)));
         }
@@ -53,40 +195,428 @@ void SRCAudioSource::setResamplingRatio (const double samplesInPerOutputSample,
 
 void SRCAudioSource::prepareToPlay (int samplesPerBlockExpected, double sampleRate)
 {
+    // rings for the audio thread and the workers, which record spans from their first block
+    JUCE_SRC_TRACE_PREPARE (1 + (workerPool != nullptr ? workerPool->getNumWorkers() : 0))
+
     const SpinLock::ScopedLockType sl (ratioLock);
     auto scaledBlockSize = roundToInt (samplesPerBlockExpected * ratio);
     input->prepareToPlay (scaledBlockSize, sampleRate * ratio);
-    buffer.setSize (numChannels, scaledBlockSize + 32);
-    srcBuffers.calloc (numChannels);
-    destBuffers.calloc (numChannels);
-    data_.clear();
+
+    // a buffer in an arena was sized by the constructor
+    jassert (! bufferIsFixed || buffer.getNumSamples() >= scaledBlockSize + 32);
+
+    // with a declared range, the buffer is sized for its largest ratio so it doesn't grow
+    if (! bufferIsFixed)
+        buffer.setSize (numChannels, ratioRange.getEnd() > ratio ? roundToInt (samplesPerBlockExpected * ratioRange.getEnd()) + 32
+                                                                 : scaledBlockSize + 32);
+
     for (auto channel = 0; channel < numChannels; channel++)
     {
-        data_.add (new libsamplerate::SRC_DATA);
-        src_result = libsamplerate::src_set_ratio (resamplers_[channel], jmax (0.0, 1.0 / ratio));
+        if (resamplers_[channel] != nullptr)
+            src_result = libsamplerate::src_set_ratio (resamplers_[channel], jmax (0.0, 1.0 / ratio));
     }
+    if (fastInterpolator != nullptr)
+        fastInterpolator->setResamplingRatio (ratio);
+    if (sincConverter != nullptr)
+        sincConverter->setResamplingRatio (ratio);
+    if (multistageConverter != nullptr)
+        multistageConverter->setResamplingRatio (ratio);
     reset();
 }
 
+void SRCAudioSource::setUsesMultistage (const bool shouldUseMultistage)
+{
+    // the stages allocate, which a source in an arena mustn't do
+    jassert (! shouldUseMultistage || ! bufferIsFixed);
+
+    std::unique_ptr<SRCMultistageConverter> newConverter;
+
+    if (shouldUseMultistage)
+    {
+        const SpinLock::ScopedLockType sl (ratioLock);
+        newConverter.reset (new SRCMultistageConverter (conversionType, numChannels, ratio));
+    }
+
+    const ScopedLock sl (callbackLock);
+    std::swap (multistageConverter, newConverter);
+    resetConverters();
+}
+
+double SRCAudioSource::getLatency() const noexcept
+{
+    if (multistageConverter != nullptr)
+        return multistageConverter->getLatency();
+
+    // a minimum-phase filter plays its input late instead of holding it back
+    if (sincConverter != nullptr && sincConverter->getTable().getLayout() == SRCCoefficientTable::minimumPhase)
+        return sincConverter->getLatency (ratio) / ratio;
+
+    return 0.0;
+}
+
+void SRCAudioSource::setRatioRange (const Range<double> samplesInPerOutputSampleRange)
+{
+    // the state is rebuilt, which a source in an arena mustn't do
+    jassert (! bufferIsFixed && samplesInPerOutputSampleRange.getStart() > 0);
+
+    {
+        const ScopedLock sl (callbackLock);
+        ratioRange = samplesInPerOutputSampleRange;
+    }
+
+    if (SRCCoefficientTable::supportsQuality (conversionType))
+        replaceSincConverter (samplesInPerOutputSampleRange.getEnd());
+}
+
+void SRCAudioSource::replaceSincConverter (const double maxSamplesInPerOutputSample)
+{
+    // libsamplerate's state is private to it, so SRCSincConverter takes over from it, with
+    // the exactHalfTable layout that gives the same output
+    const auto layout = sincConverter != nullptr ? sincConverter->getTable().getLayout() : SRCCoefficientTable::exactHalfTable;
+    std::unique_ptr<SRCSincConverter> newConverter (new SRCSincConverter (SRCCoefficientTable::getTable (conversionType, layout),
+                                                                          numChannels, maxSamplesInPerOutputSample));
+    std::unique_ptr<SRCArena> newArena;
+
+    // without libsamplerate's state, the arena only keeps the per-channel pointers
+    if (sincConverter == nullptr)
+        newArena.reset (new SRCArena (getStateSize (conversionType, numChannels, false, 0)));
+
+    const ScopedLock sl (callbackLock);
+    std::swap (sincConverter, newConverter);
+
+    if (newArena != nullptr)
+    {
+        std::swap (ownedArena, newArena);
+        createState (*ownedArena, false, 0);
+    }
+
+    const SpinLock::ScopedLockType ratioSl (ratioLock);
+    sincConverter->setResamplingRatio (jmin (ratio, maxSamplesInPerOutputSample));
+    resetConverters();
+}
+
+size_t SRCAudioSource::getSizeInBytes() const noexcept
+{
+    auto size = sizeof (*this) + stateSize;
+
+    if (! bufferIsFixed)
+        size += sizeof (float) * (size_t) (buffer.getNumChannels() * buffer.getNumSamples());
+
+    if (sincConverter != nullptr)
+        size += sincConverter->getSizeInBytes();
+
+    if (multistageConverter != nullptr)
+        size += multistageConverter->getSizeInBytes();
+
+    return size;
+}
+
 void SRCAudioSource::reset()
 {
     bufferPos = sampsInBuffer = 0;
     buffer.clear();
-    for (auto channel = 0; channel < numChannels; channel++)
+    skippingSilence = false;
+    silentInputFrames = 0;
+    inputAheadOfOutput = silentInputPosition = 0.0;
+    bypassState = converting;
+    bypassHistory.clear();
+    resetConverters();
+}
+
+void SRCAudioSource::resetConverters()
+{
+    // a reset converter has nothing to fade from, and has lost any fade it was doing
+    convertersAreReset = true;
+
+    if (bypassState == fadingIn)
+        bypassState = converting;
+
+    if (fastInterpolator != nullptr)
+        fastInterpolator->reset();
+    if (sincConverter != nullptr)
+        sincConverter->reset();
+    if (multistageConverter != nullptr)
+        multistageConverter->reset();
+    for (auto channel = 0; channel < numChannels && resamplers_[channel] != nullptr; channel++)
     {
         src_result = libsamplerate::src_reset (resamplers_[channel]);
     }
 }
 
+void SRCAudioSource::setBypassesUnityRatio (const bool shouldBypass, const int crossfadeLengthInSamples)
+{
+    // the converters may be replaced, which a source in an arena mustn't do
+    jassert (! bufferIsFixed && crossfadeLengthInSamples >= 0);
+
+    if (shouldBypass && fastInterpolator == nullptr && sincConverter == nullptr)
+        replaceSincConverter (ratioRange.getEnd() > 0.0 ? ratioRange.getEnd() : (double) SRC_MAX_RATIO);
+
+    // enough history to leave the bypass for downsampling by up to 2 without a transient
+    AudioBuffer<float> newHistory;
+
+    if (shouldBypass && bypassHistory.getNumSamples() == 0)
+    {
+        newHistory.setSize (numChannels, getFilterReach (2.0));
+        newHistory.clear();
+    }
+
+    const ScopedLock sl (callbackLock);
+
+    if (newHistory.getNumSamples() > 0)
+        std::swap (bypassHistory, newHistory);
+
+    bypassesUnityRatio = shouldBypass;
+    bypassFadeLength = crossfadeLengthInSamples;
+}
+
+void SRCAudioSource::setConverterPassThrough (const float amount, const int numFramesToRamp)
+{
+    if (sincConverter != nullptr)
+        sincConverter->setPassThrough (amount, numFramesToRamp);
+    else if (fastInterpolator != nullptr)
+        fastInterpolator->setPassThrough (amount, numFramesToRamp);
+}
+
+bool SRCAudioSource::isConverterPassingThrough() const noexcept
+{
+    return sincConverter != nullptr ? sincConverter->isPassingThrough()
+                                    : fastInterpolator != nullptr && fastInterpolator->isPassingThrough();
+}
+
+void SRCAudioSource::updateBypassState (const bool shouldPassThrough)
+{
+    if (bypassState == passingThrough)
+    {
+        if (shouldPassThrough)
+            return;
+
+        // the converter carries on from the frames that were played, starting on a whole
+        // frame, so its output joins them without a fade
+        if (passedThroughUnconverted)
+        {
+            const auto historyLength = bypassHistory.getNumSamples();
+
+            if (sincConverter != nullptr)
+                sincConverter->primeHistory (bypassHistory.getArrayOfReadPointers(), historyLength);
+            else if (fastInterpolator != nullptr)
+                fastInterpolator->primeHistory (bypassHistory.getArrayOfReadPointers(), historyLength);
+
+            inputAheadOfOutput = 0.0;
+        }
+
+        setConverterPassThrough (0.0f, 0);
+        bypassState = converting;
+        silentInputFrames = 0;
+        return;
+    }
+
+    if (! shouldPassThrough)
+    {
+        if (bypassState == fadingIn)
+        {
+            setConverterPassThrough (0.0f, bypassFadeLength);
+            bypassState = converting;
+        }
+
+        return;
+    }
+
+    if (bypassState == converting)
+    {
+        if (convertersAreReset)
+        {
+            bypassState = passingThrough;
+            passedThroughUnconverted = false;
+            return;
+        }
+
+        setConverterPassThrough (1.0f, bypassFadeLength);
+        bypassState = fadingIn;
+    }
+
+    // the converter's output is the input it holds now, so that can be played instead
+    if (bypassState == fadingIn && isConverterPassingThrough())
+    {
+        bypassState = passingThrough;
+        passedThroughUnconverted = false;
+    }
+}
+
+void SRCAudioSource::passThroughBlock (const AudioSourceChannelInfo& info, const int channelsToProcess)
+{
+    for (int channel = 0; channel < numChannels; ++channel)
+        destBuffers[channel] = info.buffer->getWritePointer (channel, info.startSample);
+
+    // first the input the converter took but didn't play, then what's left in the buffer
+    auto done = sincConverter != nullptr ? sincConverter->takeHeldInput (destBuffers, info.numSamples)
+                                         : fastInterpolator->takeHeldInput (destBuffers, info.numSamples);
+
+    const auto numToCopy = jmin (info.numSamples - done, sampsInBuffer);
+
+    if (numToCopy > 0)
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+            info.buffer->copyFrom (channel, info.startSample + done, buffer, jmin (channel, channelsToProcess - 1), bufferPos, numToCopy);
+
+        bufferPos += numToCopy;
+        sampsInBuffer -= numToCopy;
+        done += numToCopy;
+        passedThroughUnconverted = true;
+    }
+
+    // and then the input goes straight into the destination
+    if (done < info.numSamples)
+    {
+        JUCE_SRC_TRACE_SPAN (pullSpan, "SRCAudioSource input", traceStreamId)
+        JUCE_SRC_TRACE_FRAMES (pullSpan, info.numSamples - done, info.numSamples - done, 1.0)
+        input->getNextAudioBlock (AudioSourceChannelInfo (info.buffer, info.startSample + done, info.numSamples - done));
+        passedThroughUnconverted = true;
+    }
+
+    // the last frames played, for the converter to start from
+    const auto historyLength = bypassHistory.getNumSamples();
+    const auto numNew = jmin (historyLength, info.numSamples);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        auto* history = bypassHistory.getWritePointer (channel);
+        std::memmove (history, history + numNew, sizeof (float) * (size_t) (historyLength - numNew));
+        FloatVectorOperations::copy (history + historyLength - numNew,
+                                     info.buffer->getReadPointer (jmin (channel, channelsToProcess - 1), info.startSample + info.numSamples - numNew),
+                                     numNew);
+    }
+}
+
+void SRCAudioSource::setSkipsSilence (const bool shouldSkipSilence, const float thresholdMagnitude)
+{
+    jassert (thresholdMagnitude >= 0.0f);
+    const ScopedLock sl (callbackLock);
+    skipsSilence = shouldSkipSilence;
+    silenceThreshold = thresholdMagnitude;
+    silentInputFrames = 0;
+
+    if (! skipsSilence && skippingSilence)
+    {
+        skippingSilence = false;
+        resetConverters();
+    }
+}
+
+//==============================================================================
+bool SRCAudioSource::isInputSilent (const int startSample, const int numSamples) const
+{
+    for (auto channel = 0; channel < numChannels; ++channel)
+        if (buffer.getMagnitude (channel, startSample, numSamples) > silenceThreshold)
+            return false;
+
+    return true;
+}
+
+int SRCAudioSource::getFilterReach (const double samplesInPerOutputSample) const
+{
+    if (multistageConverter != nullptr)
+        return multistageConverter->getFilterReach();
+
+    if (fastInterpolator != nullptr)
+        return 2;
+
+    // the input frames a sinc output reaches back over, which widens when downsampling; a
+    // minimum-phase filter lies wholly behind its output, so reaches back twice as far
+    const auto& table = SRCCoefficientTable::getTable (conversionType, SRCCoefficientTable::original);
+    const auto reach = (int) std::ceil ((table.getHalfLength() / table.getIncrement() + 2) * jmax (1.0, samplesInPerOutputSample));
+    const auto isMinimumPhase = sincConverter != nullptr && sincConverter->getTable().getLayout() == SRCCoefficientTable::minimumPhase;
+
+    return isMinimumPhase ? 2 * reach : reach;
+}
+
+bool SRCAudioSource::canStartSkipping (const double samplesInPerOutputSample) const
+{
+    // the converter has only seen silence for as long as it still holds input that hasn't
+    // reached the output, plus the length of its filter
+    const auto framesNotOutput = sampsInBuffer + jmax (0.0, inputAheadOfOutput);
+    return silentInputFrames >= (int64) std::ceil (framesNotOutput) + getFilterReach (samplesInPerOutputSample);
+}
+
+bool SRCAudioSource::skipSilentBlock (const AudioSourceChannelInfo& info, const double samplesInPerOutputSample)
+{
+    silentInputPosition += info.numSamples * samplesInPerOutputSample;
+    const auto numToConsume = (int) silentInputPosition;
+    silentInputPosition -= numToConsume;
+
+    // the frames left in the buffer are silent; make room for this block's input after them
+    const auto excess = sampsInBuffer + numToConsume - buffer.getNumSamples();
+
+    if (excess > 0)
+    {
+        bufferPos += excess;
+        sampsInBuffer -= excess;
+    }
+
+    const auto numToRead = numToConsume - jmin (numToConsume, sampsInBuffer);
+
+    if (numToRead > 0)
+    {
+        const auto endOfBufferPos = makeRoomForInput (numToRead);
+
+        {
+            JUCE_SRC_TRACE_SPAN (pullSpan, "SRCAudioSource input", traceStreamId)
+            JUCE_SRC_TRACE_FRAMES (pullSpan, numToRead, 0, samplesInPerOutputSample)
+            input->getNextAudioBlock (AudioSourceChannelInfo (&buffer, endOfBufferPos, numToRead));
+        }
+
+        sampsInBuffer += numToRead;
+
+        if (! isInputSilent (endOfBufferPos, numToRead))
+        {
+            // the converter starts again from the buffered input, with a clean history
+            skippingSilence = false;
+            silentInputFrames = 0;
+            inputAheadOfOutput = silentInputPosition = 0.0;
+            resetConverters();
+            return false;
+        }
+    }
+
+    bufferPos += numToConsume;
+    sampsInBuffer -= numToConsume;
+
+    // a fully cleared buffer keeps its hasBeenCleared() flag for the callers further up
+    if (info.startSample == 0 && info.numSamples == info.buffer->getNumSamples())
+        info.buffer->clear();
+    else
+        info.clearActiveBufferRegion();
+
+    return true;
+}
+
+int SRCAudioSource::makeRoomForInput (const int numFrames) noexcept
+{
+    jassert (sampsInBuffer + numFrames <= buffer.getNumSamples());
+
+    // the buffered frames are kept in one run, so a converter always gets them in one
+    // call; when the new ones don't fit after them, the few left over move to the front
+    if (bufferPos + sampsInBuffer + numFrames > buffer.getNumSamples())
+    {
+        if (sampsInBuffer > 0)
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                std::memmove (buffer.getWritePointer (channel), buffer.getReadPointer (channel, bufferPos),
+                              sizeof (float) * (size_t) sampsInBuffer);
+
+        bufferPos = 0;
+    }
+
+    return bufferPos + sampsInBuffer;
+}
+
 void SRCAudioSource::releaseResources()
 {
     input->releaseResources();
-    data_.clear();
     reset();
 }
 
 void SRCAudioSource::getNextAudioBlock (const AudioSourceChannelInfo& info)
 {
+    JUCE_SRC_TRACE_SPAN (blockSpan, "SRCAudioSource::getNextAudioBlock", traceStreamId)
     const ScopedLock sl (callbackLock);
 
     double localRatio;
@@ -96,6 +626,10 @@ void SRCAudioSource::getNextAudioBlock (const AudioSourceChannelInfo& info)
         localRatio = ratio;
     }
 
+    // a smoothed change ramps the converter's ratio over the block after it
+    const auto ratioIsSteady = lastRatio == localRatio;
+    const auto largestRatio = jmax (lastRatio, localRatio);
+
     if (lastRatio != localRatio)
     {
         lastRatio = localRatio;
@@ -105,60 +639,174 @@ void SRCAudioSource::getNextAudioBlock (const AudioSourceChannelInfo& info)
 
     int bufferSize = buffer.getNumSamples();
 
-    if (bufferSize < sampsNeeded + 8)
+    // a buffer in an arena can't grow, see the maximums given to the constructor
+    jassert (! bufferIsFixed || bufferSize >= sampsNeeded + 8);
+
+    if (bufferSize < sampsNeeded + 8 && ! bufferIsFixed)
     {
-        bufferPos %= bufferSize;
         bufferSize = sampsNeeded + 32;
         buffer.setSize (buffer.getNumChannels(), bufferSize, true, true);
     }
 
+    JUCE_SRC_TRACE_FRAMES (blockSpan, sampsNeeded, info.numSamples, localRatio)
+
     const int channelsToProcess = jmin (numChannels, info.buffer->getNumChannels());
 
+    updateBypassState (bypassesUnityRatio && localRatio == 1.0 && (ratioIsSteady || convertersAreReset)
+                        && multistageConverter == nullptr && ! skippingSilence
+                        && (sincConverter != nullptr || fastInterpolator != nullptr));
+
+    if (bypassState == passingThrough)
+    {
+        passThroughBlock (info, channelsToProcess);
+        return;
+    }
+
+    if (skippingSilence && skipSilentBlock (info, localRatio))
+        return;
+
     int samplesGenerated = 0;
 
     while (info.numSamples > samplesGenerated)
     {
-        bufferPos %= bufferSize;
-        int endOfBufferPos = bufferPos + sampsInBuffer;
+        // the input for the rest of the block is read in one piece, so that usually one call
+        // per converter makes the whole block; a ratio ramping down can take more input
+        const auto numWanted = jmin (bufferSize, (int) std::ceil ((info.numSamples - samplesGenerated) * largestRatio) + 2);
 
-        endOfBufferPos %= bufferSize;
-        if (sampsInBuffer == 0)
+        if (sampsInBuffer < numWanted)
         {
-            int numToDo = bufferSize - endOfBufferPos;
-            jassert (numToDo >= 0);
+            const auto numToDo = numWanted - sampsInBuffer;
+            const auto endOfBufferPos = makeRoomForInput (numToDo);
             AudioSourceChannelInfo readInfo (&buffer, endOfBufferPos, numToDo);
 
             sampsInBuffer += numToDo;
-            input->getNextAudioBlock (readInfo);
+
+            {
+                JUCE_SRC_TRACE_SPAN (pullSpan, "SRCAudioSource input", traceStreamId)
+                JUCE_SRC_TRACE_FRAMES (pullSpan, numToDo, 0, localRatio)
+                input->getNextAudioBlock (readInfo);
+            }
+
+            if (skipsSilence)
+                silentInputFrames = isInputSilent (endOfBufferPos, numToDo) ? silentInputFrames + numToDo : 0;
         }
         for (int channel = 0; channel < numChannels; ++channel)
         {
             destBuffers[channel] = info.buffer->getWritePointer (channel, info.startSample + samplesGenerated);
             srcBuffers[channel] = buffer.getReadPointer (jmin(channel, channelsToProcess - 1), bufferPos);
+        }
 
-            // prepare data struct for process
-            auto* data = data_[channel];
-            data->data_in = srcBuffers[channel];
-            data->data_out = destBuffers[channel];
-            jassert (sampsInBuffer <= bufferSize);
-            data->input_frames = sampsInBuffer;
-            data->output_frames = info.numSamples - samplesGenerated;
-            data->src_ratio = 1.0 / lastRatio;
-            data->end_of_input = 0; //  Equal to 0 if more input data is available and 1 otherwise.
-            src_result = libsamplerate::src_process (resamplers_[channel], data);
-            jassert (src_result == 0);
-            // this should be the same for all resamplers
-            jassert (data->input_frames_used == data_[jmax(channel - 1, 0)]->input_frames_used);
-            jassert (data->output_frames_gen == data_[jmax(channel - 1, 0)]->output_frames_gen);
-            jassert (data->end_of_input == 0);
+        jassert (sampsInBuffer <= bufferSize);
+        int inputFramesUsed = 0, outputFramesGenerated = 0;
+
+        if (multistageConverter != nullptr)
+        {
+            JUCE_SRC_TRACE_SPAN (convertSpan, "SRCMultistageConverter::process", traceStreamId)
+            outputFramesGenerated = multistageConverter->process (srcBuffers, sampsInBuffer, destBuffers, info.numSamples - samplesGenerated,
+                                                                  lastRatio, inputFramesUsed);
+            JUCE_SRC_TRACE_FRAMES (convertSpan, inputFramesUsed, outputFramesGenerated, lastRatio)
+        }
+        else if (fastInterpolator != nullptr)
+        {
+            JUCE_SRC_TRACE_SPAN (convertSpan, "SRCFastInterpolator::process", traceStreamId)
+            outputFramesGenerated = fastInterpolator->process (srcBuffers, sampsInBuffer, destBuffers, info.numSamples - samplesGenerated,
+                                                               lastRatio, inputFramesUsed);
+            JUCE_SRC_TRACE_FRAMES (convertSpan, inputFramesUsed, outputFramesGenerated, lastRatio)
+        }
+        else if (sincConverter != nullptr)
+        {
+            JUCE_SRC_TRACE_SPAN (convertSpan, "SRCSincConverter::process", traceStreamId)
+            outputFramesGenerated = sincConverter->process (srcBuffers, sampsInBuffer, destBuffers, info.numSamples - samplesGenerated,
+                                                            lastRatio, inputFramesUsed);
+            JUCE_SRC_TRACE_FRAMES (convertSpan, inputFramesUsed, outputFramesGenerated, lastRatio)
         }
-        sampsInBuffer -= data_[0]->input_frames_used;
-        bufferPos += data_[0]->input_frames_used; // this will % at top of loop.
-        samplesGenerated += data_[0]->output_frames_gen;
+        else
+        {
+            processChannels (sampsInBuffer, info.numSamples - samplesGenerated);
+            inputFramesUsed = (int) data_[0].input_frames_used;
+            outputFramesGenerated = (int) data_[0].output_frames_gen;
+        }
+
+        sampsInBuffer -= inputFramesUsed;
+        bufferPos += inputFramesUsed;
+        samplesGenerated += outputFramesGenerated;
+        inputAheadOfOutput += inputFramesUsed - outputFramesGenerated * lastRatio;
         jassert (sampsInBuffer >= 0);
-        jassert (samplesGenerated > 0);
+
+        // a filter that is still filling after a reset can take input without making output yet
+        jassert (inputFramesUsed + outputFramesGenerated > 0);
     }
     jassert (sampsInBuffer >= 0);
+    convertersAreReset = false;
+
+    if (skipsSilence && canStartSkipping (localRatio))
+    {
+        skippingSilence = true;
+        silentInputPosition = 0.0;
+    }
+}
+
+void SRCAudioSource::setChannelWorkerPool (SRCChannelWorkerPool* const pool, const int minChannelsPerGroup)
+{
+    const auto numGroups = pool != nullptr ? jmin (pool->getNumWorkers() + 1, numChannels / jmax (1, minChannelsPerGroup)) : 1;
+
+    const ScopedLock sl (callbackLock);
+    workerPool = numGroups > 1 ? pool : nullptr;
+    numChannelGroups = jmax (1, numGroups);
+}
+
+void SRCAudioSource::processChannels (const int numInputFrames, const int numOutputFrames)
+{
+    if (workerPool == nullptr)
+    {
+        processChannelRange (0, numChannels, numInputFrames, numOutputFrames);
+    }
+    else
+    {
+        auto processGroup = [this, numInputFrames, numOutputFrames] (const int group)
+        {
+            processChannelRange (group * numChannels / numChannelGroups, (group + 1) * numChannels / numChannelGroups,
+                                 numInputFrames, numOutputFrames);
+        };
+
+        workerPool->runEach (numChannelGroups, processGroup);
+    }
+
+    // every converter has to have taken and made the same number of frames
+    for (int channel = 1; channel < numChannels; ++channel)
+    {
+        jassert (data_[channel].input_frames_used == data_[0].input_frames_used);
+        jassert (data_[channel].output_frames_gen == data_[0].output_frames_gen);
+    }
+}
+
+void SRCAudioSource::processChannelRange (const int startChannel, const int endChannel,
+                                          const int numInputFrames, const int numOutputFrames)
+{
+    for (int channel = startChannel; channel < endChannel; ++channel)
+    {
+        // prepare data struct for process
+        auto* data = &data_[channel];
+        data->data_in = srcBuffers[channel];
+        data->data_out = destBuffers[channel];
+        data->input_frames = numInputFrames;
+        data->output_frames = numOutputFrames;
+        data->src_ratio = 1.0 / lastRatio;
+        data->end_of_input = 0; //  Equal to 0 if more input data is available and 1 otherwise.
+
+        // the groups run at once, so the result isn't kept in src_result
+        int result;
+
+        {
+            JUCE_SRC_TRACE_SPAN (convertSpan, "src_process", traceStreamId)
+            result = libsamplerate::src_process (resamplers_[channel], data);
+            JUCE_SRC_TRACE_FRAMES (convertSpan, (int) data->input_frames_used, (int) data->output_frames_gen, lastRatio)
+        }
+
+        jassert (result == 0);
+        ignoreUnused (result);
+        jassert (data->end_of_input == 0);
+    }
 }
 
 } // namespace juce
@@ -33,16 +33,51 @@ public:
      @param inputSource              the input source to read from
      @param deleteInputWhenDeleted   if true, the input source will be deleted when
      this object is deleted
+     @param quality                  quality / type of sample rate conversion. SRC_LINEAR and
+     SRC_ZERO_ORDER_HOLD are run by SRCFastInterpolator
+     instead of libsamplerate
      @param numChannels              the number of channels to process
+     @param coefficientLayout        for the sinc qualities, anything but
+                                     SRCCoefficientTable::original runs SRCSincConverter
+                                     with that layout instead of libsamplerate. Use
+                                     SRCCoefficientTable::minimumPhase for live paths
+                                     that need a low latency
      */
     SRCAudioSource (AudioSource* inputSource,
                     bool deleteInputWhenDeleted,
                     libsamplerate::SRC::ResamplerQuality quality = libsamplerate::SRC::SRC_SINC_MEDIUM_QUALITY,
+                    int numChannels = 2,
+                    SRCCoefficientTable::Layout coefficientLayout = SRCCoefficientTable::original);
+
+    /** Creates a SRCAudioSource whose state is placed in an arena supplied by the caller.
+
+     The converter state of every channel (or the interpolator used for SRC_LINEAR and
+     SRC_ZERO_ORDER_HOLD), the buffers that hold the input and the bookkeeping for each
+     block are laid out in one contiguous run of the arena, and nothing is allocated on
+     the heap afterwards (the input buffer never grows, so blocks must stay within the
+     sizes given here). The arena must outlive this object.
+
+     @param arena                        an arena with at least getRequiredArenaSize() bytes free
+     @param maxBlockSize                 the largest block getNextAudioBlock() will be asked for
+     @param maxSamplesInPerOutputSample  the largest ratio setResamplingRatio() will be given
+     */
+    SRCAudioSource (AudioSource* inputSource,
+                    bool deleteInputWhenDeleted,
+                    SRCArena& arena,
+                    int maxBlockSize,
+                    double maxSamplesInPerOutputSample,
+                    libsamplerate::SRC::ResamplerQuality quality = libsamplerate::SRC::SRC_SINC_MEDIUM_QUALITY,
                     int numChannels = 2);
 
     /** Destructor. */
     ~SRCAudioSource() override;
 
+    /** Returns the number of arena bytes the arena constructor takes with these settings. */
+    static size_t getRequiredArenaSize (libsamplerate::SRC::ResamplerQuality quality,
+                                        int numChannels,
+                                        int maxBlockSize,
+                                        double maxSamplesInPerOutputSample);
+
     /** Changes the resampling ratio.
 
      (This value can be changed at any time, even while the source is running).
@@ -63,30 +98,180 @@ public:
     /** Resets resampler state **/
     void reset();
 
+    /** Converts ratios of 2 or more (either way) with SRCMultistageConverter: half-band
+        stages for the power-of-two part, and this source's quality for the rest.
+
+        This allocates, and can't be used by a source whose state is in an arena.
+     */
+    void setUsesMultistage (bool shouldUseMultistage);
+
+    /** Returns true if setUsesMultistage() is on. */
+    bool isUsingMultistage() const noexcept                     { return multistageConverter != nullptr; }
+
+    /** Returns the delay of the output, in output samples. Only the half-band stages of
+        setUsesMultistage() and the SRCCoefficientTable::minimumPhase layout delay it; the
+        other converters hold output back instead.
+     */
+    double getLatency() const noexcept;
+
+    //==============================================================================
+    /** Declares the ratios setResamplingRatio() will be given, so the source allocates only
+        what they need: for example 0.9 to 1.1 for drift correction, or a single ratio such
+        as 44100.0 / 48000.0.
+
+     The sinc qualities are then converted by SRCSincConverter sized for the largest ratio
+     in the range, instead of by libsamplerate, whose state is sized for every ratio it
+     accepts (up to 256); with the original layout the exactHalfTable one is used, which
+     gives the same output. The input buffer is sized in prepareToPlay() for the largest
+     ratio too, so it doesn't grow while playing.
+
+     This allocates and clears the converters' history, so call it before prepareToPlay().
+     It can't be used by a source whose state is in an arena, which is sized by its
+     constructor instead.
+     */
+    void setRatioRange (Range<double> samplesInPerOutputSampleRange);
+
+    /** Returns the range given to setRatioRange(), or an empty range at 0 if none was. */
+    Range<double> getRatioRange() const noexcept                { return ratioRange; }
+
+    /** Returns the number of bytes this source uses for its converters and buffers,
+        including its part of an arena it was given, but not the shared coefficient tables
+        or the input source.
+     */
+    size_t getSizeInBytes() const noexcept;
+
+    //==============================================================================
+    /** Passes the input straight through while the ratio is exactly 1.0.
+
+     When setResamplingRatio() is given 1.0, the converter's output is crossfaded into the
+     input frames it's aligned with. After the fade, the frames it still holds are played
+     out, and then the input is read straight into the destination, with no conversion and
+     no copying apart from keeping the last few frames. When the ratio moves away from 1.0,
+     the converter starts on the next frame with those frames as its history, so it needs
+     no fade. The timing never shifts by more than half a sample.
+
+     Only SRCFastInterpolator and SRCSincConverter can be faded like this. While this is on,
+     libsamplerate's sinc qualities run on SRCSincConverter with the exactHalfTable layout,
+     which gives the same output. Ratios that setUsesMultistage() converts aren't bypassed.
+
+     This allocates when first turned on. It can't be used by a source whose state is in an
+     arena.
+
+     @param shouldBypass                 enables or disables the pass-through
+     @param crossfadeLengthInSamples     the length of the crossfade into the input, in output samples
+     */
+    void setBypassesUnityRatio (bool shouldBypass, int crossfadeLengthInSamples = 256);
+
+    /** Returns true while the input is being passed straight through. */
+    bool isBypassing() const noexcept                           { return bypassState == passingThrough; }
+
+    //==============================================================================
+    /** Splits the channels into groups that are converted in parallel on a worker pool.
+
+     Only the libsamplerate converters (one per channel) are split; SRCFastInterpolator,
+     SRCSincConverter and SRCMultistageConverter process all channels together. Every
+     group converts the same frames, so the channels stay sample-locked. With fewer than
+     two groups' worth of channels the channels are converted serially, as without a pool.
+
+     @param pool                     the pool to run on, or nullptr to convert serially.
+                                     It must outlive this object, or be removed first.
+     @param minChannelsPerGroup      the smallest group worth handing to another thread
+     */
+    void setChannelWorkerPool (SRCChannelWorkerPool* pool, int minChannelsPerGroup = 4);
+
+    //==============================================================================
+    /** Lets the source stop converting while its input is silent.
+
+     Once the input has stayed below the threshold for long enough that the converter's
+     filter has nothing but silence left in it, each block is cleared instead of
+     converted (clearing the whole buffer when the block covers it, so hasBeenCleared()
+     is passed on). The input is still read at the current ratio and checked, and the
+     converter starts again with a clean history as soon as it isn't silent.
+
+     @param shouldSkipSilence    enables or disables skipping
+     @param thresholdMagnitude   input whose magnitude doesn't exceed this counts as
+                                 silence, so 0 only skips digital silence
+     */
+    void setSkipsSilence (bool shouldSkipSilence, float thresholdMagnitude = 0.0f);
+
+    /** Returns true while conversion is being skipped because the input is silent. */
+    bool isSkippingSilence() const noexcept                     { return skippingSilence; }
+
     //==============================================================================
     void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override;
     void releaseResources() override;
     void getNextAudioBlock (const juce::AudioSourceChannelInfo&) override;
 
 private:
+    void processChannels (int numInputFrames, int numOutputFrames);
+    void processChannelRange (int startChannel, int endChannel, int numInputFrames, int numOutputFrames);
+    enum BypassState
+    {
+        converting,
+        fadingIn,       // the converter is crossfading into the input it's aligned with
+        passingThrough
+    };
+
+    void updateBypassState (bool shouldPassThrough);
+    void setConverterPassThrough (float amount, int numFramesToRamp);
+    bool isConverterPassingThrough() const noexcept;
+    void passThroughBlock (const AudioSourceChannelInfo&, int channelsToProcess);
+    void replaceSincConverter (double maxSamplesInPerOutputSample);
+    void createState (SRCArena&, bool useLibsamplerate, int fixedBufferSize);
+    static size_t getStateSize (libsamplerate::SRC::ResamplerQuality, int numChannels, bool useLibsamplerate, int fixedBufferSize);
+    static int getFixedBufferSize (int maxBlockSize, double maxSamplesInPerOutputSample) noexcept;
+    void resetConverters();
+    bool isInputSilent (int startSample, int numSamples) const;
+    int getFilterReach (double samplesInPerOutputSample) const;
+    bool canStartSkipping (double samplesInPerOutputSample) const;
+    bool skipSilentBlock (const AudioSourceChannelInfo&, double samplesInPerOutputSample);
+    int makeRoomForInput (int numFrames) noexcept;
 
     //==============================================================================
     juce::OptionalScopedPointer<juce::AudioSource> input;
     double ratio = 1.0, lastRatio = 1.0;
     libsamplerate::SRC::ResamplerQuality conversionType; // SRC quality
     juce::AudioBuffer<float> buffer;
-    int bufferPos = 0, sampsInBuffer = 0;
+    int bufferPos = 0, sampsInBuffer = 0; // the buffered input is one run, never wrapped
+    bool bufferIsFixed = false; // the buffer refers to arena memory and can't be resized
+    Range<double> ratioRange; // declared by setRatioRange(), empty at 0 until then
+
+    bool skipsSilence = false, skippingSilence = false;
+    float silenceThreshold = 0.0f;
+    int64 silentInputFrames = 0; // trailing silent frames read from the input
+    double inputAheadOfOutput = 0.0; // input the converter took that its output hasn't reached yet
+    double silentInputPosition = 0.0; // fraction of an input frame carried between skipped blocks
+
+    bool bypassesUnityRatio = false;
+    BypassState bypassState = converting;
+    int bypassFadeLength = 0;
+    bool convertersAreReset = true; // there's no converted audio to fade from
+    bool passedThroughUnconverted = false; // the converter hasn't seen some of the input passed through
+    juce::AudioBuffer<float> bypassHistory; // the last frames passed through, for the converter to start from
 
-    HeapBlock<libsamplerate::SRC_STATE*> resamplers_;
-    OwnedArray<libsamplerate::SRC_DATA> data_;
+    // the per-channel state lives in an arena: the caller's, or one owned by this object
+    std::unique_ptr<SRCArena> ownedArena;
+    size_t stateSize = 0; // the bytes createState() took from the arena
+    libsamplerate::SRC_STATE** resamplers_ = nullptr; // converter state is released with the arena, never by src_delete
+    SRCFastInterpolator* fastInterpolator = nullptr; // placed in the arena, used instead of resamplers_ for SRC_LINEAR and SRC_ZERO_ORDER_HOLD
+    std::unique_ptr<SRCSincConverter> sincConverter; // used instead of resamplers_ when a coefficient layout is chosen
+    std::unique_ptr<SRCMultistageConverter> multistageConverter; // used instead of all the above when setUsesMultistage() is on
+    libsamplerate::SRC_DATA* data_ = nullptr;
     juce::SpinLock ratioLock;
     juce::CriticalSection callbackLock;
 
+    SRCChannelWorkerPool* workerPool = nullptr;
+    int numChannelGroups = 1;
+
     int src_error;
     int src_result;
     const int numChannels;
-    HeapBlock<float*> destBuffers;
-    HeapBlock<const float*> srcBuffers;
+    float** destBuffers = nullptr;
+    const float** srcBuffers = nullptr;
+
+   #if JUCE_LIBSAMPLERATE_TRACING
+    const uint32 traceStreamId = SRCTrace::createStreamId();
+   #endif
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SRCAudioSource)
 };
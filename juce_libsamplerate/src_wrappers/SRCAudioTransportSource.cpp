@@ -25,12 +25,94 @@ namespace juce
 
     SRCAudioTransportSource::SRCAudioTransportSource()
     {
+        backgroundThread->addTimeSliceClient (this);
     }
 
     SRCAudioTransportSource::~SRCAudioTransportSource()
     {
-        setSource (nullptr);
-        releaseMasterResources();
+        // this waits for a time slice that's under way
+        backgroundThread->removeTimeSliceClient (this);
+
+        cancelPendingSwap();
+
+        {
+            const ScopedLock sl (callbackLock);
+            handlePendingCommands();
+            retireChain (outgoingChain);
+            retireChain (activeChain);
+            outgoingChain = nullptr;
+            activeChain = nullptr;
+            swappedInChain = nullptr;
+            isPrepared = false;
+        }
+
+        source = nullptr;
+
+        const ScopedLock sl (chainLock);
+        latestChain = nullptr;
+        deleteRetiredChains();
+    }
+
+    SRCAudioTransportSource::Chain* SRCAudioTransportSource::createChain (PositionableAudioSource* const newSource,
+                                                                          int readAheadSize, TimeSliceThread* readAheadThread,
+                                                                          double sourceSampleRateToCorrectFor, ResamplerQuality src_quality,
+                                                                          int maxNumChannels)
+    {
+        if (newSource == nullptr)
+            return nullptr;
+
+        auto* chain = new Chain();
+        chain->source = newSource;
+        chain->sourceSampleRate = sourceSampleRateToCorrectFor;
+        chain->numChannels = maxNumChannels;
+        chain->loopSource.reset (new SRCLoopRegionSource (newSource, false));
+        chain->positionableSource = chain->loopSource.get();
+
+        if (readAheadSize > 0 || (readAheadSeconds > 0 && (readAheadThread != nullptr || readAheadScheduler != nullptr)))
+        {
+            // If you want to use a read-ahead buffer, you must also provide a TimeSliceThread
+            // or a scheduler for it to use!
+            jassert (readAheadThread != nullptr || readAheadScheduler != nullptr);
+
+            // with a read-ahead time, the buffer is sized again when the chain is prepared
+            const auto initialSize = readAheadSeconds > 0 ? 32768 : readAheadSize;
+
+            if (readAheadScheduler != nullptr)
+            {
+                chain->bufferingSource.reset (new SRCReadAheadSource (chain->loopSource.get(), *readAheadScheduler, false,
+                                                                      initialSize, maxNumChannels, readAheadBudget));
+                chain->bufferingSource->setReadGroup (readAheadGroup);
+            }
+            else
+            {
+                chain->bufferingSource.reset (new SRCReadAheadSource (chain->loopSource.get(), *readAheadThread, false,
+                                                                      initialSize, maxNumChannels, readAheadBudget));
+            }
+
+            // the chain is prepared on the background thread all transports share, or under the
+            // callback lock, so the buffer fills while useTimeSlice() polls it instead
+            chain->bufferingSource->setPrepareWaitsForBuffer (false);
+            chain->positionableSource = chain->bufferingSource.get();
+            chain->readAheadSeconds = readAheadSeconds;
+            chain->adaptReadAhead = adaptReadAhead;
+        }
+
+        chain->positionableSource->setNextReadPosition (0);
+
+        if (sourceSampleRateToCorrectFor > 0)
+        {
+            chain->resamplerSource.reset (new SRCAudioSource (chain->positionableSource, false, src_quality, maxNumChannels, resamplerLayout));
+
+            // when the source and device rates match, the audio isn't converted at all
+            chain->resamplerSource->setBypassesUnityRatio (true);
+            chain->masterSource = chain->resamplerSource.get();
+        }
+        else
+        {
+            chain->masterSource = chain->positionableSource;
+        }
+
+        return chain;
     }
 
     void SRCAudioTransportSource::setSource (PositionableAudioSource* const newSource,
@@ -38,101 +120,180 @@ namespace juce
                                           double sourceSampleRateToCorrectFor, ResamplerQuality src_quality,
                                           int maxNumChannels)
     {
-        if (source == newSource)
+        if (source == newSource && source == nullptr)
+            return;
+
+        cancelPendingSwap();
+
+        // a chain still reading the source can't share it with the new chain, which
+        // repositions and prepares it, so it's taken off the audio thread first
+        if (newSource != nullptr)
+            detachChainsReading (newSource);
+
+        std::unique_ptr<Chain> newChain (createChain (newSource, readAheadSize, readAheadThread,
+                                                      sourceSampleRateToCorrectFor, src_quality, maxNumChannels));
+
+        source = newSource;
+        playing = false;
+        pendingPosition = -1;
+
+        Command command;
+        command.type = Command::swapChain;
+        command.chain = newChain.get();
+
+        uint32 generation;
+
         {
-            if (source == nullptr)
-                return;
+            const ScopedLock sl (preparationLock);
+            generation = swapGeneration;
+        }
 
-            setSource (nullptr, 0, nullptr); // deselect and reselect to avoid releasing resources wrongly
+        if (newChain == nullptr)
+        {
+            postCommand (command);
         }
+        else
+        {
+            newChain->generation = generation;
 
-        readAheadBufferSize = readAheadSize;
-        sourceSampleRate = sourceSampleRateToCorrectFor;
+            const auto wasPosted = postPreparedChain (command, generation);
+            jassert (wasPosted);
+            ignoreUnused (wasPosted);
+        }
 
-        SRCAudioSource* newResamplerSource = nullptr;
-        BufferingAudioSource* newBufferingSource = nullptr;
-        PositionableAudioSource* newPositionableSource = nullptr;
-        AudioSource* newMasterSource = nullptr;
+        // the command is never dropped, so from here on the audio thread owns the chain, and
+        // a swap that was posted before it can no longer become the latest one
+        const ScopedLock sl (chainLock);
+        latestChain = newChain.release();
+        latestGeneration = generation;
+    }
 
-        std::unique_ptr<SRCAudioSource> oldResamplerSource (resamplerSource);
-        std::unique_ptr<BufferingAudioSource> oldBufferingSource (bufferingSource);
-        AudioSource* oldMasterSource = masterSource;
+    void SRCAudioTransportSource::swapSource (PositionableAudioSource* const newSource,
+                                           int readAheadSize, TimeSliceThread* readAheadThread,
+                                           double sourceSampleRateToCorrectFor, ResamplerQuality src_quality,
+                                           int maxNumChannels, int crossfadeLengthInSamples,
+                                           double startTimeInSeconds)
+    {
+        // the source that's playing can't also feed the new chain
+        jassert (newSource == nullptr || newSource != source);
 
-        if (newSource != nullptr)
+        if (newSource == source)
+            return;
+
+        if (newSource == nullptr)
         {
-            newPositionableSource = newSource;
+            setSource (nullptr);
+            return;
+        }
 
-            if (readAheadSize > 0)
-            {
-                // If you want to use a read-ahead buffer, you must also provide a TimeSliceThread
-                // for it to use!
-                jassert (readAheadThread != nullptr);
+        // as in setSource(), nothing else may be reading the source when its chain is made,
+        // so a crossfade from it that's still running is cut short
+        cancelPendingSwap();
+        detachChainsReading (newSource);
 
-                newPositionableSource = newBufferingSource
-                = new BufferingAudioSource (newPositionableSource, *readAheadThread,
-                                            false, readAheadSize, maxNumChannels);
-            }
+        auto* newChain = createChain (newSource, readAheadSize, readAheadThread,
+                                      sourceSampleRateToCorrectFor, src_quality, maxNumChannels);
 
-            newPositionableSource->setNextReadPosition (0);
+        const auto startRate = sourceSampleRateToCorrectFor > 0 ? sourceSampleRateToCorrectFor : sampleRate.load();
+        newChain->positionableSource->setNextReadPosition ((int64) (startTimeInSeconds * startRate));
 
-            if (sourceSampleRateToCorrectFor > 0)
-                newMasterSource = newResamplerSource
-                = new SRCAudioSource (newPositionableSource, false, src_quality, maxNumChannels);
-            else
-                newMasterSource = newPositionableSource;
+        // the old chain stays the latest one until the audio thread has switched over
+        source = newSource;
+        pendingPosition = -1;
 
-            if (isPrepared)
-            {
-                if (newResamplerSource != nullptr && sourceSampleRate > 0 && sampleRate > 0)
-                    newResamplerSource->setResamplingRatio (sourceSampleRate / sampleRate);
+        {
+            const ScopedLock sl (preparationLock);
+            ++swapGeneration;
 
-                newMasterSource->prepareToPlay (blockSize, sampleRate);
-            }
+            // cancelPendingSwap() has already dropped a swap that hadn't happened yet
+            chainToPrepare = newChain;
+            chainToPrepare->generation = swapGeneration;
+            crossfadeToPrepare = jmax (0, crossfadeLengthInSamples);
         }
 
+        backgroundThread->moveToFrontOfQueue (this);
+    }
+
+    void SRCAudioTransportSource::cancelPendingSwap()
+    {
         {
-            const ScopedLock sl (callbackLock);
+            const ScopedLock sl (preparationLock);
+            ++swapGeneration;
+            delete chainToPrepare;
+            chainToPrepare = nullptr;
+        }
 
-            source = newSource;
-            resamplerSource = newResamplerSource;
-            bufferingSource = newBufferingSource;
-            masterSource = newMasterSource;
-            positionableSource = newPositionableSource;
+        // a swap that's already being prepared is discarded too, releasing its source
+        // before the caller uses the source again
+        const ScopedLock bl (backgroundLock);
+        discardChainBeingPrepared();
+    }
 
-            inputStreamEOF = false;
-            playing = false;
-        }
+    void SRCAudioTransportSource::setReadAheadTime (const double secondsOfPlayback, const bool adaptToThroughput,
+                                                    SRCReadAheadSource::Budget* const budget)
+    {
+        jassert (secondsOfPlayback >= 0);
+
+        readAheadSeconds = secondsOfPlayback;
+        adaptReadAhead = adaptToThroughput;
+        readAheadBudget = budget;
+    }
 
-        if (oldMasterSource != nullptr)
-            oldMasterSource->releaseResources();
+    void SRCAudioTransportSource::setReadAheadScheduler (SRCReadAheadScheduler* const scheduler, const String& readGroup)
+    {
+        readAheadScheduler = scheduler;
+        readAheadGroup = readGroup;
+    }
+
+    void SRCAudioTransportSource::setResamplerLayout (const SRCCoefficientTable::Layout layout)
+    {
+        resamplerLayout = layout;
+    }
+
+    double SRCAudioTransportSource::getLatencyInSeconds() const
+    {
+        const ScopedLock sl (chainLock);
+        auto* chain = getLatestChain();
+
+        if (chain == nullptr || chain->resamplerSource == nullptr || sampleRate <= 0)
+            return 0.0;
+
+        return chain->resamplerSource->getLatency() / sampleRate;
+    }
+
+    SRCReadAheadSource::Statistics SRCAudioTransportSource::getReadAheadStatistics() const
+    {
+        const ScopedLock sl (chainLock);
+        auto* chain = getLatestChain();
+
+        if (chain != nullptr && chain->bufferingSource != nullptr)
+            return chain->bufferingSource->getStatistics();
+
+        return {};
     }
 
     void SRCAudioTransportSource::start()
     {
-        if ((! playing) && masterSource != nullptr)
+        if ((! playing) && source != nullptr)
         {
-            {
-                const ScopedLock sl (callbackLock);
-                playing = true;
-                stopped = false;
-                inputStreamEOF = false;
-            }
+            playing = true;
 
-            sendChangeMessage();
+            Command command;
+            command.type = Command::startPlaying;
+            postCommand (command);
         }
     }
 
-    void SRCAudioTransportSource::stop()
+    void SRCAudioTransportSource::stop (const int fadeOutLengthInSamples)
     {
         if (playing)
         {
             playing = false;
 
-            int n = 500;
-            while (--n >= 0 && ! stopped)
-                Thread::sleep (2);
-
-            sendChangeMessage();
+            Command command;
+            command.type = Command::stopPlaying;
+            command.fadeLength = jmax (0, fadeOutLengthInSamples);
+            postCommand (command);
         }
     }
 
@@ -160,26 +321,32 @@ namespace juce
 
     void SRCAudioTransportSource::setNextReadPosition (int64 newPosition)
     {
-        if (positionableSource != nullptr)
-        {
-            if (sampleRate > 0 && sourceSampleRate > 0)
-                newPosition = (int64) ((double) newPosition * sourceSampleRate / sampleRate);
-
-            positionableSource->setNextReadPosition (newPosition);
+        const ScopedLock sl (chainLock);
 
-            if (resamplerSource != nullptr)
-                resamplerSource->reset();
+        if (auto* chain = getLatestChain())
+        {
+            if (sampleRate > 0 && chain->sourceSampleRate > 0)
+                newPosition = (int64) ((double) newPosition * chain->sourceSampleRate / sampleRate);
 
-            inputStreamEOF = false;
+            // only the newest seek matters, so it isn't queued; the audio thread picks it up
+            // at the start of its next block
+            pendingPosition = newPosition;
+            handlePendingCommandsIfUnprepared();
         }
     }
 
     int64 SRCAudioTransportSource::getNextReadPosition() const
     {
-        if (positionableSource != nullptr)
+        const ScopedLock sl (chainLock);
+
+        if (auto* chain = getLatestChain())
         {
-            const double ratio = (sampleRate > 0 && sourceSampleRate > 0) ? sampleRate / sourceSampleRate : 1.0;
-            return (int64) ((double) positionableSource->getNextReadPosition() * ratio);
+            const double ratio = (sampleRate > 0 && chain->sourceSampleRate > 0) ? sampleRate / chain->sourceSampleRate : 1.0;
+            const auto pending = pendingPosition.load();
+            const auto position = pending >= 0 ? pending
+                                               : chain->loopSource->getSourcePosition (chain->positionableSource->getNextReadPosition());
+
+            return (int64) ((double) position * ratio);
         }
 
         return 0;
@@ -187,12 +354,12 @@ namespace juce
 
     int64 SRCAudioTransportSource::getTotalLength() const
     {
-        const ScopedLock sl (callbackLock);
+        const ScopedLock sl (chainLock);
 
-        if (positionableSource != nullptr)
+        if (auto* chain = getLatestChain())
         {
-            const double ratio = (sampleRate > 0 && sourceSampleRate > 0) ? sampleRate / sourceSampleRate : 1.0;
-            return (int64) ((double) positionableSource->getTotalLength() * ratio);
+            const double ratio = (sampleRate > 0 && chain->sourceSampleRate > 0) ? sampleRate / chain->sourceSampleRate : 1.0;
+            return (int64) ((double) chain->source->getTotalLength() * ratio);
         }
 
         return 0;
@@ -200,27 +367,439 @@ namespace juce
 
     bool SRCAudioTransportSource::isLooping() const
     {
-        const ScopedLock sl (callbackLock);
-        return positionableSource != nullptr && positionableSource->isLooping();
+        const ScopedLock sl (chainLock);
+        auto* chain = getLatestChain();
+
+        return chain != nullptr && (chain->loopSource->hasLoopRegion() || chain->source->isLooping());
+    }
+
+    void SRCAudioTransportSource::setLoopRegion (const int64 loopStartInSourceSamples, const int64 loopEndInSourceSamples)
+    {
+        jassert (loopStartInSourceSamples >= 0 && loopEndInSourceSamples > loopStartInSourceSamples);
+
+        const ScopedLock sl (chainLock);
+
+        if (auto* chain = getLatestChain())
+            chain->loopSource->setLoopRegion ({ loopStartInSourceSamples, loopEndInSourceSamples });
+    }
+
+    void SRCAudioTransportSource::clearLoopRegion()
+    {
+        const ScopedLock sl (chainLock);
+
+        if (auto* chain = getLatestChain())
+            chain->loopSource->clearLoopRegion();
+    }
+
+    Range<int64> SRCAudioTransportSource::getLoopRegion() const
+    {
+        const ScopedLock sl (chainLock);
+        auto* chain = getLatestChain();
+
+        return chain != nullptr ? chain->loopSource->getLoopRegion() : Range<int64>();
     }
 
     void SRCAudioTransportSource::setGain (const float newGain) noexcept
     {
-        gain = newGain;
+        // like a seek, only the newest gain matters, so it's read at the start of each block
+        requestedGain = newGain;
+    }
+
+    //==============================================================================
+    void SRCAudioTransportSource::postCommand (const Command& command)
+    {
+        // only start, stop and swaps are queued, and start and stop take turns, so the queue
+        // only fills if nothing drains it, e.g. the transport is prepared but its callback
+        // isn't running
+        for (;;)
+        {
+            {
+                // only callers contend for this lock, never the audio thread
+                const SpinLock::ScopedLockType sl (commandWriteLock);
+
+                int start1, size1, start2, size2;
+                commandFifo.prepareToWrite (1, start1, size1, start2, size2);
+
+                if (size1 + size2 > 0)
+                {
+                    commands[size1 > 0 ? start1 : start2] = command;
+                    commandFifo.finishedWrite (1);
+                    break;
+                }
+            }
+
+            {
+                // the lock is free between blocks, so this never waits for one to finish; the
+                // commands waiting are applied here, in order
+                const ScopedTryLock sl (callbackLock);
+
+                if (sl.isLocked())
+                {
+                    handlePendingCommands();
+                    applyCommand (command);
+                    return;
+                }
+            }
+
+            // a block is being rendered, and the queue is drained when the next one starts
+            Thread::yield();
+        }
+
+        handlePendingCommandsIfUnprepared();
+    }
+
+    void SRCAudioTransportSource::handlePendingCommandsIfUnprepared()
+    {
+        // without an audio callback running, nothing would drain the queue
+        if (! isPrepared)
+        {
+            const ScopedLock sl (callbackLock);
+
+            if (! isPrepared)
+                handlePendingCommands();
+        }
+    }
+
+    void SRCAudioTransportSource::handlePendingCommands()
+    {
+        int start1, size1, start2, size2;
+        commandFifo.prepareToRead (commandFifo.getNumReady(), start1, size1, start2, size2);
+
+        for (int i = 0; i < size1; ++i)
+            applyCommand (commands[start1 + i]);
+
+        for (int i = 0; i < size2; ++i)
+            applyCommand (commands[start2 + i]);
+
+        commandFifo.finishedRead (size1 + size2);
+
+        // seeks and gain changes are applied after the queue, so a seek lands in the chain
+        // that was selected before it
+        applyPendingPosition();
+        gain = requestedGain;
+    }
+
+    void SRCAudioTransportSource::applyPendingPosition()
+    {
+        auto position = pendingPosition.load();
+
+        if (position < 0)
+            return;
+
+        if (activeChain != nullptr)
+        {
+            activeChain->positionableSource->setNextReadPosition (activeChain->loopSource->getPositionForSourcePosition (position));
+
+            if (activeChain->resamplerSource != nullptr)
+                activeChain->resamplerSource->reset();
+
+            inputStreamEOF = false;
+        }
+
+        // a newer seek may already be pending, which is applied next time
+        pendingPosition.compare_exchange_strong (position, (int64) -1);
+    }
+
+    void SRCAudioTransportSource::applyCommand (const Command& command)
+    {
+        switch (command.type)
+        {
+            case Command::startPlaying:
+                if (activeChain != nullptr && stopped)
+                {
+                    stopped = false;
+                    fadeOutRemaining = 0;
+                    inputStreamEOF = false;
+                    sendChangeMessage();
+                }
+                break;
+
+            case Command::stopPlaying:
+                if (! stopped)
+                {
+                    fadeOutLength = fadeOutRemaining = command.fadeLength;
+
+                    if (fadeOutLength == 0)
+                    {
+                        stopped = true;
+                        sendChangeMessage();
+                    }
+                }
+                break;
+
+            case Command::swapChain:
+            {
+                auto* newChain = command.chain;
+
+                // a chain is prepared for the current format before it's posted, see postPreparedChain()
+                jassert (newChain == nullptr || ! isPrepared
+                          || (newChain->preparedSampleRate == sampleRate && newChain->preparedBlockSize == blockSize));
+
+                // a crossfade that is still running is cut short
+                retireChain (outgoingChain);
+                outgoingChain = nullptr;
+
+                if (command.keepPlaying && command.fadeLength > 0 && ! stopped && activeChain != nullptr)
+                {
+                    outgoingChain = activeChain;
+                    crossfadeLength = crossfadeRemaining = command.fadeLength;
+                }
+                else
+                {
+                    retireChain (activeChain);
+                }
+
+                activeChain = newChain;
+                swappedInChain = newChain;
+                inputStreamEOF = false;
+
+                if (command.keepPlaying)
+                    break;
+
+                fadeOutRemaining = 0;
+
+                if (! stopped)
+                {
+                    stopped = true;
+                    sendChangeMessage();
+                }
+                break;
+            }
+
+            default:
+                jassertfalse;
+                break;
+        }
+    }
+
+    SRCAudioTransportSource::Chain* SRCAudioTransportSource::getLatestChain() const
+    {
+        // called with chainLock held, which keeps the chain from being deleted while it's used
+        auto* swappedIn = swappedInChain.load();
+
+        if (swappedIn != nullptr && swappedIn->generation > latestGeneration)
+        {
+            latestChain = swappedIn;
+            latestGeneration = swappedIn->generation;
+        }
+
+        return latestChain;
+    }
+
+    void SRCAudioTransportSource::prepareChain (Chain& chain)
+    {
+        // the format can change while this runs, so the chain records the one it was prepared for
+        const auto outputRate = sampleRate.load();
+        const auto outputBlockSize = blockSize.load();
+
+        if (chain.resamplerSource != nullptr && chain.sourceSampleRate > 0 && outputRate > 0)
+            chain.resamplerSource->setResamplingRatio (chain.sourceSampleRate / outputRate);
+
+        if (chain.bufferingSource != nullptr && chain.readAheadSeconds > 0 && outputRate > 0)
+        {
+            // the source is read at its own rate, which is the output rate when there's no conversion
+            const auto sourceRate = chain.sourceSampleRate > 0 ? chain.sourceSampleRate : outputRate;
+            const auto size = roundToInt (chain.readAheadSeconds * sourceRate);
+
+            chain.bufferingSource->setBufferSize (size);
+            chain.bufferingSource->setAdaptive (chain.adaptReadAhead, jmax (1, size / 4), size * 4);
+        }
+
+        // a scheduler times the buffer's refills by how fast it's played at the output
+        if (chain.bufferingSource != nullptr && outputRate > 0)
+            chain.bufferingSource->setPlaybackRate (outputRate, chain.getResamplingRatio());
+
+        chain.masterSource->prepareToPlay (outputBlockSize, outputRate);
+        chain.fadeBuffer.setSize (chain.numChannels, outputBlockSize, false, false, true);
+        chain.preparedSampleRate = outputRate;
+        chain.preparedBlockSize = outputBlockSize;
+    }
+
+    int SRCAudioTransportSource::useTimeSlice()
+    {
+        deleteRetiredChains();
+
+        const ScopedLock bl (backgroundLock);
+
+        if (chainBeingPrepared == nullptr)
+        {
+            {
+                const ScopedLock sl (preparationLock);
+                chainBeingPrepared.reset (chainToPrepare);
+                chainToPrepare = nullptr;
+                crossfadeBeingPrepared = crossfadeToPrepare;
+            }
+
+            // nothing to swap, so only look for retired chains now and then
+            if (chainBeingPrepared == nullptr)
+                return 50;
+
+            if (isPrepared)
+                prepareChain (*chainBeingPrepared);
+
+            preparationStartTime = Time::getMillisecondCounter();
+        }
+
+        auto& chain = *chainBeingPrepared;
+
+        // let the read-ahead fill as much as its own prepareToPlay() would wait for, so the first
+        // blocks after the swap don't starve, but give the thread to the other transports while
+        // it does
+        if (chain.bufferingSource != nullptr && chain.preparedSampleRate > 0
+             && ! chain.bufferingSource->isReadyToPlay()
+             && Time::getMillisecondCounter() - preparationStartTime < SRCReadAheadSource::getPrepareTimeoutMs())
+            return 5;
+
+        Command command;
+        command.type = Command::swapChain;
+        command.keepPlaying = true;
+        command.fadeLength = crossfadeBeingPrepared;
+        command.chain = &chain;
+
+        if (postPreparedChain (command, chain.generation))
+            chainBeingPrepared.release();
+        else
+            discardChainBeingPrepared(); // cancelled in the meantime
+
+        return 0;
+    }
+
+    void SRCAudioTransportSource::discardChainBeingPrepared()
+    {
+        // nothing else reads the source yet, so it can be released
+        if (chainBeingPrepared != nullptr && chainBeingPrepared->preparedSampleRate > 0)
+            chainBeingPrepared->masterSource->releaseResources();
+
+        chainBeingPrepared.reset();
+    }
+
+    bool SRCAudioTransportSource::postPreparedChain (const Command& command, const uint32 generation)
+    {
+        auto& chain = *command.chain;
+
+        for (;;)
+        {
+            {
+                // the format only changes under this lock, so a chain posted under it is
+                // played at the format it was prepared for
+                const ScopedLock sl (preparationLock);
+
+                if (generation != swapGeneration)
+                    return false;
+
+                if (! isPrepared || (chain.preparedSampleRate == sampleRate && chain.preparedBlockSize == blockSize))
+                {
+                    postCommand (command);
+                    return true;
+                }
+            }
+
+            // never prepared, or the device changed format while it was being prepared
+            prepareChain (chain);
+        }
     }
 
+    void SRCAudioTransportSource::detachChainsReading (PositionableAudioSource* const sourceToDetach)
+    {
+        // held throughout, so the detached chains can't be looked at while they're deleted
+        const ScopedLock cl (chainLock);
+        getLatestChain();
+
+        OwnedArray<Chain> detached;
+
+        {
+            const ScopedLock sl (callbackLock);
+            handlePendingCommands();
+
+            if (outgoingChain != nullptr && outgoingChain->source == sourceToDetach)
+            {
+                detached.add (outgoingChain);
+                outgoingChain = nullptr;
+            }
+
+            if (activeChain != nullptr && activeChain->source == sourceToDetach)
+            {
+                detached.add (activeChain);
+                activeChain = nullptr;
+                swappedInChain = nullptr;
+                fadeOutRemaining = 0;
+
+                if (! stopped)
+                {
+                    stopped = true;
+                    sendChangeMessage();
+                }
+            }
+        }
+
+        // chains the audio thread has already let go of may be reading it too
+        deleteRetiredChains();
+
+        for (auto* chain : detached)
+        {
+            if (latestChain == chain)
+                latestChain = nullptr;
+
+            if (chain->preparedSampleRate > 0)
+                chain->masterSource->releaseResources();
+        }
+    }
+
+    //==============================================================================
+    void SRCAudioTransportSource::retireChain (Chain* chain)
+    {
+        if (chain == nullptr)
+            return;
+
+        // the chain is linked into the list through itself, so this never allocates or runs
+        // out of room; the background thread deletes it within a few time slices
+        auto* head = retiredChains.load();
+
+        do
+        {
+            chain->nextRetired = head;
+        }
+        while (! retiredChains.compare_exchange_weak (head, chain));
+    }
+
+    void SRCAudioTransportSource::deleteRetiredChains()
+    {
+        // the background thread and a re-selecting caller can both get here, and a retired
+        // chain may still be the latest one until the chain that replaced it is picked up
+        const ScopedLock sl (chainLock);
+        getLatestChain();
+
+        for (auto* next = retiredChains.exchange (nullptr); next != nullptr;)
+        {
+            std::unique_ptr<Chain> chain (next);
+            next = chain->nextRetired;
+
+            // don't release a source that has been selected again
+            if (chain->source != source.load() && chain->preparedSampleRate > 0)
+                chain->masterSource->releaseResources();
+        }
+    }
+
+    //==============================================================================
     void SRCAudioTransportSource::prepareToPlay (int samplesPerBlockExpected, double newSampleRate)
     {
+        JUCE_SRC_TRACE_PREPARE (1)
+
+        // chains are posted under preparationLock, so none can arrive prepared for the old format
+        // after this; the ones already queued are swapped in first and prepared again below
+        const ScopedLock pl (preparationLock);
         const ScopedLock sl (callbackLock);
 
+        handlePendingCommands();
+
         sampleRate = newSampleRate;
         blockSize = samplesPerBlockExpected;
 
-        if (masterSource != nullptr)
-            masterSource->prepareToPlay (samplesPerBlockExpected, sampleRate);
+        if (activeChain != nullptr)
+            prepareChain (*activeChain);
 
-        if (resamplerSource != nullptr && sourceSampleRate > 0)
-            resamplerSource->setResamplingRatio (sourceSampleRate / sampleRate);
+        if (outgoingChain != nullptr)
+            prepareChain (*outgoingChain);
 
         inputStreamEOF = false;
         isPrepared = true;
@@ -228,10 +807,20 @@ namespace juce
 
     void SRCAudioTransportSource::releaseMasterResources()
     {
+        const ScopedLock pl (preparationLock);
         const ScopedLock sl (callbackLock);
 
-        if (masterSource != nullptr)
-            masterSource->releaseResources();
+        if (activeChain != nullptr)
+        {
+            activeChain->masterSource->releaseResources();
+            activeChain->preparedSampleRate = 0;
+        }
+
+        if (outgoingChain != nullptr)
+        {
+            outgoingChain->masterSource->releaseResources();
+            outgoingChain->preparedSampleRate = 0;
+        }
 
         isPrepared = false;
     }
@@ -243,32 +832,53 @@ namespace juce
 
     void SRCAudioTransportSource::getNextAudioBlock (const AudioSourceChannelInfo& info)
     {
+        JUCE_SRC_TRACE_SPAN (blockSpan, "SRCAudioTransportSource::getNextAudioBlock", traceStreamId)
         const ScopedLock sl (callbackLock);
 
-        if (masterSource != nullptr && ! stopped)
+        handlePendingCommands();
+
+        if (activeChain != nullptr && ! stopped)
         {
-            masterSource->getNextAudioBlock (info);
+            JUCE_SRC_TRACE_FRAMES (blockSpan, roundToInt (info.numSamples * activeChain->getResamplingRatio()),
+                                   info.numSamples, activeChain->getResamplingRatio())
+
+            activeChain->masterSource->getNextAudioBlock (info);
+
+            if (outgoingChain != nullptr)
+                mixOutgoingChain (info);
 
-            if (! playing)
+            if (fadeOutRemaining > 0)
             {
-                // just stopped playing, so fade out the last block..
+                // stopping, so fade out and clear whatever comes after the fade
+                const auto numToFade = jmin (fadeOutRemaining, info.numSamples);
+                const auto startGain = fadeOutRemaining / (float) fadeOutLength;
+                fadeOutRemaining -= numToFade;
+                const auto endGain = fadeOutRemaining / (float) fadeOutLength;
+
                 for (int i = info.buffer->getNumChannels(); --i >= 0;)
-                    info.buffer->applyGainRamp (i, info.startSample, jmin (256, info.numSamples), 1.0f, 0.0f);
+                    info.buffer->applyGainRamp (i, info.startSample, numToFade, startGain, endGain);
+
+                if (info.numSamples > numToFade)
+                    info.buffer->clear (info.startSample + numToFade, info.numSamples - numToFade);
 
-                if (info.numSamples > 256)
-                    info.buffer->clear (info.startSample + 256, info.numSamples - 256);
+                if (fadeOutRemaining == 0)
+                {
+                    stopped = true;
+                    sendChangeMessage();
+                }
             }
 
+            auto* positionableSource = activeChain->positionableSource;
+
             if (positionableSource->getNextReadPosition() > positionableSource->getTotalLength() + 1
                 && ! positionableSource->isLooping())
             {
                 playing = false;
+                stopped = true;
                 inputStreamEOF = true;
                 sendChangeMessage();
             }
 
-            stopped = ! playing;
-
             for (int i = info.buffer->getNumChannels(); --i >= 0;)
                 info.buffer->applyGainRamp (i, info.startSample, info.numSamples, lastGain, gain);
         }
@@ -278,8 +888,53 @@ namespace juce
             stopped = true;
         }
 
+        if (stopped && outgoingChain != nullptr)
+        {
+            retireChain (outgoingChain);
+            outgoingChain = nullptr;
+        }
+
         lastGain = gain;
     }
 
-} // namespace juce
+    void SRCAudioTransportSource::mixOutgoingChain (const AudioSourceChannelInfo& info)
+    {
+        auto& fadeBuffer = outgoingChain->fadeBuffer;
+        const auto numChannels = info.buffer->getNumChannels();
+        const auto numFadeChannels = jmin (numChannels, fadeBuffer.getNumChannels());
+
+        // fadeBuffer holds a prepared block, so longer blocks are faded in several goes
+        for (int done = 0; done < info.numSamples && crossfadeRemaining > 0;)
+        {
+            const auto numThisTime = jmin (info.numSamples - done, fadeBuffer.getNumSamples(), crossfadeRemaining);
+
+            if (numThisTime <= 0)
+                break;
+
+            AudioSourceChannelInfo fadeInfo (&fadeBuffer, 0, numThisTime);
+            outgoingChain->masterSource->getNextAudioBlock (fadeInfo);
 
+            const auto startGain = crossfadeRemaining / (float) crossfadeLength;
+            crossfadeRemaining -= numThisTime;
+            const auto endGain = crossfadeRemaining / (float) crossfadeLength;
+
+            for (int i = numChannels; --i >= 0;)
+            {
+                info.buffer->applyGainRamp (i, info.startSample + done, numThisTime, 1.0f - startGain, 1.0f - endGain);
+
+                if (i < numFadeChannels)
+                    info.buffer->addFromWithRamp (i, info.startSample + done, fadeBuffer.getReadPointer (i),
+                                                  numThisTime, startGain, endGain);
+            }
+
+            done += numThisTime;
+        }
+
+        if (crossfadeRemaining <= 0 || fadeBuffer.getNumSamples() == 0)
+        {
+            retireChain (outgoingChain);
+            outgoingChain = nullptr;
+        }
+    }
+
+} // namespace juce
@@ -35,12 +35,24 @@ It will 'correct' different sample-rates.
 You may want to use one of these along with an AudioSourcePlayer and AudioIODevice
 to control playback of an audio file.
 
+Unlike AudioTransportSource, the transport controls never wait for the audio thread.
+start(), stop() and setSource() post a command to a lock-free queue that the audio thread
+drains at the start of each block, and a change message is sent once a start or stop has
+actually taken effect. setPosition() and setGain() only leave the newest value for the
+audio thread to pick up at the start of its next block.
+
+swapSource() changes the source without stopping: the new chain of sources is prepared
+and its read-ahead buffer filled on a background thread, and the audio thread switches to
+it at a block boundary, optionally crossfading from the old one. Replaced chains are
+released and deleted on that same background thread, which all transports share.
+
 @see AudioTransportSource, AudioSource, AudioSourcePlayer
 
 @tags{Audio}
 */
 class SRCAudioTransportSource  : public PositionableAudioSource,
-public ChangeBroadcaster
+public ChangeBroadcaster,
+private TimeSliceClient
 {
 public:
 
@@ -59,14 +71,22 @@ SRCAudioTransportSource();
 
 This will stop playback, reset the position to 0 and change to the new reader.
 
+The new chain of sources is created and prepared on the calling thread, and the audio
+thread switches to it at the start of its next block. The previous chain is released
+and deleted later on a background thread, never on the audio thread.
+
+A chain that is still reading the new source, such as the one playing it or one
+swapSource() is crossfading from, is stopped and released first, so this waits for
+the audio thread to finish its current block.
+
 The source passed in will not be deleted by this object, so must be managed by
 the caller.
 
 @param newSource                        the new input source to use. This may be a nullptr
 @param readAheadBufferSize              a size of buffer to use for reading ahead. If this
 is zero, no reading ahead will be done; if it's
-greater than zero, a BufferingAudioSource will be used
-to do the reading-ahead. If you set a non-zero value here,
+greater than zero, an SRCReadAheadSource will be used
+to do the reading-ahead. setReadAheadTime() overrides it. If you set a non-zero value here,
 you'll also need to set the readAheadThread parameter.
 @param readAheadThread                  if you set readAheadBufferSize to a non-zero value, then
 you'll also need to supply this TimeSliceThread object for
@@ -75,7 +95,9 @@ deleted while the AudioTransport source is still using it.
 @param sourceSampleRateToCorrectFor     if this is non-zero, it specifies the sample
 rate of the source, and playback will be sample-rate
 adjusted to maintain playback at the correct pitch. If
-this is 0, no sample-rate adjustment will be performed
+this is 0, no sample-rate adjustment will be performed.
+While it matches the device's rate, the audio is passed
+straight through, see SRCAudioSource::setBypassesUnityRatio
 @param srcQuality     quality / type of sample rate conversion of libsamplerate.
 @param maxNumChannels                   the maximum number of channels that may need to be played
 */
@@ -85,6 +107,81 @@ TimeSliceThread* readAheadThread = nullptr,
                 double sourceSampleRateToCorrectFor = 0.0, ResamplerQuality srcQuality = ResamplerQuality::SRC_SINC_MEDIUM_QUALITY,
 int maxNumChannels = 2);
 
+/** Changes the input source without interrupting playback.
+
+Unlike setSource(), this returns before the new source is used. The new chain of
+sources is prepared on a background thread, which also waits for its read-ahead
+buffer to fill, and only then does the audio thread switch to it, at the start of a
+block. If the transport is playing, it keeps playing from startTimeInSeconds in the
+new source, crossfading from the old source over crossfadeLengthInSamples.
+
+Calling this again before a pending swap has happened replaces the pending swap.
+Swapping back to the source that an earlier swap is still crossfading from cuts that
+crossfade short.
+
+newSource must not be the source that is currently playing, as it can't be read
+from two positions at once; use setPosition() for that.
+
+@param crossfadeLengthInSamples         the length of the crossfade, at the output
+sample-rate. If this is 0, the sources are
+switched without fading.
+@param startTimeInSeconds               the position in newSource to start playing from
+
+@see setSource
+*/
+void swapSource (PositionableAudioSource* newSource,
+int readAheadBufferSize = 0,
+TimeSliceThread* readAheadThread = nullptr,
+                 double sourceSampleRateToCorrectFor = 0.0, ResamplerQuality srcQuality = ResamplerQuality::SRC_SINC_MEDIUM_QUALITY,
+int maxNumChannels = 2,
+int crossfadeLengthInSamples = 512,
+double startTimeInSeconds = 0.0);
+
+/** Sizes the read-ahead of the sources selected from now on in seconds of playback.
+
+The size in samples of the source is worked out from the output sample-rate and the
+conversion ratio when the source is prepared, so the same time is buffered whatever
+the rates are. This replaces the readAheadBufferSize given to setSource() and
+swapSource(), which still need a readAheadThread.
+
+@param secondsOfPlayback    the time to read ahead, or 0 to use readAheadBufferSize again
+@param adaptToThroughput    if true, the buffer grows after underruns and shrinks while it
+stays well filled, between a quarter and four times the given time
+@param budget               if not nullptr, a memory limit shared with other read-ahead
+buffers. It must outlive this object.
+*/
+void setReadAheadTime (double secondsOfPlayback, bool adaptToThroughput = false,
+                       SRCReadAheadSource::Budget* budget = nullptr);
+
+/** Reads ahead for the sources selected from now on with a scheduler shared by many
+transports, instead of the readAheadThread given to setSource() and swapSource().
+
+The scheduler refills whichever of its buffers is closest to running out, timed at
+the output rate through this transport's conversion ratio.
+
+@param scheduler    the scheduler to use, or nullptr to use the readAheadThread again.
+It must outlive this object.
+@param readGroup    if not empty, a name shared by the buffers whose reads are batched,
+such as the path of the file being played
+*/
+void setReadAheadScheduler (SRCReadAheadScheduler* scheduler, const String& readGroup = {});
+
+/** Chooses the coefficients the sinc qualities are converted with, for the sources
+selected from now on. SRCCoefficientTable::minimumPhase cuts the latency of the
+conversion to a few samples, for live monitoring.
+
+@see SRCAudioSource, getLatencyInSeconds
+*/
+void setResamplerLayout (SRCCoefficientTable::Layout layout);
+
+/** Returns how late the current source's conversion plays it, in seconds. Only the
+SRCCoefficientTable::minimumPhase layout delays it.
+*/
+double getLatencyInSeconds() const;
+
+/** Returns the statistics of the current source's read-ahead buffer, if it has one. */
+SRCReadAheadSource::Statistics getReadAheadStatistics() const;
+
 //==============================================================================
 /** Changes the current playback position in the source stream.
 
@@ -108,22 +205,39 @@ double getLengthInSeconds() const;
 /** Returns true if the player has stopped because its input stream ran out of data. */
 bool hasStreamFinished() const noexcept             { return inputStreamEOF; }
 
+//==============================================================================
+/** Loops a region of the source, given in samples of the source.
+
+The converter is fed one continuous stream across the loop point, and the loop start
+is read ahead like any other audio, so looping doesn't click or reset the converter.
+Changing the region while playing takes effect after the audio that has already been
+read ahead. The region belongs to the current source, so setSource() and swapSource()
+start without one.
+*/
+void setLoopRegion (int64 loopStartInSourceSamples, int64 loopEndInSourceSamples);
+
+/** Stops looping, playback carries on to the end of the source. */
+void clearLoopRegion();
+
+/** Returns the loop region in samples of the source, or an empty range if there is none. */
+Range<int64> getLoopRegion() const;
+
 //==============================================================================
 /** Starts playing (if a source has been selected).
 
-If it starts playing, this will send a message to any ChangeListeners
-that are registered with this object.
+This returns immediately. Once the audio thread has started playing, a message
+will be sent to any ChangeListeners that are registered with this object.
 */
 void start();
 
-/** Stops playing.
+/** Stops playing, fading out over the given number of samples.
 
-If it's actually playing, this will send a message to any ChangeListeners
-that are registered with this object.
+This returns immediately. Once the fade-out has ended on the audio thread, a
+message will be sent to any ChangeListeners that are registered with this object.
 */
-void stop();
+void stop (int fadeOutLengthInSamples = 256);
 
-/** Returns true if it's currently playing. */
+/** Returns true if it's currently playing, or has been asked to start playing. */
 bool isPlaying() const noexcept     { return playing; }
 
 //==============================================================================
@@ -136,7 +250,7 @@ void setGain (float newGain) noexcept;
 /** Returns the current gain setting.
 @see setGain
 */
-float getGain() const noexcept      { return gain; }
+float getGain() const noexcept      { return requestedGain; }
 
 //==============================================================================
 /** Implementation of the AudioSource method. */
@@ -163,19 +277,130 @@ bool isLooping() const override;
 
 private:
 //==============================================================================
-PositionableAudioSource* source = nullptr;
-SRCAudioSource* resamplerSource = nullptr;
-BufferingAudioSource* bufferingSource = nullptr;
-PositionableAudioSource* positionableSource = nullptr;
-AudioSource* masterSource = nullptr;
+/** The sources created for one input source. A chain is swapped in and retired as a whole. */
+struct Chain
+{
+    PositionableAudioSource* source = nullptr;
+    std::unique_ptr<SRCLoopRegionSource> loopSource;
+    std::unique_ptr<SRCReadAheadSource> bufferingSource;
+    std::unique_ptr<SRCAudioSource> resamplerSource;
+    PositionableAudioSource* positionableSource = nullptr;
+    AudioSource* masterSource = nullptr;
+    double sourceSampleRate = 0, preparedSampleRate = 0;
+    int preparedBlockSize = 0, numChannels = 0;
+    uint32 generation = 0; // the swapGeneration it was created in, so newer chains have higher ones
+    double readAheadSeconds = 0; // if set, the read-ahead is sized from this once the output rate is known
+    bool adaptReadAhead = false;
+
+    // the chain renders into this while it is being crossfaded out
+    AudioBuffer<float> fadeBuffer;
+
+    Chain* nextRetired = nullptr; // links the chains waiting to be deleted
+
+    double getResamplingRatio() const   { return resamplerSource != nullptr ? resamplerSource->getResamplingRatio() : 1.0; }
+};
 
-CriticalSection callbackLock;
+/** The thread that prepares chains for swapSource() and deletes retired chains, away
+    from both the calling thread and the audio thread. One is shared by all transports. */
+class BackgroundThread  : public TimeSliceThread
+{
+public:
+    BackgroundThread()  : TimeSliceThread ("SRC transport")   { startThread(); }
+    ~BackgroundThread() override                              { stopThread (4000); }
+};
+
+struct Command
+{
+    enum Type
+    {
+        startPlaying,
+        stopPlaying,
+        swapChain
+    };
+
+    Type type = startPlaying;
+    int fadeLength = 0;
+    bool keepPlaying = false;
+    Chain* chain = nullptr;
+};
+
+//==============================================================================
+// State owned by the calling (message) thread
+std::atomic<PositionableAudioSource*> source { nullptr };
+double readAheadSeconds = 0;
+bool adaptReadAhead = false;
+SRCReadAheadSource::Budget* readAheadBudget = nullptr;
+SRCReadAheadScheduler* readAheadScheduler = nullptr;
+SRCCoefficientTable::Layout resamplerLayout = SRCCoefficientTable::original;
+String readAheadGroup;
+std::atomic<float> requestedGain { 1.0f };
+std::atomic<int64> pendingPosition { -1 };
+
+// A chain waiting to be prepared by the background thread, and the swap it belongs to.
+// The device format and isPrepared only change under this lock too.
+CriticalSection preparationLock;
+Chain* chainToPrepare = nullptr;
+int crossfadeToPrepare = 0;
+uint32 swapGeneration = 0;
+
+// The swap the background thread is preparing. Cancelling a swap takes this lock to
+// discard it, so it waits for a preparation step that's under way.
+CriticalSection backgroundLock;
+std::unique_ptr<Chain> chainBeingPrepared;
+int crossfadeBeingPrepared = 0;
+uint32 preparationStartTime = 0;
+
+// The newest chain the caller has selected, or that the audio thread has swapped in. A chain
+// swapped in by swapSource() becomes the latest one once the audio thread has picked it up,
+// see getLatestChain(). Retired chains are only deleted under this lock too.
+CriticalSection chainLock;
+mutable Chain* latestChain = nullptr;
+mutable uint32 latestGeneration = 0;
+
+// State owned by the audio thread
+Chain* activeChain = nullptr;
+Chain* outgoingChain = nullptr;
 float gain = 1.0f, lastGain = 1.0f;
-std::atomic<bool> playing { false }, stopped { true };
-double sampleRate = 44100.0, sourceSampleRate = 0;
-int blockSize = 128, readAheadBufferSize = 0;
-bool isPrepared = false, inputStreamEOF = false;
+int fadeOutRemaining = 0, fadeOutLength = 0;
+int crossfadeRemaining = 0, crossfadeLength = 0;
+bool stopped = true;
+std::atomic<Chain*> swappedInChain { nullptr };
+
+std::atomic<bool> playing { false }, inputStreamEOF { false }, isPrepared { false };
+std::atomic<double> sampleRate { 44100.0 };
+std::atomic<int> blockSize { 128 };
+
+CriticalSection callbackLock;
 
+#if JUCE_LIBSAMPLERATE_TRACING
+const uint32 traceStreamId = SRCTrace::createStreamId();
+#endif
+
+enum { commandQueueSize = 64 };
+AbstractFifo commandFifo { commandQueueSize };
+Command commands[commandQueueSize];
+SpinLock commandWriteLock;
+std::atomic<Chain*> retiredChains { nullptr }; // the audio thread pushes, deleteRetiredChains() takes them all
+
+SharedResourcePointer<BackgroundThread> backgroundThread;
+
+void postCommand (const Command&);
+void handlePendingCommands();
+void handlePendingCommandsIfUnprepared();
+void applyPendingPosition();
+void applyCommand (const Command&);
+Chain* createChain (PositionableAudioSource*, int readAheadSize, TimeSliceThread*,
+                    double sourceSampleRateToCorrectFor, ResamplerQuality, int maxNumChannels);
+void cancelPendingSwap();
+Chain* getLatestChain() const;
+void prepareChain (Chain&);
+int useTimeSlice() override;
+void discardChainBeingPrepared();
+bool postPreparedChain (const Command&, uint32 generation);
+void detachChainsReading (PositionableAudioSource*);
+void retireChain (Chain*);
+void deleteRetiredChains();
+void mixOutgoingChain (const AudioSourceChannelInfo&);
 void releaseMasterResources();
 
 JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SRCAudioTransportSource)
@@ -0,0 +1,176 @@
+/*
+ ==============================================================================
+ Copyright (c) 2019, Tal Aviram
+ All rights reserved.
+
+ This code is released under 2-clause BSD license. Please see the
+ file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#include "SRCChannelWorkerPool.h"
+
+namespace juce
+{
+
+namespace SRCChannelWorkerPoolHelpers
+{
+    // a task index no job reaches, stored once a job is over so nothing can be claimed from it
+    static constexpr uint32 closedIndex = 0xffffffff;
+
+    static uint64 getGeneration (const uint64 state) noexcept      { return state >> 32; }
+    static uint32 getNextIndex (const uint64 state) noexcept       { return (uint32) (state & 0xffffffff); }
+}
+
+//==============================================================================
+class SRCChannelWorkerPool::Worker  : public Thread
+{
+public:
+    Worker (SRCChannelWorkerPool& p, const int index)
+        : Thread ("SRC worker " + String (index)),
+          pool (p)
+    {
+       #if JUCE_VERSION >= 0x70003
+        startRealtimeThread (RealtimeOptions());
+       #else
+        startThread (10);
+       #endif
+    }
+
+    ~Worker() override
+    {
+        signalThreadShouldExit();
+        wakeEvent.signal();
+        stopThread (1000);
+    }
+
+    void run() override
+    {
+        auto lastActive = Time::getHighResolutionTicks();
+
+        while (! threadShouldExit())
+        {
+            const auto generation = SRCChannelWorkerPoolHelpers::getGeneration (pool.state.load (std::memory_order_acquire));
+
+            if (pool.runClaimedTasks (generation))
+            {
+                lastActive = Time::getHighResolutionTicks();
+                continue;
+            }
+
+            if (Time::getHighResolutionTicks() - lastActive < pool.spinTicks)
+            {
+                Thread::yield();
+                continue;
+            }
+
+            // announced before looking for work once more, so a job published meanwhile
+            // either shows up here or sees the flag and signals
+            sleeping = true;
+
+            if (! pool.hasOpenJob())
+                wakeEvent.wait (100);
+
+            sleeping = false;
+            lastActive = Time::getHighResolutionTicks();
+        }
+    }
+
+    std::atomic<bool> sleeping { false };
+    WaitableEvent wakeEvent;
+
+private:
+    SRCChannelWorkerPool& pool;
+
+    JUCE_DECLARE_NON_COPYABLE (Worker)
+};
+
+//==============================================================================
+SRCChannelWorkerPool::SRCChannelWorkerPool (const int numWorkers, const double spinTimeMs)
+    : spinTicks (Time::secondsToHighResolutionTicks (spinTimeMs * 0.001))
+{
+    state = SRCChannelWorkerPoolHelpers::closedIndex;
+
+    for (auto i = 0; i < numWorkers; ++i)
+        workers.add (new Worker (*this, i + 1));
+}
+
+SRCChannelWorkerPool::~SRCChannelWorkerPool()
+{
+    workers.clear();
+}
+
+//==============================================================================
+void SRCChannelWorkerPool::run (const int numTasks, void (*task) (void*, int), void* context) noexcept
+{
+    using namespace SRCChannelWorkerPoolHelpers;
+
+    if (numTasks <= 0)
+        return;
+
+    // with nobody to share with, or the workers busy with another caller's job
+    if (workers.isEmpty() || numTasks == 1 || inUse.exchange (true, std::memory_order_acquire))
+    {
+        for (auto i = 0; i < numTasks; ++i)
+            task (context, i);
+
+        return;
+    }
+
+    const auto generation = getGeneration (state.load (std::memory_order_relaxed)) + 1;
+
+    jobTask.store (task, std::memory_order_relaxed);
+    jobContext.store (context, std::memory_order_relaxed);
+    jobNumTasks.store (numTasks, std::memory_order_relaxed);
+    numDone.store (0, std::memory_order_relaxed);
+    state = generation << 32;
+
+    for (auto* worker : workers)
+        if (worker->sleeping)
+            worker->wakeEvent.signal();
+
+    runClaimedTasks (generation);
+
+    // only tasks a worker has already started are left
+    while (numDone.load (std::memory_order_acquire) < numTasks)
+    {}
+
+    state = (generation << 32) | closedIndex;
+    inUse.store (false, std::memory_order_release);
+}
+
+bool SRCChannelWorkerPool::runClaimedTasks (const uint64 generation) noexcept
+{
+    using namespace SRCChannelWorkerPoolHelpers;
+
+    auto ranAny = false;
+
+    for (;;)
+    {
+        auto current = state.load (std::memory_order_acquire);
+        const auto index = getNextIndex (current);
+
+        if (getGeneration (current) != generation || index >= (uint32) jobNumTasks.load (std::memory_order_relaxed))
+            return ranAny;
+
+        auto* task = jobTask.load (std::memory_order_relaxed);
+        auto* context = jobContext.load (std::memory_order_relaxed);
+
+        // the job's fields are only rewritten after it's closed, which changes the state,
+        // so a successful claim means they belonged to it
+        if (! state.compare_exchange_weak (current, current + 1, std::memory_order_acq_rel))
+            continue;
+
+        task (context, (int) index);
+        numDone.fetch_add (1, std::memory_order_release);
+        ranAny = true;
+    }
+}
+
+bool SRCChannelWorkerPool::hasOpenJob() const noexcept
+{
+    const auto current = state.load();
+    return SRCChannelWorkerPoolHelpers::getNextIndex (current) < (uint32) jobNumTasks.load (std::memory_order_relaxed);
+}
+
+} // namespace juce
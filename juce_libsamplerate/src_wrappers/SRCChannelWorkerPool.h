@@ -0,0 +1,86 @@
+/*
+ ==============================================================================
+    Copyright (c) 2019, Tal Aviram
+    All rights reserved.
+
+    This code is released under 2-clause BSD license. Please see the
+    file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#pragma once
+
+namespace juce
+{
+
+//==============================================================================
+/**
+ A small pool of realtime threads that an audio callback can split work across, such as
+ the channel groups of an SRCAudioSource with many channels.
+
+ run() is a fork/join without locks: it publishes the tasks through a single atomic,
+ then the calling thread and the workers claim them one at a time until none are left,
+ and the call returns once every claimed task has finished. As the calling thread takes
+ tasks too, a block never waits for a worker to wake up; a worker that is late just
+ finds nothing left to claim.
+
+ After a job, the workers spin for a short while so the next block finds them awake,
+ and then sleep until run() wakes them. Only one run() can use the workers at a time;
+ a run() that finds them busy with another caller's job does all its tasks itself.
+
+ @see SRCAudioSource::setChannelWorkerPool
+
+ @tags{Audio}
+ */
+class SRCChannelWorkerPool
+{
+public:
+    //==============================================================================
+    /** Starts the worker threads.
+
+     @param numWorkers       the number of threads besides the calling one, usually the
+                             number of cores minus one
+     @param spinTimeMs       how long a worker stays awake after a job
+     */
+    explicit SRCChannelWorkerPool (int numWorkers, double spinTimeMs = 2.0);
+
+    /** Destructor. Stops the worker threads. */
+    ~SRCChannelWorkerPool();
+
+    /** Returns the number of worker threads. */
+    int getNumWorkers() const noexcept                      { return workers.size(); }
+
+    //==============================================================================
+    /** Runs task (context, index) for every index from 0 to numTasks - 1, on the calling
+        thread and the workers, and returns once all of them have finished.
+     */
+    void run (int numTasks, void (*task) (void* context, int index), void* context) noexcept;
+
+    /** Runs fn (index) for every index from 0 to numTasks - 1, as run() does. */
+    template <typename TaskFunction>
+    void runEach (int numTasks, TaskFunction& fn) noexcept
+    {
+        run (numTasks, [] (void* context, int index) { (*static_cast<TaskFunction*> (context)) (index); }, &fn);
+    }
+
+private:
+    //==============================================================================
+    class Worker;
+
+    bool runClaimedTasks (uint64 generation) noexcept;
+    bool hasOpenJob() const noexcept;
+
+    // the generation of the job in the high half, the next task to claim in the low half
+    std::atomic<uint64> state { 0 };
+    std::atomic<void (*) (void*, int)> jobTask { nullptr };
+    std::atomic<void*> jobContext { nullptr };
+    std::atomic<int> jobNumTasks { 0 }, numDone { 0 };
+    std::atomic<bool> inUse { false };
+
+    const int64 spinTicks;
+    OwnedArray<Worker> workers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SRCChannelWorkerPool)
+};
+
+} // namespace juce
@@ -0,0 +1,354 @@
+/*
+ ==============================================================================
+ Copyright (c) 2019, Tal Aviram
+ All rights reserved.
+
+ This code is released under 2-clause BSD license. Please see the
+ file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#include "SRCDeviceRateAdapter.h"
+
+#if JUCE_MODULE_AVAILABLE_juce_audio_devices
+
+namespace juce
+{
+
+//==============================================================================
+/** One direction of the conversion, at a fixed ratio. */
+class SRCDeviceRateAdapter::Converter
+{
+public:
+    Converter (const ResamplerQuality quality, const int numChannels, const double ratio)
+        : samplesInPerOutputSample (ratio)
+    {
+        if (SRCFastInterpolator::supportsQuality (quality))
+        {
+            fastInterpolator.reset (new SRCFastInterpolator (quality, numChannels));
+            fastInterpolator->setResamplingRatio (ratio);
+            reach = 2;
+        }
+        else
+        {
+            sincConverter.reset (new SRCSincConverter (SRCCoefficientTable::getTable (quality, SRCCoefficientTable::exactHalfTable),
+                                                       numChannels, ratio));
+            sincConverter->setResamplingRatio (ratio);
+
+            // the input frames an output reaches ahead over, which widens when downsampling
+            const auto& table = SRCCoefficientTable::getTable (quality, SRCCoefficientTable::original);
+            reach = (int) std::ceil ((table.getHalfLength() / table.getIncrement() + 2) * jmax (1.0, ratio));
+        }
+    }
+
+    int process (const float* const* input, const int numInputFrames,
+                 float* const* output, const int numOutputFrames, int& inputFramesUsed) noexcept
+    {
+        if (fastInterpolator != nullptr)
+            return fastInterpolator->process (input, numInputFrames, output, numOutputFrames,
+                                              samplesInPerOutputSample, inputFramesUsed);
+
+        return sincConverter->process (input, numInputFrames, output, numOutputFrames,
+                                       samplesInPerOutputSample, inputFramesUsed);
+    }
+
+    /** Returns the number of input frames held back before an output can be made. */
+    int getReach() const noexcept               { return reach; }
+
+private:
+    const double samplesInPerOutputSample;
+    std::unique_ptr<SRCSincConverter> sincConverter;
+    std::unique_ptr<SRCFastInterpolator> fastInterpolator;
+    int reach = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (Converter)
+};
+
+//==============================================================================
+/** The device as the wrapped callback sees it: at the internal rate and block size. */
+class SRCDeviceRateAdapter::InternalDevice  : public AudioIODevice
+{
+public:
+    InternalDevice (AudioIODevice& d, const SRCDeviceRateAdapter& a)
+        : AudioIODevice (d.getName(), d.getTypeName()),
+          device (d),
+          adapter (a)
+    {
+    }
+
+    StringArray getOutputChannelNames() override            { return device.getOutputChannelNames(); }
+    StringArray getInputChannelNames() override             { return device.getInputChannelNames(); }
+    Array<double> getAvailableSampleRates() override        { return { adapter.internalSampleRate }; }
+    Array<int> getAvailableBufferSizes() override           { return { adapter.internalBlockSize }; }
+    int getDefaultBufferSize() override                     { return adapter.internalBlockSize; }
+
+    String open (const BigInteger&, const BigInteger&, double, int) override
+    {
+        jassertfalse; // open the real device instead
+        return "The device can't be opened through SRCDeviceRateAdapter";
+    }
+
+    void close() override                                   {}
+    bool isOpen() override                                  { return device.isOpen(); }
+    void start (AudioIODeviceCallback*) override            { jassertfalse; }
+    void stop() override                                    {}
+    bool isPlaying() override                               { return device.isPlaying(); }
+    String getLastError() override                          { return device.getLastError(); }
+
+    int getCurrentBufferSizeSamples() override              { return adapter.internalBlockSize; }
+    double getCurrentSampleRate() override                  { return adapter.internalSampleRate; }
+    int getCurrentBitDepth() override                       { return device.getCurrentBitDepth(); }
+    BigInteger getActiveOutputChannels() const override     { return device.getActiveOutputChannels(); }
+    BigInteger getActiveInputChannels() const override      { return device.getActiveInputChannels(); }
+
+    int getOutputLatencyInSamples() override                { return toInternalRate (device.getOutputLatencyInSamples()); }
+    int getInputLatencyInSamples() override                 { return toInternalRate (device.getInputLatencyInSamples()) + adapter.latency; }
+
+private:
+    int toInternalRate (const int deviceSamples)
+    {
+        return roundToInt (deviceSamples * adapter.internalSampleRate / device.getCurrentSampleRate());
+    }
+
+    AudioIODevice& device;
+    const SRCDeviceRateAdapter& adapter;
+
+    JUCE_DECLARE_NON_COPYABLE (InternalDevice)
+};
+
+//==============================================================================
+SRCDeviceRateAdapter::SRCDeviceRateAdapter (AudioIODeviceCallback* const callbackToWrap,
+                                            const double internalRate,
+                                            const ResamplerQuality q)
+    : callback (callbackToWrap),
+      internalSampleRate (internalRate),
+      quality (q)
+{
+    jassert (callback != nullptr && internalSampleRate > 0);
+}
+
+SRCDeviceRateAdapter::~SRCDeviceRateAdapter()
+{
+}
+
+//==============================================================================
+void SRCDeviceRateAdapter::audioDeviceAboutToStart (AudioIODevice* const device)
+{
+    const auto deviceSampleRate = device->getCurrentSampleRate();
+    const auto deviceBlockSize = jmax (1, device->getCurrentBufferSizeSamples());
+
+    converting = deviceSampleRate > 0 && deviceSampleRate != internalSampleRate;
+    inputConverter.reset();
+    outputConverter.reset();
+    internalDevice.reset();
+    numInputQueued = numOutputQueued = latency = 0;
+    numUnderruns = 0;
+
+    if (! converting)
+    {
+        internalBlockSize = deviceBlockSize;
+        callback->audioDeviceAboutToStart (device);
+        return;
+    }
+
+    // device frames per internal frame
+    const auto ratio = deviceSampleRate / internalSampleRate;
+
+    numInputs = device->getActiveInputChannels().countNumberOfSetBits();
+    numOutputs = device->getActiveOutputChannels().countNumberOfSetBits();
+    internalBlockSize = (int) std::ceil (deviceBlockSize / ratio);
+
+    if (numInputs > 0)
+        inputConverter.reset (new Converter (quality, numInputs, ratio));
+
+    if (numOutputs > 0)
+        outputConverter.reset (new Converter (quality, numOutputs, 1.0 / ratio));
+
+    // the callback may have to run a block before the input converter has given out the
+    // input for it, and the output converter holds on to some of the callback's output
+    if (inputConverter != nullptr && outputConverter != nullptr)
+        latency = internalBlockSize + (int) std::ceil (inputConverter->getReach() / ratio) + outputConverter->getReach() + 2;
+
+    const auto maxInputPerBlock = (int) std::ceil (deviceBlockSize / ratio) + 2;
+    const auto outputReach = outputConverter != nullptr ? outputConverter->getReach() : 0;
+    inputQueue.setSize (jmax (1, numInputs), latency + 2 * (maxInputPerBlock + internalBlockSize) + 64);
+    outputQueue.setSize (jmax (1, numOutputs), 2 * internalBlockSize + outputReach + 64);
+    callbackInput.setSize (jmax (1, numInputs), internalBlockSize);
+    callbackOutput.setSize (jmax (1, numOutputs), internalBlockSize);
+    silence.setSize (1, deviceBlockSize);
+    inputQueue.clear();
+    silence.clear();
+
+    readPointers.malloc ((size_t) jmax (1, numInputs, numOutputs));
+    writePointers.malloc ((size_t) jmax (1, numInputs, numOutputs));
+
+    numInputQueued = latency;
+
+    internalDevice.reset (new InternalDevice (*device, *this));
+    callback->audioDeviceAboutToStart (internalDevice.get());
+}
+
+void SRCDeviceRateAdapter::audioDeviceStopped()
+{
+    callback->audioDeviceStopped();
+}
+
+void SRCDeviceRateAdapter::audioDeviceError (const String& errorMessage)
+{
+    callback->audioDeviceError (errorMessage);
+}
+
+#if JUCE_VERSION >= 0x70003
+void SRCDeviceRateAdapter::audioDeviceIOCallbackWithContext (const float* const* inputChannelData, const int numInputChannels,
+                                                             float* const* outputChannelData, const int numOutputChannels,
+                                                             const int numSamples, const AudioIODeviceCallbackContext& context)
+{
+    if (! converting)
+    {
+        callback->audioDeviceIOCallbackWithContext (inputChannelData, numInputChannels, outputChannelData,
+                                                    numOutputChannels, numSamples, context);
+        return;
+    }
+
+    process (inputChannelData, numInputChannels, outputChannelData, numOutputChannels, numSamples);
+}
+#else
+void SRCDeviceRateAdapter::audioDeviceIOCallback (const float** inputChannelData, const int numInputChannels,
+                                                  float** outputChannelData, const int numOutputChannels, const int numSamples)
+{
+    if (! converting)
+    {
+        callback->audioDeviceIOCallback (inputChannelData, numInputChannels, outputChannelData, numOutputChannels, numSamples);
+        return;
+    }
+
+    process (inputChannelData, numInputChannels, outputChannelData, numOutputChannels, numSamples);
+}
+#endif
+
+//==============================================================================
+void SRCDeviceRateAdapter::process (const float* const* inputChannelData, const int numInputChannels,
+                                    float* const* outputChannelData, const int numOutputChannels, const int numSamples)
+{
+    queueInput (inputChannelData, numInputChannels, numSamples);
+
+    // without outputs to pull it, the callback runs as soon as a block of input is in
+    if (outputConverter == nullptr)
+    {
+        while (numInputQueued >= internalBlockSize)
+            runCallback();
+
+        for (auto channel = 0; channel < numOutputChannels; ++channel)
+            FloatVectorOperations::clear (outputChannelData[channel], numSamples);
+
+        return;
+    }
+
+    const auto numChannels = jmin (numOutputChannels, numOutputs);
+    auto generated = 0;
+
+    while (generated < numSamples)
+    {
+        for (auto channel = 0; channel < numOutputs; ++channel)
+        {
+            readPointers[channel] = outputQueue.getReadPointer (channel);
+            writePointers[channel] = channel < numChannels ? outputChannelData[channel] + generated
+                                                           : callbackOutput.getWritePointer (channel);
+        }
+
+        auto inputFramesUsed = 0;
+        const auto numGenerated = outputConverter->process (readPointers, numOutputQueued, writePointers,
+                                                            jmin (numSamples - generated, internalBlockSize), inputFramesUsed);
+
+        numOutputQueued -= inputFramesUsed;
+
+        for (auto channel = 0; channel < numOutputs && numOutputQueued > 0; ++channel)
+            memmove (outputQueue.getWritePointer (channel), outputQueue.getReadPointer (channel, inputFramesUsed),
+                     sizeof (float) * (size_t) numOutputQueued);
+
+        generated += numGenerated;
+
+        if (numGenerated == 0 && inputFramesUsed == 0)
+            runCallback();
+    }
+
+    for (auto channel = numChannels; channel < numOutputChannels; ++channel)
+        FloatVectorOperations::clear (outputChannelData[channel], numSamples);
+}
+
+void SRCDeviceRateAdapter::queueInput (const float* const* inputChannelData, const int numInputChannels, const int numSamples)
+{
+    if (inputConverter == nullptr)
+        return;
+
+    const auto numChannels = jmin (numInputChannels, numInputs);
+    auto used = 0;
+
+    for (;;)
+    {
+        for (auto channel = 0; channel < numInputs; ++channel)
+        {
+            // channels the device didn't pass are converted from silence
+            readPointers[channel] = channel < numChannels ? inputChannelData[channel] + used
+                                                          : silence.getReadPointer (0);
+            writePointers[channel] = inputQueue.getWritePointer (channel, numInputQueued);
+        }
+
+        auto numInputFrames = numSamples - used;
+
+        if (numChannels < numInputs)
+            numInputFrames = jmin (numInputFrames, silence.getNumSamples());
+
+        auto inputFramesUsed = 0;
+        const auto numGenerated = inputConverter->process (readPointers, numInputFrames, writePointers,
+                                                           inputQueue.getNumSamples() - numInputQueued, inputFramesUsed);
+        used += inputFramesUsed;
+        numInputQueued += numGenerated;
+
+        if (numGenerated == 0 && inputFramesUsed == 0)
+            break;
+    }
+}
+
+void SRCDeviceRateAdapter::runCallback()
+{
+    const auto numAvailable = jmin (numInputQueued, internalBlockSize);
+
+    if (inputConverter != nullptr && numAvailable < internalBlockSize)
+        ++numUnderruns;
+
+    for (auto channel = 0; channel < numInputs; ++channel)
+    {
+        callbackInput.copyFrom (channel, 0, inputQueue, channel, 0, numAvailable);
+        callbackInput.clear (channel, numAvailable, internalBlockSize - numAvailable);
+
+        if (numInputQueued > numAvailable)
+            memmove (inputQueue.getWritePointer (channel), inputQueue.getReadPointer (channel, numAvailable),
+                     sizeof (float) * (size_t) (numInputQueued - numAvailable));
+    }
+
+    numInputQueued -= numAvailable;
+
+    callWrapped (callbackInput.getArrayOfReadPointers(), numInputs,
+                 callbackOutput.getArrayOfWritePointers(), numOutputs, internalBlockSize);
+
+    for (auto channel = 0; channel < numOutputs; ++channel)
+        outputQueue.copyFrom (channel, numOutputQueued, callbackOutput, channel, 0, internalBlockSize);
+
+    numOutputQueued += numOutputs > 0 ? internalBlockSize : 0;
+}
+
+void SRCDeviceRateAdapter::callWrapped (const float* const* input, const int numInput,
+                                        float* const* output, const int numOutput, const int numSamples)
+{
+   #if JUCE_VERSION >= 0x70003
+    callback->audioDeviceIOCallbackWithContext (input, numInput, output, numOutput, numSamples, {});
+   #else
+    callback->audioDeviceIOCallback (const_cast<const float**> (input), numInput,
+                                     const_cast<float**> (output), numOutput, numSamples);
+   #endif
+}
+
+} // namespace juce
+
+#endif
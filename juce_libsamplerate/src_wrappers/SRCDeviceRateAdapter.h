@@ -0,0 +1,134 @@
+/*
+ ==============================================================================
+    Copyright (c) 2019, Tal Aviram
+    All rights reserved.
+
+    This code is released under 2-clause BSD license. Please see the
+    file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#pragma once
+
+#if JUCE_MODULE_AVAILABLE_juce_audio_devices
+
+namespace juce
+{
+
+//==============================================================================
+/**
+ An AudioIODeviceCallback that runs another callback at a fixed sample-rate, whatever
+ rate the device opens at.
+
+ The device's input is converted to the internal rate and queued, and the device's
+ output is converted from the callback's output. The wrapped callback always runs at the
+ internal rate, in blocks of getInternalBlockSize(), so a graph behind it is prepared once
+ and never has to follow the user's interface from 44.1kHz to 96kHz. Sinc qualities are
+ run by SRCSincConverter and SRC_LINEAR and SRC_ZERO_ORDER_HOLD by SRCFastInterpolator.
+
+ The input queue starts with getLatencyInSamples() samples of silence, so the wrapped
+ callback never waits for input that the converters still hold back. Its input therefore
+ arrives that much later than its output leaves, which is added to the input latency of
+ the device it's given. The output isn't delayed further: the converters hold their
+ output back rather than delaying it.
+
+ When the device opens at the internal rate, the callback is called directly.
+
+ The wrapped callback is passed a stand-in device in audioDeviceAboutToStart(), which
+ reports the internal rate, block size and latencies, and forwards the other queries to
+ the real device. Opening, closing and starting it do nothing; use the real device.
+
+ @see SRCSincConverter, SRCFastInterpolator
+
+ @tags{Audio}
+ */
+class SRCDeviceRateAdapter  : public AudioIODeviceCallback
+{
+public:
+    typedef libsamplerate::SRC::ResamplerQuality ResamplerQuality;
+
+    //==============================================================================
+    /** Creates an adapter.
+
+     @param callbackToWrap       the callback to run at the internal rate. It must outlive
+                                 this object, and is not deleted by it.
+     @param internalSampleRate   the rate the wrapped callback always runs at
+     @param quality              quality / type of sample rate conversion
+     */
+    SRCDeviceRateAdapter (AudioIODeviceCallback* callbackToWrap,
+                          double internalSampleRate,
+                          ResamplerQuality quality = ResamplerQuality::SRC_SINC_MEDIUM_QUALITY);
+
+    /** Destructor. */
+    ~SRCDeviceRateAdapter() override;
+
+    //==============================================================================
+    /** Returns the rate the wrapped callback runs at. */
+    double getInternalSampleRate() const noexcept           { return internalSampleRate; }
+
+    /** Returns the block size the wrapped callback runs at, once the device has started. */
+    int getInternalBlockSize() const noexcept               { return internalBlockSize; }
+
+    /** Returns the latency added to the input, in samples at the internal rate. */
+    int getLatencyInSamples() const noexcept                { return latency; }
+
+    /** Returns true if the device runs at a different rate, so the audio is converted. */
+    bool isConverting() const noexcept                      { return converting; }
+
+    /** Returns the number of times the wrapped callback ran short of input. */
+    int getNumUnderruns() const noexcept                    { return numUnderruns; }
+
+    //==============================================================================
+    /** @internal */
+    void audioDeviceAboutToStart (AudioIODevice* device) override;
+    /** @internal */
+    void audioDeviceStopped() override;
+    /** @internal */
+    void audioDeviceError (const String& errorMessage) override;
+
+   #if JUCE_VERSION >= 0x70003
+    /** @internal */
+    void audioDeviceIOCallbackWithContext (const float* const* inputChannelData, int numInputChannels,
+                                           float* const* outputChannelData, int numOutputChannels,
+                                           int numSamples, const AudioIODeviceCallbackContext& context) override;
+   #else
+    /** @internal */
+    void audioDeviceIOCallback (const float** inputChannelData, int numInputChannels,
+                                float** outputChannelData, int numOutputChannels, int numSamples) override;
+   #endif
+
+private:
+    //==============================================================================
+    class Converter;
+    class InternalDevice;
+
+    void process (const float* const* inputChannelData, int numInputChannels,
+                  float* const* outputChannelData, int numOutputChannels, int numSamples);
+    void queueInput (const float* const* inputChannelData, int numInputChannels, int numSamples);
+    void runCallback();
+    void callWrapped (const float* const* input, int numInput, float* const* output, int numOutput, int numSamples);
+
+    //==============================================================================
+    AudioIODeviceCallback* const callback;
+    const double internalSampleRate;
+    const ResamplerQuality quality;
+
+    std::unique_ptr<InternalDevice> internalDevice;
+    std::unique_ptr<Converter> inputConverter, outputConverter;
+    bool converting = false;
+    int internalBlockSize = 0, latency = 0, numInputs = 0, numOutputs = 0;
+
+    // input at the internal rate waiting for the callback, and its output waiting for
+    // the device, both kept from index 0
+    AudioBuffer<float> inputQueue, outputQueue, callbackInput, callbackOutput, silence;
+    int numInputQueued = 0, numOutputQueued = 0;
+    HeapBlock<const float*> readPointers;
+    HeapBlock<float*> writePointers;
+    std::atomic<int> numUnderruns { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SRCDeviceRateAdapter)
+};
+
+} // namespace juce
+
+#endif
@@ -0,0 +1,248 @@
+/*
+ ==============================================================================
+ Copyright (c) 2019, Tal Aviram
+ All rights reserved.
+
+ This code is released under 2-clause BSD license. Please see the
+ file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#include "SRCFanOutSource.h"
+
+namespace juce
+{
+
+SRCFanOutSource::Output::Output (SRCFanOutSource& o, const ResamplerQuality quality)
+    : owner (o),
+      inputPointers ((size_t) o.numChannels),
+      outputPointers ((size_t) o.numChannels),
+      inputCopy (o.numChannels, chunkSize)
+{
+    if (SRCFastInterpolator::supportsQuality (quality))
+        fastInterpolator.reset (new SRCFastInterpolator (quality, owner.numChannels));
+    else
+        sincConverter.reset (new SRCSincConverter (SRCCoefficientTable::getTable (quality, SRCCoefficientTable::exactHalfTable),
+                                                   owner.numChannels));
+}
+
+SRCFanOutSource::Output::~Output()
+{
+}
+
+void SRCFanOutSource::Output::prepareToPlay (const int samplesPerBlockExpected, const double sampleRate)
+{
+    const ScopedLock sl (owner.lock);
+
+    scratch.setSize (owner.numChannels, samplesPerBlockExpected);
+    owner.outputPrepared (*this, sampleRate);
+}
+
+void SRCFanOutSource::Output::releaseResources()
+{
+    const ScopedLock sl (owner.lock);
+
+    if (isPrepared)
+        owner.outputReleased (*this);
+
+    scratch.setSize (owner.numChannels, 0);
+}
+
+void SRCFanOutSource::Output::getNextAudioBlock (const AudioSourceChannelInfo& info)
+{
+    if (! isPrepared)
+    {
+        info.clearActiveBufferRegion();
+        return;
+    }
+
+    scratch.setSize (owner.numChannels, info.numSamples, false, false, true);
+    auto written = 0;
+
+    while (written < info.numSamples)
+    {
+        const auto available = takeInput();
+
+        for (auto channel = 0; channel < owner.numChannels; ++channel)
+        {
+            inputPointers[channel] = inputCopy.getReadPointer (channel);
+            outputPointers[channel] = scratch.getWritePointer (channel, written);
+        }
+
+        // the input is this output's own copy, so the other outputs can go on meanwhile
+        auto inputFramesUsed = 0;
+        const auto generated = process (inputPointers, available,
+                                        outputPointers, info.numSamples - written, inputFramesUsed);
+        readPosition += inputFramesUsed;
+        written += generated;
+
+        if (generated == 0 && inputFramesUsed == 0)
+            break;
+    }
+
+    if (written < info.numSamples)
+        scratch.clear (written, info.numSamples - written);
+
+    const auto numToCopy = jmin (owner.numChannels, info.buffer->getNumChannels());
+
+    for (auto channel = 0; channel < numToCopy; ++channel)
+        info.buffer->copyFrom (channel, info.startSample, scratch, channel, 0, info.numSamples);
+
+    for (auto channel = numToCopy; channel < info.buffer->getNumChannels(); ++channel)
+        info.buffer->clear (channel, info.startSample, info.numSamples);
+}
+
+int SRCFanOutSource::Output::takeInput()
+{
+    const ScopedLock sl (owner.lock);
+
+    const auto oldestKept = owner.historyEnd - owner.history.getNumSamples();
+
+    if (readPosition < oldestKept)
+    {
+        numSkipped += oldestKept - readPosition;
+        resetConverter (oldestKept);
+    }
+
+    if (readPosition == owner.historyEnd)
+        owner.readNextChunk();
+
+    const auto numToCopy = jmin (owner.getNumContiguous (readPosition), inputCopy.getNumSamples());
+    const auto historyIndex = (int) (readPosition % owner.history.getNumSamples());
+
+    for (auto channel = 0; channel < owner.numChannels; ++channel)
+        inputCopy.copyFrom (channel, 0, owner.history, channel, historyIndex, numToCopy);
+
+    return numToCopy;
+}
+
+int SRCFanOutSource::Output::process (const float* const* inputData, const int numInputFrames,
+                                      float* const* outputData, const int numOutputFrames, int& inputFramesUsed)
+{
+    if (fastInterpolator != nullptr)
+        return fastInterpolator->process (inputData, numInputFrames, outputData, numOutputFrames,
+                                          samplesInPerOutputSample, inputFramesUsed);
+
+    return sincConverter->process (inputData, numInputFrames, outputData, numOutputFrames,
+                                   samplesInPerOutputSample, inputFramesUsed);
+}
+
+void SRCFanOutSource::Output::resetConverter (const int64 position)
+{
+    readPosition = position;
+
+    if (fastInterpolator != nullptr)
+    {
+        fastInterpolator->setResamplingRatio (samplesInPerOutputSample);
+        fastInterpolator->reset();
+    }
+    else
+    {
+        sincConverter->setResamplingRatio (samplesInPerOutputSample);
+        sincConverter->reset();
+    }
+}
+
+//==============================================================================
+SRCFanOutSource::SRCFanOutSource (AudioSource* const inputSource,
+                                  const bool deleteInputWhenDeleted,
+                                  const double sampleRate,
+                                  const int channels,
+                                  const int historySize)
+    : input (inputSource, deleteInputWhenDeleted),
+      inputSampleRate (sampleRate),
+      numChannels (channels),
+      // whole chunks, so that a chunk never wraps around the end of the history
+      history (channels, ((jmax ((int) chunkSize, historySize) + chunkSize - 1) / chunkSize) * chunkSize),
+      chunk (channels, chunkSize)
+{
+    jassert (input != nullptr && inputSampleRate > 0 && numChannels > 0);
+    history.clear();
+}
+
+SRCFanOutSource::~SRCFanOutSource()
+{
+    if (numPrepared > 0)
+        input->releaseResources();
+
+    outputs.clear();
+}
+
+//==============================================================================
+SRCFanOutSource::Output* SRCFanOutSource::addOutput (const ResamplerQuality quality)
+{
+    auto* output = new Output (*this, quality);
+
+    const ScopedLock sl (lock);
+    return outputs.add (output);
+}
+
+void SRCFanOutSource::removeOutput (Output* const output)
+{
+    const ScopedLock sl (lock);
+
+    if (output == nullptr || ! outputs.contains (output))
+        return;
+
+    if (output->isPrepared)
+        outputReleased (*output);
+
+    outputs.removeObject (output);
+}
+
+int SRCFanOutSource::getNumOutputs() const
+{
+    const ScopedLock sl (lock);
+    return outputs.size();
+}
+
+//==============================================================================
+void SRCFanOutSource::outputPrepared (Output& output, const double sampleRate)
+{
+    jassert (sampleRate > 0);
+
+    if (! output.isPrepared && numPrepared++ == 0)
+    {
+        input->prepareToPlay (chunkSize, inputSampleRate);
+        history.clear();
+        historyEnd = 0;
+    }
+
+    // the sample-rate may have changed since the output was last prepared, and like a new
+    // output it starts again from the newest input, so it doesn't pull the others back
+    output.samplesInPerOutputSample = inputSampleRate / sampleRate;
+    output.resetConverter (historyEnd);
+    output.isPrepared = true;
+}
+
+void SRCFanOutSource::outputReleased (Output& output)
+{
+    output.isPrepared = false;
+
+    if (--numPrepared == 0)
+        input->releaseResources();
+}
+
+void SRCFanOutSource::readNextChunk()
+{
+    // this overwrites the oldest chunk; an output that hadn't got to it yet notices that it
+    // fell behind the next time it takes its input, see Output::takeInput()
+    const auto capacity = history.getNumSamples();
+
+    input->getNextAudioBlock (AudioSourceChannelInfo (&chunk, 0, chunkSize));
+
+    const auto historyIndex = (int) (historyEnd % capacity);
+
+    for (auto channel = 0; channel < numChannels; ++channel)
+        history.copyFrom (channel, historyIndex, chunk, channel, 0, chunkSize);
+
+    historyEnd += chunkSize;
+}
+
+int SRCFanOutSource::getNumContiguous (const int64 position) const noexcept
+{
+    const auto capacity = history.getNumSamples();
+    return (int) jmin (historyEnd - position, (int64) (capacity - (int) (position % capacity)));
+}
+
+} // namespace juce
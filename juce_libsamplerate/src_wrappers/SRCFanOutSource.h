@@ -0,0 +1,134 @@
+/*
+ ==============================================================================
+    Copyright (c) 2019, Tal Aviram
+    All rights reserved.
+
+    This code is released under 2-clause BSD license. Please see the
+    file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#pragma once
+
+namespace juce
+{
+
+//==============================================================================
+/**
+ Plays one input at several sample-rates at once, reading the input only once.
+
+ Each output is an AudioSource of its own, for example one for the device, one for a
+ broadcast feed at 48kHz and one for an archive at 44.1kHz. An output converts from the
+ input sample-rate to the sample-rate it is prepared with, with its own converter.
+
+ The input is read in chunks into a shared history, and every output reads from that
+ history at its own pace. The history is kept until the slowest output has used it, up
+ to the size given to the constructor; an output that falls further behind than that
+ (e.g. one that has stopped being pulled) skips ahead to the oldest input still kept,
+ so it never holds the others back. Outputs that aren't prepared don't count.
+
+ The outputs may be pulled from different threads. They only share a lock while they take
+ their input from the history; each one converts a copy of it on its own.
+
+ @see SRCAudioSource, SRCMultiRateMixerSource
+
+ @tags{Audio}
+ */
+class SRCFanOutSource
+{
+public:
+    typedef libsamplerate::SRC::ResamplerQuality ResamplerQuality;
+
+    //==============================================================================
+    /** One of the outputs, playing the input at the sample-rate it is prepared with. */
+    class Output  : public AudioSource
+    {
+    public:
+        ~Output() override;
+
+        void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override;
+        void releaseResources() override;
+        void getNextAudioBlock (const AudioSourceChannelInfo&) override;
+
+        /** Returns the number of input samples this output lost by falling too far behind. */
+        int64 getNumSkippedInputSamples() const noexcept    { return numSkipped; }
+
+    private:
+        friend class SRCFanOutSource;
+        Output (SRCFanOutSource&, ResamplerQuality);
+
+        int takeInput();
+        int process (const float* const* input, int numInputFrames,
+                     float* const* output, int numOutputFrames, int& inputFramesUsed);
+        void resetConverter (int64 position);
+
+        SRCFanOutSource& owner;
+        HeapBlock<const float*> inputPointers;
+        HeapBlock<float*> outputPointers;
+        AudioBuffer<float> inputCopy, scratch;
+        std::unique_ptr<SRCSincConverter> sincConverter;
+        std::unique_ptr<SRCFastInterpolator> fastInterpolator;
+        double samplesInPerOutputSample = 1.0;
+        int64 readPosition = 0;
+        std::atomic<int64> numSkipped { 0 };
+        std::atomic<bool> isPrepared { false }; // written under the owner's lock, read by getNextAudioBlock() without it
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Output)
+    };
+
+    //==============================================================================
+    /** Creates a fan-out for an input.
+
+     @param inputSource              the input to read from
+     @param deleteInputWhenDeleted   if true, the input is deleted with this object
+     @param inputSampleRate          the sample-rate the input plays at
+     @param numChannels              the number of channels to read and convert
+     @param historySize              how far apart the outputs may drift, in input samples
+     */
+    SRCFanOutSource (AudioSource* inputSource,
+                     bool deleteInputWhenDeleted,
+                     double inputSampleRate,
+                     int numChannels = 2,
+                     int historySize = 65536);
+
+    /** Destructor. Deletes the outputs, so nothing may still be playing them. */
+    ~SRCFanOutSource();
+
+    //==============================================================================
+    /** Adds an output. It stays owned by this object, until removeOutput() is called. */
+    Output* addOutput (ResamplerQuality quality = ResamplerQuality::SRC_SINC_MEDIUM_QUALITY);
+
+    /** Deletes an output. It must not be playing. */
+    void removeOutput (Output* output);
+
+    /** Returns the number of outputs. */
+    int getNumOutputs() const;
+
+    /** Returns the sample-rate of the input. */
+    double getInputSampleRate() const noexcept              { return inputSampleRate; }
+
+private:
+    //==============================================================================
+    enum { chunkSize = 512 };
+
+    void outputPrepared (Output&, double sampleRate);
+    void outputReleased (Output&);
+    void readNextChunk();
+    int getNumContiguous (int64 position) const noexcept;
+
+    //==============================================================================
+    OptionalScopedPointer<AudioSource> input;
+    const double inputSampleRate;
+    const int numChannels;
+
+    OwnedArray<Output> outputs;
+    CriticalSection lock;
+
+    AudioBuffer<float> history, chunk;
+    int64 historyEnd = 0;
+    int numPrepared = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SRCFanOutSource)
+};
+
+} // namespace juce
@@ -0,0 +1,245 @@
+/*
+ ==============================================================================
+ Copyright (c) 2019, Tal Aviram
+ All rights reserved.
+
+ This code is released under 2-clause BSD license. Please see the
+ file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#include "SRCFastInterpolator.h"
+
+namespace juce
+{
+
+SRCFastInterpolator::SRCFastInterpolator (const ResamplerQuality quality, const int channels)
+    : isLinear (quality == ResamplerQuality::SRC_LINEAR),
+      numChannels (channels)
+{
+    jassert (supportsQuality (quality) && numChannels > 0);
+
+    ownedHistory.calloc ((size_t) numChannels);
+    history = ownedHistory.get();
+}
+
+SRCFastInterpolator::SRCFastInterpolator (const ResamplerQuality quality, const int channels, SRCArena& arena)
+    : isLinear (quality == ResamplerQuality::SRC_LINEAR),
+      numChannels (channels)
+{
+    jassert (supportsQuality (quality) && numChannels > 0);
+
+    history = arena.allocateArray<float> ((size_t) numChannels);
+    jassert (history != nullptr);
+}
+
+SRCFastInterpolator::~SRCFastInterpolator()
+{
+}
+
+size_t SRCFastInterpolator::getRequiredArenaSize (const int channels) noexcept
+{
+    return SRCArena::getAlignedSize (sizeof (SRCFastInterpolator))
+         + SRCArena::getAlignedSize (sizeof (float) * (size_t) channels);
+}
+
+bool SRCFastInterpolator::supportsQuality (const ResamplerQuality quality) noexcept
+{
+    return quality == ResamplerQuality::SRC_LINEAR || quality == ResamplerQuality::SRC_ZERO_ORDER_HOLD;
+}
+
+void SRCFastInterpolator::setResamplingRatio (const double samplesInPerOutputSample) noexcept
+{
+    jassert (samplesInPerOutputSample > 0);
+    lastIncrement = samplesInPerOutputSample;
+}
+
+void SRCFastInterpolator::reset() noexcept
+{
+    position = 0.0;
+
+    for (auto channel = 0; channel < numChannels; ++channel)
+        history[channel] = 0.0f;
+
+    passThrough = passThroughTarget = 0.0f;
+    passThroughRampRemaining = 0;
+}
+
+void SRCFastInterpolator::setPassThrough (const float amount, const int numOutputFramesToRamp) noexcept
+{
+    jassert (amount >= 0.0f && amount <= 1.0f);
+
+    passThroughTarget = amount;
+    passThroughRampRemaining = jmax (0, numOutputFramesToRamp);
+
+    if (passThroughRampRemaining > 0)
+        passThroughStep = (amount - passThrough) / (float) passThroughRampRemaining;
+    else
+        passThrough = amount;
+}
+
+float SRCFastInterpolator::getNextPassThrough() noexcept
+{
+    const auto amount = passThrough;
+
+    if (passThroughRampRemaining > 0)
+        passThrough = --passThroughRampRemaining > 0 ? passThrough + passThroughStep : passThroughTarget;
+
+    return amount;
+}
+
+int SRCFastInterpolator::takeHeldInput (float* const* destination, const int numFrames) noexcept
+{
+    // zero-order hold plays the history frame until the position reaches the next one,
+    // linear plays the nearest frame
+    const auto playsHistory = position < 0.0 && (! isLinear || position < -0.5);
+
+    if (numFrames <= 0)
+        return 0;
+
+    position = 0.0;
+
+    if (! playsHistory)
+        return 0;
+
+    for (auto channel = 0; channel < numChannels; ++channel)
+        destination[channel][0] = history[channel];
+
+    return 1;
+}
+
+void SRCFastInterpolator::primeHistory (const float* const* source, const int numFrames) noexcept
+{
+    reset();
+
+    if (numFrames > 0)
+        for (auto channel = 0; channel < numChannels; ++channel)
+            history[channel] = source[channel][numFrames - 1];
+}
+
+//==============================================================================
+// Positions are relative to the first frame of the current input; index -1 is the
+// last frame of the previous input, kept in history.
+float SRCFastInterpolator::getSample (const float* input, const int channel, const int index) const noexcept
+{
+    return index < 0 ? history[channel] : input[index];
+}
+
+void SRCFastInterpolator::processScalar (const float* const* input, float* const* output,
+                                         const int outputIndex, const double pos,
+                                         const float passThroughAmount) const noexcept
+{
+    const auto index = (int) std::floor (pos);
+    const auto nearestIndex = isLinear && pos - index >= 0.5 ? index + 1 : index;
+
+    for (auto channel = 0; channel < numChannels; ++channel)
+    {
+        const auto a = getSample (input[channel], channel, index);
+        auto sample = a;
+
+        if (isLinear)
+        {
+            const auto b = getSample (input[channel], channel, index + 1);
+            sample = a + (float) (pos - index) * (b - a);
+        }
+
+        if (passThroughAmount > 0.0f)
+            sample += passThroughAmount * (getSample (input[channel], channel, nearestIndex) - sample);
+
+        output[channel][outputIndex] = sample;
+    }
+}
+
+int SRCFastInterpolator::process (const float* const* input, const int numInputFrames,
+                                  float* const* output, const int numOutputFrames,
+                                  const double samplesInPerOutputSample, int& inputFramesUsed) noexcept
+{
+    jassert (samplesInPerOutputSample > 0);
+
+    // the last index an output may start at, as linear also reads the frame after it
+    const auto lastIndex = numInputFrames - (isLinear ? 2 : 1);
+    const auto slope = numOutputFrames > 0 ? (samplesInPerOutputSample - lastIncrement) / numOutputFrames : 0.0;
+
+    // offsets of the positions inside a vector: k outputs in, the ramp has added k * (k - 1) / 2 slopes
+    static const double rampOffsets[vectorSize + 1] = { 0, 0, 1, 3, 6, 10, 15, 21, 28 };
+
+    auto pos = position;
+    auto increment = lastIncrement;
+    auto generated = 0;
+
+    // outputs that still read the history frame
+    while (generated < numOutputFrames && pos < 0.0 && (int) std::floor (pos) <= lastIndex)
+    {
+        processScalar (input, output, generated++, pos, getNextPassThrough());
+        pos += increment;
+        increment += slope;
+    }
+
+    // a pass-through mix is only done one output at a time
+    while (passThrough == 0.0f && passThroughRampRemaining == 0 && numOutputFrames - generated >= vectorSize)
+    {
+        double positions[vectorSize];
+
+        for (auto k = 0; k < vectorSize; ++k)
+            positions[k] = pos + k * increment + rampOffsets[k] * slope;
+
+        if ((int) positions[vectorSize - 1] > lastIndex)
+            break;
+
+        int indices[vectorSize];
+        float fractions[vectorSize];
+
+        for (auto k = 0; k < vectorSize; ++k)
+        {
+            indices[k] = (int) positions[k];
+            fractions[k] = (float) (positions[k] - indices[k]);
+        }
+
+        for (auto channel = 0; channel < numChannels; ++channel)
+        {
+            const auto* in = input[channel];
+            auto* out = output[channel] + generated;
+
+            if (isLinear)
+            {
+                for (auto k = 0; k < vectorSize; ++k)
+                {
+                    const auto a = in[indices[k]];
+                    out[k] = a + fractions[k] * (in[indices[k] + 1] - a);
+                }
+            }
+            else
+            {
+                for (auto k = 0; k < vectorSize; ++k)
+                    out[k] = in[indices[k]];
+            }
+        }
+
+        pos += vectorSize * increment + rampOffsets[vectorSize] * slope;
+        increment += vectorSize * slope;
+        generated += vectorSize;
+    }
+
+    // whatever doesn't fill a whole vector
+    while (generated < numOutputFrames && (int) std::floor (pos) <= lastIndex)
+    {
+        processScalar (input, output, generated++, pos, getNextPassThrough());
+        pos += increment;
+        increment += slope;
+    }
+
+    // consume everything before the next output's first frame, keeping the frame before it
+    const auto used = jlimit (0, numInputFrames, (int) std::floor (pos) + 1);
+
+    if (used > 0)
+        for (auto channel = 0; channel < numChannels; ++channel)
+            history[channel] = input[channel][used - 1];
+
+    position = pos - used;
+    lastIncrement = increment;
+    inputFramesUsed = used;
+
+    return generated;
+}
+
+} // namespace juce
@@ -0,0 +1,131 @@
+/*
+ ==============================================================================
+    Copyright (c) 2019, Tal Aviram
+    All rights reserved.
+
+    This code is released under 2-clause BSD license. Please see the
+    file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#pragma once
+
+namespace juce
+{
+
+//==============================================================================
+/**
+ A streaming linear / zero-order-hold converter that computes several output
+ positions per iteration.
+
+ It replaces libsamplerate's SRC_LINEAR and SRC_ZERO_ORDER_HOLD converters, which
+ interpolate one sample at a time. Here the positions of a whole vector of outputs
+ are computed at once (including a ratio that ramps across the block), so both the
+ position maths and the interpolation run as fixed-width loops that the compiler
+ vectorises. All channels share the same positions, so they stay sample-locked.
+
+ The calling convention follows src_process(): every call consumes as much of the
+ given input as it can, reports it in inputFramesUsed, and returns the number of
+ output frames generated.
+
+ @see SRCAudioSource, SRC::resample
+
+ @tags{Audio}
+ */
+class SRCFastInterpolator
+{
+public:
+    typedef libsamplerate::SRC::ResamplerQuality ResamplerQuality;
+
+    //==============================================================================
+    /** Creates an interpolator.
+
+     @param quality      either SRC_LINEAR or SRC_ZERO_ORDER_HOLD
+     @param numChannels  the number of channels to process
+     */
+    SRCFastInterpolator (ResamplerQuality quality, int numChannels);
+
+    /** Creates an interpolator whose history is placed in an arena, which must outlive it.
+        The arena needs getRequiredArenaSize() bytes free, including those for the object
+        itself if it is placed there too.
+     */
+    SRCFastInterpolator (ResamplerQuality quality, int numChannels, SRCArena& arena);
+
+    /** Destructor. */
+    ~SRCFastInterpolator();
+
+    /** Returns true if the quality is one this class implements. */
+    static bool supportsQuality (ResamplerQuality quality) noexcept;
+
+    /** Returns the number of bytes this interpolator uses. */
+    size_t getSizeInBytes() const noexcept      { return sizeof (*this) + sizeof (float) * (size_t) numChannels; }
+
+    /** Returns the arena space an interpolator and its history take up. */
+    static size_t getRequiredArenaSize (int numChannels) noexcept;
+
+    //==============================================================================
+    /** Changes the ratio immediately, without ramping from the previous one. */
+    void setResamplingRatio (double samplesInPerOutputSample) noexcept;
+
+    /** Clears the history, phase and pass-through. */
+    void reset() noexcept;
+
+    /** Converts a block.
+
+     The ratio ramps linearly from the one of the previous call (or the one given to
+     setResamplingRatio()) to samplesInPerOutputSample across numOutputFrames.
+
+     @param input                    one pointer per channel
+     @param numInputFrames           the number of frames available in input
+     @param output                   one pointer per channel
+     @param numOutputFrames          the space available in output
+     @param samplesInPerOutputSample the ratio to reach at the end of the block
+     @param inputFramesUsed          receives the number of input frames consumed
+     @returns the number of output frames generated
+     */
+    int process (const float* const* input, int numInputFrames,
+                 float* const* output, int numOutputFrames,
+                 double samplesInPerOutputSample, int& inputFramesUsed) noexcept;
+
+    //==============================================================================
+    /** Mixes each output with the input frame it's aligned to, ramping linearly to the
+        given amount over the next outputs. As in SRCSincConverter::setPassThrough(), an
+        amount of 1 at a ratio of exactly 1.0 outputs the input itself.
+     */
+    void setPassThrough (float amount, int numOutputFramesToRamp) noexcept;
+
+    /** Returns true once the pass-through has ramped all the way to 1. */
+    bool isPassingThrough() const noexcept                  { return passThrough >= 1.0f && passThroughRampRemaining == 0; }
+
+    /** Copies out the history frame if the next output is aligned to it, and returns the
+        number of frames copied. See SRCSincConverter::takeHeldInput().
+     */
+    int takeHeldInput (float* const* destination, int numFrames) noexcept;
+
+    /** Clears the interpolator and makes the last of the numFrames frames given its
+        history. See SRCSincConverter::primeHistory().
+     */
+    void primeHistory (const float* const* source, int numFrames) noexcept;
+
+private:
+    //==============================================================================
+    enum { vectorSize = 8 };
+
+    float getSample (const float* input, int channel, int index) const noexcept;
+    void processScalar (const float* const* input, float* const* output, int outputIndex, double position,
+                        float passThroughAmount) const noexcept;
+    float getNextPassThrough() noexcept;
+
+    const bool isLinear;
+    const int numChannels;
+    double position = 0.0, lastIncrement = 1.0;
+    HeapBlock<float> ownedHistory;
+    float* history = nullptr; // ownedHistory, or a block in an arena
+
+    float passThrough = 0.0f, passThroughTarget = 0.0f, passThroughStep = 0.0f;
+    int passThroughRampRemaining = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SRCFastInterpolator)
+};
+
+} // namespace juce
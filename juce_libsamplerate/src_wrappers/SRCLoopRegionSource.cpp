@@ -0,0 +1,146 @@
+/*
+ ==============================================================================
+ Copyright (c) 2019, Tal Aviram
+ All rights reserved.
+
+ This code is released under 2-clause BSD license. Please see the
+ file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#include "SRCLoopRegionSource.h"
+
+namespace juce
+{
+
+SRCLoopRegionSource::SRCLoopRegionSource (PositionableAudioSource* const inputSource, const bool deleteInputWhenDeleted)
+    : input (inputSource, deleteInputWhenDeleted)
+{
+    jassert (input != nullptr);
+}
+
+SRCLoopRegionSource::~SRCLoopRegionSource()
+{
+}
+
+//==============================================================================
+void SRCLoopRegionSource::setLoopRegion (const Range<int64> regionInSourceSamples)
+{
+    jassert (regionInSourceSamples.getStart() >= 0);
+
+    const SpinLock::ScopedLockType sl (regionLock);
+
+    // rebase so the position that is read next carries on from the same input sample
+    const auto position = nextPosition.load();
+    const auto sourcePosition = toSourcePosition (position, loopRegion, positionOffset);
+    loopRegion = regionInSourceSamples;
+    positionOffset = position - sourcePosition;
+}
+
+void SRCLoopRegionSource::clearLoopRegion()
+{
+    setLoopRegion ({});
+}
+
+Range<int64> SRCLoopRegionSource::getLoopRegion() const
+{
+    const SpinLock::ScopedLockType sl (regionLock);
+    return loopRegion;
+}
+
+bool SRCLoopRegionSource::hasLoopRegion() const
+{
+    return ! getLoopRegion().isEmpty();
+}
+
+int64 SRCLoopRegionSource::getSourcePosition (const int64 position) const
+{
+    const SpinLock::ScopedLockType sl (regionLock);
+    return toSourcePosition (position, loopRegion, positionOffset);
+}
+
+int64 SRCLoopRegionSource::toSourcePosition (const int64 position, const Range<int64> region, const int64 offset) noexcept
+{
+    const auto unrolled = position - offset;
+
+    if (region.isEmpty() || unrolled < region.getEnd())
+        return unrolled;
+
+    return region.getStart() + (unrolled - region.getEnd()) % region.getLength();
+}
+
+int64 SRCLoopRegionSource::getPositionForSourcePosition (const int64 sourcePosition) const
+{
+    const SpinLock::ScopedLockType sl (regionLock);
+    return sourcePosition + positionOffset;
+}
+
+//==============================================================================
+void SRCLoopRegionSource::prepareToPlay (const int samplesPerBlockExpected, const double sampleRate)
+{
+    input->prepareToPlay (samplesPerBlockExpected, sampleRate);
+}
+
+void SRCLoopRegionSource::releaseResources()
+{
+    input->releaseResources();
+}
+
+void SRCLoopRegionSource::getNextAudioBlock (const AudioSourceChannelInfo& info)
+{
+    Range<int64> region;
+    int64 offset;
+
+    {
+        const SpinLock::ScopedLockType sl (regionLock);
+        region = loopRegion;
+        offset = positionOffset;
+    }
+
+    auto position = nextPosition.load();
+    auto numDone = 0;
+
+    while (numDone < info.numSamples)
+    {
+        const auto sourcePosition = toSourcePosition (position, region, offset);
+        auto numThisTime = info.numSamples - numDone;
+
+        // stop at the loop end, the rest of the block is read from the loop start
+        if (! region.isEmpty() && sourcePosition < region.getEnd())
+            numThisTime = (int) jmin ((int64) numThisTime, region.getEnd() - sourcePosition);
+
+        if (input->getNextReadPosition() != sourcePosition)
+            input->setNextReadPosition (sourcePosition);
+
+        AudioSourceChannelInfo readInfo (info.buffer, info.startSample + numDone, numThisTime);
+        input->getNextAudioBlock (readInfo);
+
+        position += numThisTime;
+        numDone += numThisTime;
+    }
+
+    nextPosition = position;
+}
+
+void SRCLoopRegionSource::setNextReadPosition (const int64 newPosition)
+{
+    nextPosition = newPosition;
+}
+
+int64 SRCLoopRegionSource::getTotalLength() const
+{
+    const SpinLock::ScopedLockType sl (regionLock);
+
+    // a looping stream doesn't end
+    if (! loopRegion.isEmpty())
+        return std::numeric_limits<int64>::max() / 2;
+
+    return positionOffset + input->getTotalLength();
+}
+
+bool SRCLoopRegionSource::isLooping() const
+{
+    return input->isLooping();
+}
+
+} // namespace juce
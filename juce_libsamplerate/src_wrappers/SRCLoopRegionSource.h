@@ -0,0 +1,101 @@
+/*
+ ==============================================================================
+    Copyright (c) 2019, Tal Aviram
+    All rights reserved.
+
+    This code is released under 2-clause BSD license. Please see the
+    file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#pragma once
+
+namespace juce
+{
+
+//==============================================================================
+/**
+ A PositionableAudioSource that plays a region of its input in a loop, as one
+ continuous stream.
+
+ Read positions of this source never jump back at the loop point: they keep counting
+ up, and each pass of the loop is read from positions further along. So whatever reads
+ from it sees no discontinuity, i.e. a BufferingAudioSource reads the loop start ahead
+ of time like any other audio, and a converter reading from that keeps its filter
+ history across the loop point instead of being reset.
+
+ Positions of this source and positions in the input are converted with
+ getSourcePosition() and getPositionForSourcePosition().
+
+ @see SRCAudioTransportSource::setLoopRegion
+
+ @tags{Audio}
+ */
+class SRCLoopRegionSource  : public PositionableAudioSource
+{
+public:
+    //==============================================================================
+    /** Creates a SRCLoopRegionSource with no loop region.
+
+     @param inputSource              the input source to read from
+     @param deleteInputWhenDeleted   if true, the input source will be deleted when
+                                     this object is deleted
+     */
+    SRCLoopRegionSource (PositionableAudioSource* inputSource, bool deleteInputWhenDeleted);
+
+    /** Destructor. */
+    ~SRCLoopRegionSource() override;
+
+    //==============================================================================
+    /** Sets the region to loop, in samples of the input.
+
+     This can be called while the source is being read from. The stream carries on
+     from the position that will be read next: if that is before the end of the new
+     region, playback loops once it gets there, otherwise it jumps into the region.
+     */
+    void setLoopRegion (Range<int64> regionInSourceSamples);
+
+    /** Stops looping. The stream carries on from the position that will be read next. */
+    void clearLoopRegion();
+
+    /** Returns the loop region, which is empty if there is none. */
+    Range<int64> getLoopRegion() const;
+
+    /** Returns true if a loop region is set. */
+    bool hasLoopRegion() const;
+
+    //==============================================================================
+    /** Returns the input position that a position of this source reads from. */
+    int64 getSourcePosition (int64 position) const;
+
+    /** Returns the position of this source that reads from an input position.
+
+     Positions after the end of the loop region map into the region.
+     */
+    int64 getPositionForSourcePosition (int64 sourcePosition) const;
+
+    //==============================================================================
+    void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock (const AudioSourceChannelInfo&) override;
+
+    void setNextReadPosition (int64 newPosition) override;
+    int64 getNextReadPosition() const override              { return nextPosition; }
+    int64 getTotalLength() const override;
+    bool isLooping() const override;
+
+private:
+    //==============================================================================
+    static int64 toSourcePosition (int64 position, Range<int64> region, int64 offset) noexcept;
+
+    OptionalScopedPointer<PositionableAudioSource> input;
+
+    Range<int64> loopRegion;
+    int64 positionOffset = 0;
+    std::atomic<int64> nextPosition { 0 };
+    SpinLock regionLock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SRCLoopRegionSource)
+};
+
+} // namespace juce
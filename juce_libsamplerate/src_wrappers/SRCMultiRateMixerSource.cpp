@@ -0,0 +1,294 @@
+/*
+ ==============================================================================
+ Copyright (c) 2019, Tal Aviram
+ All rights reserved.
+
+ This code is released under 2-clause BSD license. Please see the
+ file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#include "SRCMultiRateMixerSource.h"
+
+namespace juce
+{
+
+SRCMultiRateMixerSource::RateGroup::RateGroup (const double rate, const ResamplerQuality quality, const int channels)
+    : sourceSampleRate (rate),
+      converter (this, false, quality, channels),
+      numChannels (channels)
+{
+}
+
+SRCMultiRateMixerSource::RateGroup::~RateGroup()
+{
+    for (auto i = inputs.size(); --i >= 0;)
+        if (inputsToDelete[i])
+            delete inputs.getUnchecked (i);
+}
+
+void SRCMultiRateMixerSource::RateGroup::prepareToPlay (const int samplesPerBlockExpected, const double sampleRate)
+{
+    // the converter reads a little more than a block at a time
+    tempBuffer.setSize (numChannels, samplesPerBlockExpected + 32);
+
+    for (auto* input : inputs)
+        input->prepareToPlay (samplesPerBlockExpected, sampleRate);
+}
+
+void SRCMultiRateMixerSource::RateGroup::releaseResources()
+{
+    for (auto* input : inputs)
+        input->releaseResources();
+
+    tempBuffer.setSize (numChannels, 0);
+}
+
+void SRCMultiRateMixerSource::RateGroup::getNextAudioBlock (const AudioSourceChannelInfo& info)
+{
+    if (inputs.size() == 0)
+    {
+        info.clearActiveBufferRegion();
+        return;
+    }
+
+    inputs.getUnchecked (0)->getNextAudioBlock (info);
+
+    if (inputs.size() > 1)
+    {
+        tempBuffer.setSize (jmax (1, info.buffer->getNumChannels()), info.numSamples, false, false, true);
+        AudioSourceChannelInfo tempInfo (&tempBuffer, 0, info.numSamples);
+
+        for (auto i = 1; i < inputs.size(); ++i)
+        {
+            inputs.getUnchecked (i)->getNextAudioBlock (tempInfo);
+
+            for (auto channel = 0; channel < info.buffer->getNumChannels(); ++channel)
+                info.buffer->addFrom (channel, info.startSample, tempBuffer, channel, 0, info.numSamples);
+        }
+    }
+}
+
+//==============================================================================
+SRCMultiRateMixerSource::SRCMultiRateMixerSource (const ResamplerQuality qualityToUse, const int channels)
+    : quality (qualityToUse),
+      numChannels (channels)
+{
+    jassert (numChannels > 0);
+}
+
+SRCMultiRateMixerSource::~SRCMultiRateMixerSource()
+{
+    removeAllInputs();
+}
+
+//==============================================================================
+SRCMultiRateMixerSource::RateGroup* SRCMultiRateMixerSource::findGroup (const double sourceSampleRate) const noexcept
+{
+    for (auto* group : groups)
+        if (std::abs (group->sourceSampleRate - sourceSampleRate) < 1.0e-6)
+            return group;
+
+    return nullptr;
+}
+
+int SRCMultiRateMixerSource::getInputBlockSize (const double sourceSampleRate, const int blockSize, const double sampleRate) noexcept
+{
+    // the block size SRCAudioSource::prepareToPlay() passes on
+    return roundToInt (blockSize * sourceSampleRate / sampleRate);
+}
+
+void SRCMultiRateMixerSource::prepareGroup (RateGroup& group, const int blockSize, const double sampleRate)
+{
+    group.isConverted = std::abs (group.sourceSampleRate - sampleRate) >= 1.0e-6;
+
+    if (group.isConverted)
+    {
+        group.converter.setResamplingRatio (group.sourceSampleRate / sampleRate, false);
+        group.converter.prepareToPlay (blockSize, sampleRate);
+    }
+    else
+    {
+        group.prepareToPlay (blockSize, sampleRate);
+    }
+}
+
+void SRCMultiRateMixerSource::addInputSource (AudioSource* const newInput, const double sourceSampleRate,
+                                              const bool deleteWhenRemoved)
+{
+    jassert (newInput != nullptr && sourceSampleRate > 0);
+
+    double sampleRate;
+    int blockSize;
+    std::unique_ptr<RateGroup> newGroup;
+
+    {
+        const ScopedLock sl (lock);
+
+        for (auto* group : groups)
+            if (group->inputs.contains (newInput))
+                return;
+
+        sampleRate = currentSampleRate;
+        blockSize = bufferSizeExpected;
+
+        if (findGroup (sourceSampleRate) == nullptr)
+            newGroup.reset (new RateGroup (sourceSampleRate, quality, numChannels));
+    }
+
+    // preparing can take a while, so it happens before the lock is taken
+    if (sampleRate > 0)
+    {
+        newInput->prepareToPlay (getInputBlockSize (sourceSampleRate, blockSize, sampleRate), sourceSampleRate);
+
+        if (newGroup != nullptr)
+            prepareGroup (*newGroup, blockSize, sampleRate);
+    }
+
+    const ScopedLock sl (lock);
+    auto* group = findGroup (sourceSampleRate);
+
+    // another thread may have added a group for this rate in the meantime
+    if (group == nullptr)
+        group = groups.add (newGroup.release());
+
+    group->inputsToDelete.setBit (group->inputs.size(), deleteWhenRemoved);
+    group->inputs.add (newInput);
+}
+
+void SRCMultiRateMixerSource::removeInputSource (AudioSource* const input)
+{
+    if (input == nullptr)
+        return;
+
+    std::unique_ptr<AudioSource> toDelete;
+    std::unique_ptr<RateGroup> emptyGroup;
+    auto found = false;
+
+    {
+        const ScopedLock sl (lock);
+
+        for (auto* group : groups)
+        {
+            const auto index = group->inputs.indexOf (input);
+
+            if (index < 0)
+                continue;
+
+            found = true;
+
+            if (group->inputsToDelete[index])
+                toDelete.reset (input);
+
+            group->inputsToDelete.shiftBits (-1, index);
+            group->inputs.remove (index);
+
+            if (group->inputs.size() == 0)
+                emptyGroup.reset (groups.removeAndReturn (groups.indexOf (group)));
+
+            break;
+        }
+    }
+
+    if (found)
+        input->releaseResources();
+}
+
+void SRCMultiRateMixerSource::removeAllInputs()
+{
+    OwnedArray<RateGroup> oldGroups;
+
+    {
+        const ScopedLock sl (lock);
+        oldGroups.swapWith (groups);
+    }
+
+    for (auto* group : oldGroups)
+        group->releaseResources();
+}
+
+int SRCMultiRateMixerSource::getNumInputs() const
+{
+    const ScopedLock sl (lock);
+    auto numInputs = 0;
+
+    for (auto* group : groups)
+        numInputs += group->inputs.size();
+
+    return numInputs;
+}
+
+int SRCMultiRateMixerSource::getNumRateGroups() const
+{
+    const ScopedLock sl (lock);
+    return groups.size();
+}
+
+//==============================================================================
+void SRCMultiRateMixerSource::prepareToPlay (const int samplesPerBlockExpected, const double sampleRate)
+{
+    tempBuffer.setSize (numChannels, samplesPerBlockExpected);
+
+    const ScopedLock sl (lock);
+
+    currentSampleRate = sampleRate;
+    bufferSizeExpected = samplesPerBlockExpected;
+
+    for (auto* group : groups)
+        prepareGroup (*group, samplesPerBlockExpected, sampleRate);
+}
+
+void SRCMultiRateMixerSource::releaseResources()
+{
+    const ScopedLock sl (lock);
+
+    for (auto* group : groups)
+    {
+        if (group->isConverted)
+            group->converter.releaseResources();
+        else
+            group->releaseResources();
+    }
+
+    tempBuffer.setSize (numChannels, 0);
+
+    currentSampleRate = 0;
+    bufferSizeExpected = 0;
+}
+
+void SRCMultiRateMixerSource::renderGroup (RateGroup& group, const AudioSourceChannelInfo& info)
+{
+    if (group.isConverted)
+        group.converter.getNextAudioBlock (info);
+    else
+        group.getNextAudioBlock (info);
+}
+
+void SRCMultiRateMixerSource::getNextAudioBlock (const AudioSourceChannelInfo& info)
+{
+    const ScopedLock sl (lock);
+
+    if (groups.size() == 0)
+    {
+        info.clearActiveBufferRegion();
+        return;
+    }
+
+    renderGroup (*groups.getUnchecked (0), info);
+
+    if (groups.size() > 1)
+    {
+        tempBuffer.setSize (jmax (1, info.buffer->getNumChannels()), info.numSamples, false, false, true);
+        AudioSourceChannelInfo tempInfo (&tempBuffer, 0, info.numSamples);
+
+        for (auto i = 1; i < groups.size(); ++i)
+        {
+            renderGroup (*groups.getUnchecked (i), tempInfo);
+
+            for (auto channel = 0; channel < info.buffer->getNumChannels(); ++channel)
+                info.buffer->addFrom (channel, info.startSample, tempBuffer, channel, 0, info.numSamples);
+        }
+    }
+}
+
+} // namespace juce
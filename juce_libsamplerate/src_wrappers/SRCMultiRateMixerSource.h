@@ -0,0 +1,126 @@
+/*
+ ==============================================================================
+    Copyright (c) 2019, Tal Aviram
+    All rights reserved.
+
+    This code is released under 2-clause BSD license. Please see the
+    file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#pragma once
+
+namespace juce
+{
+
+//==============================================================================
+/**
+ An AudioSource that mixes inputs of different sample-rates, converting each rate once.
+
+ Every input is given with its own sample-rate. Inputs that share a rate are summed at
+ that rate first, and each of these sums goes through a single SRCAudioSource to the
+ output sample-rate. A mix of hundreds of inputs in a few distinct rates then costs a
+ few conversions instead of hundreds; as conversion is linear, the result only differs
+ by rounding. Inputs at the output sample-rate are summed without any conversion.
+
+ Like MixerAudioSource, the inputs are prepared with this source and added and removed
+ under a lock, so this can be done while playing.
+
+ @see MixerAudioSource, SRCAudioSource
+
+ @tags{Audio}
+ */
+class SRCMultiRateMixerSource  : public AudioSource
+{
+public:
+    typedef libsamplerate::SRC::ResamplerQuality ResamplerQuality;
+
+    //==============================================================================
+    /** Creates an empty mixer.
+
+     @param quality      quality / type of sample rate conversion used for every rate
+     @param numChannels  the number of channels to mix
+     */
+    SRCMultiRateMixerSource (ResamplerQuality quality = ResamplerQuality::SRC_SINC_MEDIUM_QUALITY,
+                             int numChannels = 2);
+
+    /** Destructor. */
+    ~SRCMultiRateMixerSource() override;
+
+    //==============================================================================
+    /** Adds an input source to the mixer.
+
+     If the mixer is running, the input is prepared at its own sample-rate on the calling
+     thread before it's added.
+
+     @param newInput             the source to add. Adding the same source twice is ignored.
+     @param sourceSampleRate     the sample-rate the input plays at
+     @param deleteWhenRemoved    if true, the source is deleted when it is removed from
+                                 the mixer or when the mixer is deleted
+     */
+    void addInputSource (AudioSource* newInput, double sourceSampleRate, bool deleteWhenRemoved);
+
+    /** Removes an input source. If it was added with deleteWhenRemoved, it is deleted. */
+    void removeInputSource (AudioSource* input);
+
+    /** Removes every input source. */
+    void removeAllInputs();
+
+    /** Returns the number of inputs. */
+    int getNumInputs() const;
+
+    /** Returns the number of distinct sample-rates among the inputs, which is the
+        number of conversions (or unconverted sums) done per block. */
+    int getNumRateGroups() const;
+
+    //==============================================================================
+    void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock (const AudioSourceChannelInfo&) override;
+
+private:
+    //==============================================================================
+    /** Sums the inputs of one sample-rate, feeding the converter of that rate. */
+    class RateGroup  : public AudioSource
+    {
+    public:
+        RateGroup (double sourceSampleRate, ResamplerQuality, int numChannels);
+        ~RateGroup() override;
+
+        void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override;
+        void releaseResources() override;
+        void getNextAudioBlock (const AudioSourceChannelInfo&) override;
+
+        const double sourceSampleRate;
+        SRCAudioSource converter;
+        bool isConverted = true;
+
+        Array<AudioSource*> inputs;
+        BigInteger inputsToDelete;
+
+    private:
+        const int numChannels;
+        AudioBuffer<float> tempBuffer;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RateGroup)
+    };
+
+    RateGroup* findGroup (double sourceSampleRate) const noexcept;
+    void prepareGroup (RateGroup&, int blockSize, double sampleRate);
+    static int getInputBlockSize (double sourceSampleRate, int blockSize, double sampleRate) noexcept;
+    void renderGroup (RateGroup&, const AudioSourceChannelInfo&);
+
+    //==============================================================================
+    const ResamplerQuality quality;
+    const int numChannels;
+
+    OwnedArray<RateGroup> groups;
+    CriticalSection lock;
+    AudioBuffer<float> tempBuffer;
+    double currentSampleRate = 0.0;
+    int bufferSizeExpected = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SRCMultiRateMixerSource)
+};
+
+} // namespace juce
@@ -0,0 +1,79 @@
+/*
+ ==============================================================================
+ Copyright (c) 2019, Tal Aviram
+ All rights reserved.
+
+ This code is released under 2-clause BSD license. Please see the
+ file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#include "SRCMultiStreamConverter.h"
+
+namespace juce
+{
+
+namespace SRCPolyphaseHelpers
+{
+    /** Zeroth order modified Bessel function of the first kind, for the Kaiser window. */
+    static double besselI0 (const double x) noexcept
+    {
+        auto sum = 1.0, term = 1.0;
+
+        for (auto k = 1; k < 64 && term > sum * 1.0e-12; ++k)
+        {
+            const auto halfXOverK = x / (2.0 * k);
+            term *= halfXOverK * halfXOverK;
+            sum += term;
+        }
+
+        return sum;
+    }
+}
+
+SRCPolyphaseTable::SRCPolyphaseTable (const int taps, const int phases, const double cutoff, const double kaiserBeta)
+    : numTaps (taps),
+      numPhases (phases)
+{
+    using namespace SRCPolyphaseHelpers;
+
+    jassert (numTaps > 0 && numPhases > 0 && cutoff > 0 && cutoff <= 1.0);
+
+    const auto tapsBeforePosition = jmax (0, numTaps / 2 - 1);
+    const auto halfLength = numTaps / 2.0;
+    const auto windowScale = 1.0 / besselI0 (kaiserBeta);
+
+    coefficients.malloc ((size_t) ((numPhases + 1) * numTaps));
+
+    for (auto phase = 0; phase <= numPhases; ++phase)
+    {
+        auto* row = coefficients + phase * numTaps;
+        const auto fraction = phase / (double) numPhases;
+        auto sum = 0.0;
+
+        for (auto tap = 0; tap < numTaps; ++tap)
+        {
+            // distance from the output position to the input sample under this tap
+            const auto x = tap - tapsBeforePosition - fraction;
+            const auto arg = MathConstants<double>::pi * cutoff * x;
+            const auto sinc = std::abs (arg) < 1.0e-9 ? 1.0 : std::sin (arg) / arg;
+            const auto w = x / halfLength;
+            const auto window = std::abs (w) < 1.0 ? besselI0 (kaiserBeta * std::sqrt (1.0 - w * w)) * windowScale : 0.0;
+
+            row[tap] = (float) (sinc * window);
+            sum += row[tap];
+        }
+
+        // normalise each phase for unity gain at DC
+        for (auto tap = 0; tap < numTaps; ++tap)
+            row[tap] = (float) (row[tap] / sum);
+    }
+}
+
+const SRCPolyphaseTable& SRCPolyphaseTable::getShortSincTable()
+{
+    static const SRCPolyphaseTable table (8, 512, 0.9, 6.0);
+    return table;
+}
+
+} // namespace juce
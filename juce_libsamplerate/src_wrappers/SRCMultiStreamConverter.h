@@ -0,0 +1,375 @@
+/*
+ ==============================================================================
+    Copyright (c) 2019, Tal Aviram
+    All rights reserved.
+
+    This code is released under 2-clause BSD license. Please see the
+    file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#pragma once
+
+namespace juce
+{
+
+//==============================================================================
+/**
+ A table of windowed-sinc interpolation kernels, one row of taps per fractional phase.
+
+ Row numPhases is the kernel for a fraction of 1.0, so a fractional phase can be
+ interpolated between two rows without wrapping.
+
+ @see SRCMultiStreamConverter
+
+ @tags{Audio}
+ */
+class SRCPolyphaseTable
+{
+public:
+    /** Builds a Kaiser-windowed sinc table.
+
+     @param numTaps      the length of each kernel, in input samples
+     @param numPhases    the number of fractional phases between two input samples
+     @param cutoff       the cutoff frequency, relative to the input Nyquist frequency
+     @param kaiserBeta   the shape of the Kaiser window
+     */
+    SRCPolyphaseTable (int numTaps, int numPhases, double cutoff, double kaiserBeta);
+
+    /** Returns the 8-tap table shared by every SRCMultiStreamConverter. */
+    static const SRCPolyphaseTable& getShortSincTable();
+
+    int getNumTaps() const noexcept                         { return numTaps; }
+    int getNumPhases() const noexcept                       { return numPhases; }
+
+    /** Returns the taps of one phase, 0 <= phase <= getNumPhases(). */
+    const float* getPhase (int phase) const noexcept        { return coefficients + phase * numTaps; }
+
+private:
+    const int numTaps, numPhases;
+    HeapBlock<float> coefficients;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SRCPolyphaseTable)
+};
+
+//==============================================================================
+/**
+ Resamples numLanes independent mono streams at once, one stream per SIMD lane.
+
+ Each stream has its own conversion ratio and phase, but the state of all the streams is
+ kept as structure-of-arrays (positions, increments and input history, interleaved by lane).
+ For every output frame, the input and kernel rows under each lane are gathered tap by tap,
+ and then each tap is applied to all the lanes at once with FloatVectorOperations, so the
+ full vector width is used even with kernels that only have one or two taps, where running
+ the streams one by one would leave most of it idle. The sinc mode reads one shared
+ coefficient table for every lane.
+
+ The kernels are meant for cheap, close-to-unity conversions (voices, large mixers); the
+ sinc kernel doesn't narrow its cutoff when downsampling, so use SRCAudioSource for
+ large downsampling ratios.
+
+ Usage, per block:
+ - call getNumInputFramesNeeded() for each lane and pull that many frames from its stream.
+ - call process() with every lane's input and output.
+
+ @see SRCAudioSource, SRCPolyphaseTable
+
+ @tags{Audio}
+ */
+template <int numLanes>
+class SRCMultiStreamConverter
+{
+public:
+    static_assert (numLanes == 4 || numLanes == 8 || numLanes == 16, "Lanes should match a SIMD register width");
+
+    enum Mode
+    {
+        zeroOrderHold,
+        linear,
+        shortSinc
+    };
+
+    //==============================================================================
+    /** Creates a converter.
+
+     @param modeToUse    the interpolation kernel used by every lane
+     */
+    explicit SRCMultiStreamConverter (Mode modeToUse = linear)
+        : mode (modeToUse),
+          table (SRCPolyphaseTable::getShortSincTable()),
+          numTaps (mode == zeroOrderHold ? 1 : (mode == linear ? 2 : table.getNumTaps())),
+          tapsBeforePosition (jmax (0, numTaps / 2 - 1))
+    {
+        for (auto lane = 0; lane < numLanes; ++lane)
+            increment[lane] = 1.0;
+
+        reset();
+    }
+
+    /** Allocates the work buffers. Call this before processing, off the audio thread.
+
+     @param maxOutputFrames              the largest block that process() will be asked for
+     @param maxSamplesInPerOutputSample  the largest ratio any lane will be set to
+     */
+    void prepare (int maxOutputFrames, double maxSamplesInPerOutputSample)
+    {
+        jassert (maxOutputFrames > 0 && maxSamplesInPerOutputSample > 0);
+
+        maxOutput = maxOutputFrames;
+        maxRatio = maxSamplesInPerOutputSample;
+        maxInput = (int) std::ceil (maxOutput * maxRatio) + numTaps + 1;
+
+        work.calloc ((size_t) ((numTaps + maxInput) * numLanes));
+        output.calloc ((size_t) (maxOutput * numLanes));
+        reset();
+    }
+
+    /** Clears the history and phase of every lane. */
+    void reset() noexcept
+    {
+        for (auto lane = 0; lane < numLanes; ++lane)
+            position[lane] = 0.0;
+
+        for (auto i = 0; i < maxTaps * numLanes; ++i)
+            history[i] = 0.0f;
+    }
+
+    /** Clears the history and phase of a single lane, e.g. when it starts a new stream. */
+    void resetLane (int lane) noexcept
+    {
+        jassert (isPositiveAndBelow (lane, numLanes));
+        position[lane] = 0.0;
+
+        for (auto i = 0; i < numTaps; ++i)
+            history[i * numLanes + lane] = 0.0f;
+    }
+
+    //==============================================================================
+    /** Changes the conversion ratio of a lane.
+
+     @param samplesInPerOutputSample     1.0 passes through, higher values will speed the
+                                         stream up, lower values will slow it down. It must not
+                                         exceed the maximum given to prepare().
+     */
+    void setResamplingRatio (int lane, double samplesInPerOutputSample) noexcept
+    {
+        jassert (isPositiveAndBelow (lane, numLanes));
+        jassert (samplesInPerOutputSample > 0 && samplesInPerOutputSample <= maxRatio);
+        increment[lane] = samplesInPerOutputSample;
+    }
+
+    /** Returns the conversion ratio of a lane. */
+    double getResamplingRatio (int lane) const noexcept    { return increment[lane]; }
+
+    /** Returns the number of input frames a lane consumes to produce numOutputFrames. */
+    int getNumInputFramesNeeded (int lane, int numOutputFrames) const noexcept
+    {
+        jassert (isPositiveAndBelow (lane, numLanes) && numOutputFrames > 0);
+        const auto lastTap = (int) std::floor (position[lane] + (numOutputFrames - 1) * increment[lane])
+                               + numTaps - tapsBeforePosition - 1;
+        return jmax (0, lastTap + 1);
+    }
+
+    //==============================================================================
+    /** Converts one block on every lane.
+
+     @param inputs           one pointer per lane, holding getNumInputFramesNeeded() frames.
+                             A nullptr is read as silence.
+     @param outputs          one pointer per lane, receiving numOutputFrames frames.
+                             A nullptr discards that lane's output.
+     @param numOutputFrames  the number of frames to generate, up to the maximum given
+                             to prepare()
+     */
+    void process (const float* const* inputs, float* const* outputs, int numOutputFrames) noexcept
+    {
+        jassert (work != nullptr && numOutputFrames <= maxOutput);
+
+        int needed[numLanes];
+
+        for (auto lane = 0; lane < numLanes; ++lane)
+        {
+            needed[lane] = getNumInputFramesNeeded (lane, numOutputFrames);
+            jassert (needed[lane] <= maxInput);
+        }
+
+        gatherInput (inputs, needed);
+        startBlock (needed);
+
+        switch (mode)
+        {
+            case zeroOrderHold: processZeroOrderHold (numOutputFrames); break;
+            case linear:        processLinear (numOutputFrames); break;
+            case shortSinc:     processSinc (numOutputFrames); break;
+            default:            jassertfalse; break;
+        }
+
+        scatterOutput (outputs, numOutputFrames);
+        keepHistory (needed, numOutputFrames);
+    }
+
+private:
+    //==============================================================================
+    enum { maxTaps = 16 };
+
+    // Work frame j holds stream frame (lastReceived - numTaps + 1 + j), so the history
+    // fills frames [0, numTaps) and the new input follows it.
+    void gatherInput (const float* const* inputs, const int* needed) noexcept
+    {
+        for (auto i = 0; i < numTaps * numLanes; ++i)
+            work[i] = history[i];
+
+        for (auto lane = 0; lane < numLanes; ++lane)
+        {
+            auto* dest = work + numTaps * numLanes + lane;
+            const auto* src = inputs[lane];
+
+            for (auto i = 0; i < needed[lane]; ++i)
+                dest[i * numLanes] = src != nullptr ? src[i] : 0.0f;
+        }
+    }
+
+    // Positions are floats within a block, so they're computed for every lane at once; each
+    // block starts again from the double positions, so the error doesn't build up.
+    void startBlock (const int* needed) noexcept
+    {
+        for (auto lane = 0; lane < numLanes; ++lane)
+        {
+            blockStart[lane] = (float) (position[lane] + numTaps);
+            blockIncrement[lane] = (float) increment[lane];
+
+            // the furthest a kernel can start without reading past the input that was gathered
+            lastIndex[lane] = needed[lane] + tapsBeforePosition;
+        }
+    }
+
+    // finds the work frame each lane reads for output frame i, and the fraction past it
+    void findFramePositions (int i) noexcept
+    {
+        FloatVectorOperations::copy (framePosition, blockStart, numLanes);
+        FloatVectorOperations::addWithMultiply (framePosition, blockIncrement, (float) i, numLanes);
+
+        for (auto lane = 0; lane < numLanes; ++lane)
+        {
+            // rounding can leave a float position a hair past the double one the input was sized for
+            frameIndex[lane] = jmin ((int) framePosition[lane], lastIndex[lane]);
+            fraction[lane] = jmin (1.0f, framePosition[lane] - (float) frameIndex[lane]);
+        }
+    }
+
+    void processZeroOrderHold (int numOutputFrames) noexcept
+    {
+        for (auto i = 0; i < numOutputFrames; ++i)
+        {
+            findFramePositions (i);
+            auto* out = output + i * numLanes;
+
+            for (auto lane = 0; lane < numLanes; ++lane)
+                out[lane] = work[frameIndex[lane] * numLanes + lane];
+        }
+    }
+
+    void processLinear (int numOutputFrames) noexcept
+    {
+        auto* next = samples + numLanes;
+
+        for (auto i = 0; i < numOutputFrames; ++i)
+        {
+            findFramePositions (i);
+
+            for (auto lane = 0; lane < numLanes; ++lane)
+            {
+                samples[lane] = work[frameIndex[lane] * numLanes + lane];
+                next[lane] = work[(frameIndex[lane] + 1) * numLanes + lane];
+            }
+
+            auto* out = output + i * numLanes;
+            FloatVectorOperations::subtract (next, next, samples, numLanes);
+            FloatVectorOperations::copy (out, samples, numLanes);
+            FloatVectorOperations::addWithMultiply (out, fraction, next, numLanes);
+        }
+    }
+
+    void processSinc (int numOutputFrames) noexcept
+    {
+        const auto numPhases = table.getNumPhases();
+
+        for (auto i = 0; i < numOutputFrames; ++i)
+        {
+            findFramePositions (i);
+
+            // gathers each lane's kernel rows and input, tap by tap, so the taps can be
+            // summed across all the lanes at once
+            for (auto lane = 0; lane < numLanes; ++lane)
+            {
+                // a fraction just below 1 can round up to the last row, which has no row after it
+                const auto phase = fraction[lane] * (float) numPhases;
+                const auto phaseIndex = jmin ((int) phase, numPhases - 1);
+                phaseFraction[lane] = phase - (float) phaseIndex;
+
+                const auto* c0 = table.getPhase (phaseIndex);
+                const auto* c1 = table.getPhase (phaseIndex + 1);
+                const auto* in = work + (frameIndex[lane] - tapsBeforePosition) * numLanes + lane;
+
+                for (auto tap = 0; tap < numTaps; ++tap)
+                {
+                    coefficients[tap * numLanes + lane] = c0[tap];
+                    coefficientSlopes[tap * numLanes + lane] = c1[tap] - c0[tap];
+                    samples[tap * numLanes + lane] = in[tap * numLanes];
+                }
+            }
+
+            auto* out = output + i * numLanes;
+            FloatVectorOperations::clear (out, numLanes);
+
+            for (auto tap = 0; tap < numTaps; ++tap)
+            {
+                auto* tapCoefficients = coefficients + tap * numLanes;
+                FloatVectorOperations::addWithMultiply (tapCoefficients, coefficientSlopes + tap * numLanes, phaseFraction, numLanes);
+                FloatVectorOperations::addWithMultiply (out, tapCoefficients, samples + tap * numLanes, numLanes);
+            }
+        }
+    }
+
+    void scatterOutput (float* const* outputs, int numOutputFrames) noexcept
+    {
+        for (auto lane = 0; lane < numLanes; ++lane)
+            if (auto* dest = outputs[lane])
+                for (auto i = 0; i < numOutputFrames; ++i)
+                    dest[i] = output[i * numLanes + lane];
+    }
+
+    void keepHistory (const int* needed, int numOutputFrames) noexcept
+    {
+        for (auto lane = 0; lane < numLanes; ++lane)
+        {
+            // the last numTaps frames received become the history of the next block
+            for (auto i = 0; i < numTaps; ++i)
+                history[i * numLanes + lane] = work[(needed[lane] + i) * numLanes + lane];
+
+            position[lane] += numOutputFrames * increment[lane] - needed[lane];
+        }
+    }
+
+    //==============================================================================
+    const Mode mode;
+    const SRCPolyphaseTable& table;
+    const int numTaps, tapsBeforePosition;
+    int maxOutput = 0, maxInput = 0;
+    double maxRatio = 1.0;
+
+    // position of each lane relative to the first frame that wasn't received yet
+    double position[numLanes];
+    double increment[numLanes];
+    float history[maxTaps * numLanes];
+
+    // per block and per output frame, one entry per lane (and per tap), so the maths runs across the lanes
+    float blockStart[numLanes], blockIncrement[numLanes], framePosition[numLanes], fraction[numLanes], phaseFraction[numLanes];
+    int frameIndex[numLanes], lastIndex[numLanes];
+    float coefficients[maxTaps * numLanes], coefficientSlopes[maxTaps * numLanes], samples[maxTaps * numLanes];
+
+    HeapBlock<float> work, output;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SRCMultiStreamConverter)
+};
+
+} // namespace juce
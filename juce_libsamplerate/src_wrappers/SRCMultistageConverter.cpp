@@ -0,0 +1,515 @@
+/*
+ ==============================================================================
+ Copyright (c) 2019, Tal Aviram
+ All rights reserved.
+
+ This code is released under 2-clause BSD license. Please see the
+ file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#include "SRCMultistageConverter.h"
+
+namespace juce
+{
+
+namespace SRCMultistageHelpers
+{
+    struct Design
+    {
+        double bandwidth;       // of the output's Nyquist frequency (or the input's, upsampling)
+        double attenuationDb;
+    };
+
+    // the bandwidth and stopband libsamplerate gives each quality
+    static Design getDesign (const libsamplerate::SRC::ResamplerQuality quality) noexcept
+    {
+        switch (quality)
+        {
+            case libsamplerate::SRC::SRC_SINC_BEST_QUALITY:     return { 0.96, 145.0 };
+            case libsamplerate::SRC::SRC_SINC_MEDIUM_QUALITY:   return { 0.90, 121.0 };
+            default:                                            return { 0.80, 97.0 };
+        }
+    }
+
+    static double besselI0 (const double x) noexcept
+    {
+        auto sum = 1.0, term = 1.0;
+
+        for (auto k = 1; k < 64 && term > sum * 1.0e-12; ++k)
+        {
+            const auto halfXOverK = x / (2.0 * k);
+            term *= halfXOverK * halfXOverK;
+            sum += term;
+        }
+
+        return sum;
+    }
+
+    // the number of non-zero taps on each side of the centre, for a half-band that keeps
+    // protectedFraction of its (higher) sample-rate free of aliases or images
+    static int getNumCoefficients (const double protectedFraction, const double attenuationDb) noexcept
+    {
+        const auto transition = jmax (0.01, 0.5 - 2.0 * protectedFraction);
+        const auto numTaps = (int) std::ceil ((attenuationDb - 7.95) / (14.36 * transition)) + 1;
+        return jmax (2, (numTaps + 4) / 4);
+    }
+}
+
+//==============================================================================
+/**
+ A Kaiser-windowed half-band filter of length 4 * numCoefficients - 1, halving or doubling
+ the rate. Only the centre tap and the taps at odd distances from it are non-zero, and
+ these are symmetric, so each output reads numCoefficients pairs.
+ */
+class SRCMultistageConverter::HalfBandStage
+{
+public:
+    HalfBandStage (const int channels, const double protectedFraction, const double attenuationDb, const bool isDecimator)
+        : numCoefficients (SRCMultistageHelpers::getNumCoefficients (protectedFraction, attenuationDb)),
+          decimating (isDecimator),
+          historyLength (decimating ? 4 * numCoefficients - 2 : 2 * numCoefficients - 1),
+          history (channels, historyLength + chunkSize + (1 << maxNumStages))
+    {
+        coefficients.allocate ((size_t) numCoefficients, true);
+
+        const auto beta = 0.1102 * (attenuationDb - 8.7);
+        const auto halfLength = (double) (2 * numCoefficients - 1);
+        const auto norm = 1.0 / SRCMultistageHelpers::besselI0 (beta);
+        auto sum = 0.0;
+
+        for (auto j = 0; j < numCoefficients; ++j)
+        {
+            const auto distance = (double) (2 * j + 1);
+            const auto x = distance / halfLength;
+            const auto window = SRCMultistageHelpers::besselI0 (beta * std::sqrt (jmax (0.0, 1.0 - x * x))) * norm;
+            const auto tap = ((j & 1) == 0 ? 1.0 : -1.0) / (MathConstants<double>::pi * distance) * window;
+            coefficients[j] = (float) tap;
+            sum += tap;
+        }
+
+        // unity gain at DC: the centre tap is 0.5, so the pairs add up to the other half.
+        // Interpolating, the zeros stuffed between the inputs halve the gain, which is made up here
+        const auto scale = (decimating ? 0.25 : 0.5) / sum;
+
+        for (auto j = 0; j < numCoefficients; ++j)
+            coefficients[j] = (float) (coefficients[j] * scale);
+
+        reset();
+    }
+
+    /** Clears the history, optionally delaying what follows by a few more samples. */
+    void reset (const int extraDelay = 0) noexcept
+    {
+        jassert (extraDelay < (1 << maxNumStages));
+        history.clear();
+        numBuffered = historyLength + extraDelay;
+    }
+
+    /** Halves the rate of numInput frames (at most chunkSize), returning the outputs written. */
+    int decimate (const float* const* input, const int numInput, float* const* output) noexcept
+    {
+        const auto length = 4 * numCoefficients - 1;
+        const auto centre = 2 * numCoefficients - 1;
+        const auto total = numBuffered + numInput;
+        const auto numOutput = total >= length ? (total - length) / 2 + 1 : 0;
+
+        for (auto channel = 0; channel < history.getNumChannels(); ++channel)
+        {
+            auto* data = history.getWritePointer (channel);
+            FloatVectorOperations::copy (data + numBuffered, input[channel], numInput);
+
+            for (auto i = 0; i < numOutput; ++i)
+            {
+                const auto* centreSample = data + 2 * i + centre;
+                auto sum = 0.5f * *centreSample;
+
+                for (auto j = 0; j < numCoefficients; ++j)
+                    sum += coefficients[j] * (centreSample[-1 - 2 * j] + centreSample[1 + 2 * j]);
+
+                output[channel][i] = sum;
+            }
+
+            std::memmove (data, data + 2 * numOutput, sizeof (float) * (size_t) (total - 2 * numOutput));
+        }
+
+        numBuffered = total - 2 * numOutput;
+        return numOutput;
+    }
+
+    /** Doubles the rate of numInput frames (at most chunkSize), writing twice as many outputs. */
+    int interpolate (const float* const* input, const int numInput, float* const* output) noexcept
+    {
+        for (auto channel = 0; channel < history.getNumChannels(); ++channel)
+        {
+            auto* data = history.getWritePointer (channel);
+            FloatVectorOperations::copy (data + numBuffered, input[channel], numInput);
+
+            for (auto i = 0; i < numInput; ++i)
+            {
+                // the two outputs sit either side of the middle of this window
+                const auto* middle = data + i + numCoefficients;
+                auto sum = 0.0f;
+
+                for (auto j = 0; j < numCoefficients; ++j)
+                    sum += coefficients[j] * (middle[-1 - j] + middle[j]);
+
+                output[channel][2 * i] = sum;
+                output[channel][2 * i + 1] = *middle;
+            }
+
+            std::memmove (data, data + numInput, sizeof (float) * (size_t) historyLength);
+        }
+
+        numBuffered = historyLength;
+        return 2 * numInput;
+    }
+
+    /** The group delay, in samples of the higher rate. */
+    int getDelay() const noexcept                           { return 2 * numCoefficients - 1; }
+
+    /** The span of one output, in samples of the stage's input. */
+    int getReach() const noexcept                           { return decimating ? 4 * numCoefficients - 1 : 2 * numCoefficients; }
+
+    /** The bytes of the coefficients and history. */
+    size_t getSizeInBytes() const noexcept
+    {
+        return sizeof (*this) + sizeof (float) * (size_t) (numCoefficients + history.getNumChannels() * history.getNumSamples());
+    }
+
+private:
+    const int numCoefficients;
+    const bool decimating;
+    const int historyLength;
+    HeapBlock<float> coefficients;
+    AudioBuffer<float> history;
+    int numBuffered = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (HalfBandStage)
+};
+
+//==============================================================================
+SRCMultistageConverter::SRCMultistageConverter (const ResamplerQuality qualityToUse, const int channels,
+                                                const double samplesInPerOutputSample)
+    : quality (qualityToUse),
+      numChannels (channels),
+      readPointers ((size_t) channels),
+      writePointers ((size_t) channels)
+{
+    jassert (numChannels > 0 && samplesInPerOutputSample > 0);
+
+    if (SRCFastInterpolator::supportsQuality (quality))
+        fastInterpolator.reset (new SRCFastInterpolator (quality, numChannels));
+    else
+        sincConverter.reset (new SRCSincConverter (SRCCoefficientTable::getTable (quality, SRCCoefficientTable::exactHalfTable),
+                                                   numChannels, (double) SRC_MAX_RATIO / (1 << maxNumStages)));
+
+    // the first stage can be preloaded with up to (1 << maxNumStages) frames of latency
+    // compensation, which a full chunk passes on as up to half as many extra outputs
+    for (auto& buffer : work)
+        buffer.setSize (numChannels, chunkSize / 2 + (1 << maxNumStages) / 2 + 2);
+
+    pending.setSize (numChannels, chunkSize + 2);
+
+    createStages (samplesInPerOutputSample);
+    setResamplingRatio (samplesInPerOutputSample);
+    reset();
+}
+
+SRCMultistageConverter::~SRCMultistageConverter()
+{
+}
+
+size_t SRCMultistageConverter::getSizeInBytes() const noexcept
+{
+    auto size = sizeof (*this) + sizeof (float) * (size_t) (numChannels * (work[0].getNumSamples() + work[1].getNumSamples()
+                                                                           + pending.getNumSamples()));
+
+    for (auto* stage : stages)
+        size += stage->getSizeInBytes();
+
+    if (sincConverter != nullptr)
+        size += sincConverter->getSizeInBytes();
+
+    return size;
+}
+
+//==============================================================================
+int SRCMultistageConverter::getNumStagesFor (const double samplesInPerOutputSample) noexcept
+{
+    const auto tolerance = 1.0 - 1.0e-9;
+    auto numStages = 0;
+
+    if (samplesInPerOutputSample >= 1.0)
+    {
+        while (numStages < maxNumStages && samplesInPerOutputSample >= (double) (2 << numStages) * tolerance)
+            ++numStages;
+    }
+    else
+    {
+        while (numStages < maxNumStages && samplesInPerOutputSample * (double) (2 << numStages) * tolerance <= 1.0)
+            ++numStages;
+    }
+
+    return numStages;
+}
+
+bool SRCMultistageConverter::hasStagesFor (const double samplesInPerOutputSample) const noexcept
+{
+    return getNumStagesFor (samplesInPerOutputSample) == stages.size()
+            && (stages.isEmpty() || (samplesInPerOutputSample >= 1.0) == decimating);
+}
+
+void SRCMultistageConverter::createStages (const double samplesInPerOutputSample)
+{
+    const auto design = SRCMultistageHelpers::getDesign (quality);
+    const auto numStages = getNumStagesFor (samplesInPerOutputSample);
+
+    stages.clear();
+    decimating = samplesInPerOutputSample >= 1.0;
+    latency = 0.0;
+    auto delay = 0; // in input samples decimating, in output samples interpolating
+
+    for (auto i = 0; i < numStages; ++i)
+    {
+        // the band to protect, as a fraction of the stage's higher rate: decimating, that's
+        // the output's band; interpolating, the input's
+        const auto protectedFraction = decimating
+            ? 0.5 * design.bandwidth * (double) (1 << i) / samplesInPerOutputSample
+            : 0.5 * design.bandwidth * samplesInPerOutputSample * (double) (1 << numStages) / (double) (2 << i);
+
+        auto* stage = stages.add (new HalfBandStage (numChannels, protectedFraction, design.attenuationDb, decimating));
+
+        delay += stage->getDelay() * (decimating ? (1 << i) : (1 << (numStages - 1 - i)));
+    }
+
+    if (decimating)
+    {
+        const auto rateDivider = 1 << numStages;
+        compensationPadding = (rateDivider - delay % rateDivider) % rateDivider;
+        compensationLength = (delay + compensationPadding) / rateDivider;
+        latency = delay / samplesInPerOutputSample;
+    }
+    else
+    {
+        compensationPadding = 0;
+        compensationLength = delay;
+        latency = delay;
+    }
+}
+
+double SRCMultistageConverter::getResidualRatio (const double samplesInPerOutputSample) const noexcept
+{
+    const auto scale = (double) (1 << stages.size());
+    return decimating ? samplesInPerOutputSample / scale : samplesInPerOutputSample * scale;
+}
+
+void SRCMultistageConverter::setResamplingRatio (const double samplesInPerOutputSample)
+{
+    jassert (samplesInPerOutputSample > 0);
+
+    if (! hasStagesFor (samplesInPerOutputSample))
+    {
+        createStages (samplesInPerOutputSample);
+        reset();
+    }
+
+    if (fastInterpolator != nullptr)
+        fastInterpolator->setResamplingRatio (getResidualRatio (samplesInPerOutputSample));
+    else
+        sincConverter->setResamplingRatio (getResidualRatio (samplesInPerOutputSample));
+}
+
+void SRCMultistageConverter::reset() noexcept
+{
+    for (auto* stage : stages)
+        stage->reset (compensatesLatency && stage == stages.getFirst() ? compensationPadding : 0);
+
+    if (fastInterpolator != nullptr)
+        fastInterpolator->reset();
+    else
+        sincConverter->reset();
+
+    pendingStart = numPending = 0;
+    numToSkip = compensatesLatency ? compensationLength : 0;
+}
+
+void SRCMultistageConverter::setPending (const int numFrames) noexcept
+{
+    const auto numSkipped = jmin (numToSkip, numFrames);
+    numToSkip -= numSkipped;
+    pendingStart = numSkipped;
+    numPending = numFrames - numSkipped;
+}
+
+int SRCMultistageConverter::getFilterReach() const noexcept
+{
+    auto residualReach = 2.0;
+
+    if (sincConverter != nullptr)
+    {
+        const auto& table = SRCCoefficientTable::getTable (quality, SRCCoefficientTable::original);
+        residualReach = (double) table.getHalfLength() / table.getIncrement() + 2.0;
+    }
+
+    auto reach = 0.0;
+
+    if (decimating)
+    {
+        // each stage runs at half the rate of the one before, and the remaining
+        // converter reaches over at most twice its filter at a ratio below 2
+        for (auto i = 0; i < stages.size(); ++i)
+            reach += stages.getUnchecked (i)->getReach() * (double) (1 << i);
+
+        reach += residualReach * 2.0 * (double) (1 << stages.size());
+    }
+    else
+    {
+        // the stages run above the input rate, doubling each time
+        reach += residualReach;
+
+        for (auto i = 0; i < stages.size(); ++i)
+            reach += stages.getUnchecked (i)->getReach() / (double) (1 << i);
+    }
+
+    return (int) std::ceil (reach);
+}
+
+//==============================================================================
+int SRCMultistageConverter::process (const float* const* input, const int numInputFrames,
+                                     float* const* output, const int numOutputFrames,
+                                     const double samplesInPerOutputSample, int& inputFramesUsed) noexcept
+{
+    jassert (hasStagesFor (samplesInPerOutputSample)); // call setResamplingRatio() first
+    inputFramesUsed = 0;
+
+    const auto residualRatio = getResidualRatio (samplesInPerOutputSample);
+
+    if (stages.isEmpty())
+        return processResidual (input, numInputFrames, output, numOutputFrames, residualRatio, inputFramesUsed);
+
+    if (decimating)
+        return processDecimating (input, numInputFrames, output, numOutputFrames, residualRatio, inputFramesUsed);
+
+    return processInterpolating (input, numInputFrames, output, numOutputFrames, residualRatio, inputFramesUsed);
+}
+
+int SRCMultistageConverter::processResidual (const float* const* input, const int numInputFrames,
+                                             float* const* output, const int numOutputFrames,
+                                             const double residualRatio, int& inputFramesUsed) noexcept
+{
+    if (fastInterpolator != nullptr)
+        return fastInterpolator->process (input, numInputFrames, output, numOutputFrames, residualRatio, inputFramesUsed);
+
+    return sincConverter->process (input, numInputFrames, output, numOutputFrames, residualRatio, inputFramesUsed);
+}
+
+int SRCMultistageConverter::processDecimating (const float* const* input, const int numInputFrames,
+                                               float* const* output, const int numOutputFrames,
+                                               const double residualRatio, int& inputFramesUsed) noexcept
+{
+    auto generated = 0;
+
+    for (;;)
+    {
+        if (numPending > 0)
+        {
+            for (auto channel = 0; channel < numChannels; ++channel)
+            {
+                readPointers[channel] = pending.getReadPointer (channel, pendingStart);
+                writePointers[channel] = output[channel] + generated;
+            }
+
+            auto used = 0;
+            generated += processResidual (readPointers, numPending, writePointers, numOutputFrames - generated,
+                                          residualRatio, used);
+            pendingStart += used;
+            numPending -= used;
+
+            // the output is full
+            if (numPending > 0)
+                break;
+        }
+
+        if (generated >= numOutputFrames || inputFramesUsed >= numInputFrames)
+            break;
+
+        const auto numToDo = jmin ((int) chunkSize, numInputFrames - inputFramesUsed);
+
+        for (auto channel = 0; channel < numChannels; ++channel)
+            readPointers[channel] = input[channel] + inputFramesUsed;
+
+        const float* const* source = readPointers;
+        auto numFrames = numToDo;
+
+        for (auto i = 0; i < stages.size(); ++i)
+        {
+            auto& destination = i == stages.size() - 1 ? pending : work[i & 1];
+            numFrames = stages.getUnchecked (i)->decimate (source, numFrames, destination.getArrayOfWritePointers());
+            source = destination.getArrayOfReadPointers();
+        }
+
+        inputFramesUsed += numToDo;
+        setPending (numFrames);
+    }
+
+    return generated;
+}
+
+int SRCMultistageConverter::processInterpolating (const float* const* input, const int numInputFrames,
+                                                  float* const* output, const int numOutputFrames,
+                                                  const double residualRatio, int& inputFramesUsed) noexcept
+{
+    auto generated = 0;
+
+    for (;;)
+    {
+        if (numPending > 0)
+        {
+            const auto numToCopy = jmin (numPending, numOutputFrames - generated);
+
+            for (auto channel = 0; channel < numChannels; ++channel)
+                FloatVectorOperations::copy (output[channel] + generated, pending.getReadPointer (channel, pendingStart), numToCopy);
+
+            generated += numToCopy;
+            pendingStart += numToCopy;
+            numPending -= numToCopy;
+        }
+
+        if (generated >= numOutputFrames || numPending > 0)
+            break;
+
+        for (auto channel = 0; channel < numChannels; ++channel)
+            readPointers[channel] = input[channel] + inputFramesUsed;
+
+        // the remaining converter runs first, at the lowest rate, so the stages end at chunkSize
+        auto used = 0;
+        auto numFrames = processResidual (readPointers, numInputFrames - inputFramesUsed,
+                                          work[0].getArrayOfWritePointers(), chunkSize >> stages.size(),
+                                          residualRatio, used);
+        inputFramesUsed += used;
+
+        if (numFrames == 0)
+        {
+            if (used == 0)
+                break;
+
+            continue;
+        }
+
+        const float* const* source = work[0].getArrayOfReadPointers();
+
+        for (auto i = 0; i < stages.size(); ++i)
+        {
+            auto& destination = i == stages.size() - 1 ? pending : work[(i + 1) & 1];
+            numFrames = stages.getUnchecked (i)->interpolate (source, numFrames, destination.getArrayOfWritePointers());
+            source = destination.getArrayOfReadPointers();
+        }
+
+        setPending (numFrames);
+    }
+
+    return generated;
+}
+
+} // namespace juce
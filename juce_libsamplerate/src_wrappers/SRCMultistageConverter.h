@@ -0,0 +1,156 @@
+/*
+ ==============================================================================
+    Copyright (c) 2019, Tal Aviram
+    All rights reserved.
+
+    This code is released under 2-clause BSD license. Please see the
+    file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#pragma once
+
+namespace juce
+{
+
+//==============================================================================
+/**
+ Converts large ratios in a cascade: half-band stages for the power-of-two part, and a
+ single-stage converter for what is left.
+
+ Downsampling by 2 or more first halves the rate in half-band decimators as many times
+ as fits, and then converts by the remaining ratio (between 1 and 2). Upsampling by 2 or
+ more first converts by the remaining ratio (between 0.5 and 1) and then doubles the
+ rate in half-band interpolators. Every other tap of a half-band filter is zero, and each
+ stage only has to protect the band that survives to the output, so the early stages
+ are short; the expensive converter only ever runs at a ratio below 2. For 192kHz or
+ 384kHz down to 44.1kHz or 48kHz this is several times cheaper than a single stage.
+
+ The remaining ratio is converted by SRCSincConverter with the exact coefficient layout
+ (the same arithmetic as libsamplerate), or by SRCFastInterpolator for SRC_LINEAR and
+ SRC_ZERO_ORDER_HOLD. The half-band filters are Kaiser-windowed and sized from the
+ quality's bandwidth. Unlike a single sinc stage they are causal, so the output is
+ delayed by getLatency(), unless setCompensatesLatency() drops the delay at the start.
+
+ The calling convention is the one of SRCSincConverter.
+
+ @see SRCSincConverter, SRCAudioSource::setUsesMultistage, SRC::resample
+
+ @tags{Audio}
+ */
+class SRCMultistageConverter
+{
+public:
+    typedef libsamplerate::SRC::ResamplerQuality ResamplerQuality;
+
+    //==============================================================================
+    /** Creates a converter, with stages for the given ratio.
+
+     @param quality                      quality / type of the remaining conversion, which
+                                         also sets the bandwidth the half-bands keep
+     @param numChannels                  the number of channels to process
+     @param samplesInPerOutputSample     the ratio to build the stages for
+     */
+    SRCMultistageConverter (ResamplerQuality quality, int numChannels, double samplesInPerOutputSample);
+
+    /** Destructor. */
+    ~SRCMultistageConverter();
+
+    //==============================================================================
+    /** Returns the number of half-band stages used for a ratio. */
+    static int getNumStagesFor (double samplesInPerOutputSample) noexcept;
+
+    /** Changes the ratio immediately. If the new ratio needs a different number of stages,
+        the stages are rebuilt (which allocates) and the history is cleared.
+     */
+    void setResamplingRatio (double samplesInPerOutputSample);
+
+    /** Returns true if a ratio can be converted by the current stages. */
+    bool hasStagesFor (double samplesInPerOutputSample) const noexcept;
+
+    /** Clears the history of every stage. */
+    void reset() noexcept;
+
+    /** Removes the delay of the half-band stages, by dropping their first outputs after
+        each reset(), so the output lines up with the input the way a single stage's does
+        and getLatency() returns 0. Takes effect at the next reset().
+     */
+    void setCompensatesLatency (bool shouldCompensate) noexcept   { compensatesLatency = shouldCompensate; }
+
+    /** Converts a block.
+
+     The remaining ratio ramps as in SRCSincConverter::process(). Output of the half-band
+     stages that the remaining converter couldn't take yet is kept for the next call.
+
+     @param input                    one pointer per channel
+     @param numInputFrames           the number of frames available in input
+     @param output                   one pointer per channel
+     @param numOutputFrames          the space available in output
+     @param samplesInPerOutputSample the ratio to reach at the end of the block
+     @param inputFramesUsed          receives the number of input frames consumed
+     @returns the number of output frames generated
+     */
+    int process (const float* const* input, int numInputFrames,
+                 float* const* output, int numOutputFrames,
+                 double samplesInPerOutputSample, int& inputFramesUsed) noexcept;
+
+    //==============================================================================
+    /** Returns the number of half-band stages. */
+    int getNumStages() const noexcept                       { return stages.size(); }
+
+    /** Returns the delay of the half-band stages, in output samples. The remaining
+        converter, like libsamplerate, holds its output back rather than delaying it.
+     */
+    double getLatency() const noexcept                      { return compensatesLatency ? 0.0 : latency; }
+
+    /** Returns the number of input frames a single output depends on. */
+    int getFilterReach() const noexcept;
+
+    /** Returns the number of bytes this converter uses, not counting shared tables. */
+    size_t getSizeInBytes() const noexcept;
+
+private:
+    //==============================================================================
+    class HalfBandStage;
+
+    enum { chunkSize = 4096, maxNumStages = 5 };
+
+    void createStages (double samplesInPerOutputSample);
+    void setPending (int numFrames) noexcept;
+    double getResidualRatio (double samplesInPerOutputSample) const noexcept;
+    int processResidual (const float* const* input, int numInputFrames,
+                         float* const* output, int numOutputFrames,
+                         double residualRatio, int& inputFramesUsed) noexcept;
+    int processDecimating (const float* const* input, int numInputFrames,
+                           float* const* output, int numOutputFrames,
+                           double residualRatio, int& inputFramesUsed) noexcept;
+    int processInterpolating (const float* const* input, int numInputFrames,
+                              float* const* output, int numOutputFrames,
+                              double residualRatio, int& inputFramesUsed) noexcept;
+
+    //==============================================================================
+    const ResamplerQuality quality;
+    const int numChannels;
+
+    std::unique_ptr<SRCSincConverter> sincConverter;
+    std::unique_ptr<SRCFastInterpolator> fastInterpolator;
+
+    OwnedArray<HalfBandStage> stages;
+    bool decimating = true, compensatesLatency = false;
+    double latency = 0.0;
+
+    // compensating, the delay is padded to whole samples where the stages meet the remaining
+    // converter, and that many are dropped there after a reset
+    int compensationPadding = 0, compensationLength = 0, numToSkip = 0;
+
+    // between the stages: the half-band output waiting for the remaining converter when
+    // decimating, and output that didn't fit in the caller's block when interpolating
+    AudioBuffer<float> work[2], pending;
+    int pendingStart = 0, numPending = 0;
+    HeapBlock<const float*> readPointers;
+    HeapBlock<float*> writePointers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SRCMultistageConverter)
+};
+
+} // namespace juce
@@ -0,0 +1,466 @@
+/*
+ ==============================================================================
+ Copyright (c) 2019, Tal Aviram
+ All rights reserved.
+
+ This code is released under 2-clause BSD license. Please see the
+ file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#include "SRCPlaylistSource.h"
+
+namespace juce
+{
+
+SRCPlaylistSource::SRCPlaylistSource (const ResamplerQuality quality, const int channels,
+                                      TimeSliceThread* const thread, const int readAhead)
+    : numChannels (channels),
+      readAheadThread (thread),
+      readAheadSize (readAhead)
+{
+    jassert (numChannels > 0);
+
+    resamplers_.malloc ((size_t) numChannels);
+    data_.calloc ((size_t) numChannels);
+
+    for (auto channel = 0; channel < numChannels; channel++)
+    {
+        int src_error = 0;
+        resamplers_[channel] = libsamplerate::src_new (quality, 1, &src_error);
+        jassert (resamplers_[channel] != nullptr);
+    }
+}
+
+SRCPlaylistSource::~SRCPlaylistSource()
+{
+    if (readAheadThread != nullptr)
+        readAheadThread->removeTimeSliceClient (this);
+
+    clear();
+
+    for (auto channel = 0; channel < numChannels; channel++)
+        resamplers_[channel] = libsamplerate::src_delete (resamplers_[channel]);
+}
+
+//==============================================================================
+void SRCPlaylistSource::addItem (PositionableAudioSource* const source, const double sourceSampleRate,
+                                 const bool deleteWhenRemoved)
+{
+    jassert (source != nullptr && sourceSampleRate > 0);
+
+    std::unique_ptr<Item> item (new Item());
+    item->source.set (source, deleteWhenRemoved);
+    item->sourceSampleRate = sourceSampleRate;
+    item->reader = source;
+
+    {
+        const ScopedLock sl (lock);
+        items.add (item.release());
+    }
+
+    updatePreparedItems();
+}
+
+void SRCPlaylistSource::clear()
+{
+    const ScopedLock pl (preparationLock);
+    OwnedArray<Item> oldItems;
+
+    {
+        const ScopedLock sl (lock);
+        oldItems.swapWith (items);
+        seekTo (0);
+    }
+
+    for (auto* item : oldItems)
+        if (item->preparedBlockSize > 0)
+            item->reader->releaseResources();
+}
+
+int SRCPlaylistSource::getNumItems() const
+{
+    const ScopedLock sl (lock);
+    return items.size();
+}
+
+int SRCPlaylistSource::getCurrentItemIndex() const
+{
+    const ScopedLock sl (lock);
+    return currentItem;
+}
+
+//==============================================================================
+double SRCPlaylistSource::getRatio (const Item& item) const noexcept
+{
+    // libsamplerate's ratio is output samples per input sample
+    return sampleRate > 0 ? sampleRate / item.sourceSampleRate : 1.0;
+}
+
+int64 SRCPlaylistSource::getLengthAtOutputRate (const Item& item) const
+{
+    return (int64) ((double) item.source->getTotalLength() * getRatio (item));
+}
+
+bool SRCPlaylistSource::shouldBePrepared (const int index) const noexcept
+{
+    // without read-ahead buffers, an item costs little to keep prepared, and there's no
+    // thread to prepare it later
+    return isPrepared && (readAheadThread == nullptr || index == currentItem || index == currentItem + 1);
+}
+
+void SRCPlaylistSource::updatePreparedItems()
+{
+    const ScopedLock pl (preparationLock);
+
+    for (;;)
+    {
+        Item* item = nullptr;
+        auto shouldRelease = false;
+        std::unique_ptr<SRCReadAheadSource> oldBuffer;
+        auto itemBlockSize = 0;
+        int64 startPosition = 0;
+
+        {
+            const ScopedLock sl (lock);
+
+            for (auto index = 0; index < items.size() && item == nullptr; ++index)
+            {
+                auto* candidate = items.getUnchecked (index);
+                const auto wanted = shouldBePrepared (index);
+
+                // an item prepared for another block size is released, then prepared again
+                shouldRelease = candidate->preparedBlockSize > 0 && (! wanted || candidate->preparedBlockSize != blockSize);
+
+                if (shouldRelease || (candidate->preparedBlockSize == 0 && wanted))
+                    item = candidate;
+            }
+
+            if (item == nullptr)
+                return;
+
+            if (shouldRelease)
+            {
+                // getNextAudioBlock() stops reading it here, and it's released below
+                oldBuffer = std::move (item->bufferingSource);
+                item->reader = item->source.get();
+                item->preparedBlockSize = 0;
+            }
+            else
+            {
+                itemBlockSize = blockSize;
+                startPosition = item->startPosition;
+            }
+        }
+
+        if (shouldRelease)
+        {
+            if (oldBuffer != nullptr)
+                oldBuffer->releaseResources();
+            else
+                item->source->releaseResources();
+
+            continue;
+        }
+
+        PositionableAudioSource* reader = item->source.get();
+        std::unique_ptr<SRCReadAheadSource> newBuffer;
+
+        if (readAheadThread != nullptr)
+        {
+            // this may run on the thread that fills the buffer, so the prepare doesn't wait for it
+            newBuffer.reset (new SRCReadAheadSource (item->source.get(), *readAheadThread, false, readAheadSize, numChannels));
+            newBuffer->setPrepareWaitsForBuffer (false);
+            reader = newBuffer.get();
+        }
+
+        reader->setNextReadPosition (startPosition);
+        reader->prepareToPlay (itemBlockSize, item->sourceSampleRate);
+
+        {
+            const ScopedLock sl (lock);
+
+            if (shouldBePrepared (items.indexOf (item)) && blockSize == itemBlockSize)
+            {
+                if (item->startPosition != startPosition)
+                    reader->setNextReadPosition (item->startPosition);
+
+                item->bufferingSource = std::move (newBuffer);
+                item->reader = reader;
+                item->preparedBlockSize = itemBlockSize;
+                continue;
+            }
+        }
+
+        // playback moved on while the item was being prepared
+        reader->releaseResources();
+    }
+}
+
+int SRCPlaylistSource::useTimeSlice()
+{
+    if (preparedItemsChanged.exchange (false))
+    {
+        // another thread preparing items may be waiting to take an item's read-ahead buffer
+        // off this thread, so this one mustn't wait for it, and tries again later instead
+        const ScopedTryLock sl (preparationLock);
+
+        if (sl.isLocked())
+            updatePreparedItems();
+        else
+            preparedItemsChanged = true;
+    }
+
+    return updateIntervalMs;
+}
+
+void SRCPlaylistSource::waitForCurrentItem()
+{
+    // like BufferingAudioSource, playback starts with the first item's buffer filled
+    const auto startTime = Time::getMillisecondCounter();
+
+    for (;;)
+    {
+        {
+            const ScopedLock sl (lock);
+
+            if (! isPositiveAndBelow (currentItem, items.size()))
+                return;
+
+            auto* bufferingSource = items.getUnchecked (currentItem)->bufferingSource.get();
+
+            if (bufferingSource == nullptr || bufferingSource->isReadyToPlay())
+                return;
+        }
+
+        if (Time::getMillisecondCounter() - startTime >= SRCReadAheadSource::getPrepareTimeoutMs())
+            return;
+
+        Thread::sleep (5);
+    }
+}
+
+void SRCPlaylistSource::seekTo (const int64 newPosition)
+{
+    position = newPosition;
+
+    auto remaining = newPosition;
+    auto index = 0;
+
+    for (; index < items.size(); ++index)
+    {
+        const auto length = getLengthAtOutputRate (*items.getUnchecked (index));
+
+        if (remaining < length)
+            break;
+
+        remaining -= length;
+    }
+
+    startItem (index, index < items.size() ? (int64) ((double) remaining / getRatio (*items.getUnchecked (index))) : 0);
+
+    for (auto channel = 0; channel < numChannels; channel++)
+        libsamplerate::src_reset (resamplers_[channel]);
+
+    inputStart = inputAvailable = 0;
+    ratioItem = -1;
+    endOfInputSent = false;
+}
+
+void SRCPlaylistSource::startItem (const int index, const int64 positionInItem)
+{
+    currentItem = index;
+
+    // the item after this one starts reading ahead now, so it's ready when this one ends
+    for (auto i = index; i < jmin (index + 2, items.size()); ++i)
+    {
+        auto& item = *items.getUnchecked (i);
+        item.startPosition = i == index ? positionInItem : 0;
+
+        if (item.preparedBlockSize > 0 && item.reader->getNextReadPosition() != item.startPosition)
+            item.reader->setNextReadPosition (item.startPosition);
+    }
+
+    // the thread prepares the items that are now current or next, and releases the others
+    preparedItemsChanged = true;
+}
+
+bool SRCPlaylistSource::readInput()
+{
+    while (currentItem < items.size())
+    {
+        auto& item = *items.getUnchecked (currentItem);
+
+        // an item that isn't prepared yet is waited for with silence
+        if (item.preparedBlockSize != blockSize)
+            return false;
+
+        if (ratioItem != currentItem)
+        {
+            // an item added after the end was flushed starts a new stream
+            if (endOfInputSent)
+            {
+                for (auto channel = 0; channel < numChannels; channel++)
+                    libsamplerate::src_reset (resamplers_[channel]);
+
+                endOfInputSent = false;
+            }
+
+            // the ratio jumps here instead of ramping across the next block
+            currentRatio = getRatio (item);
+
+            for (auto channel = 0; channel < numChannels; channel++)
+                libsamplerate::src_set_ratio (resamplers_[channel], currentRatio);
+
+            ratioItem = currentItem;
+        }
+
+        const auto remaining = item.reader->getTotalLength() - item.reader->getNextReadPosition();
+
+        if (remaining > 0)
+        {
+            const auto numToRead = (int) jmin ((int64) inputBuffer.getNumSamples(), remaining);
+            AudioSourceChannelInfo readInfo (&inputBuffer, 0, numToRead);
+            item.reader->getNextAudioBlock (readInfo);
+
+            inputStart = 0;
+            inputAvailable = numToRead;
+            return true;
+        }
+
+        startItem (currentItem + 1, 0);
+    }
+
+    return false;
+}
+
+//==============================================================================
+void SRCPlaylistSource::prepareToPlay (const int samplesPerBlockExpected, const double newSampleRate)
+{
+    {
+        const ScopedLock sl (lock);
+
+        sampleRate = newSampleRate;
+        blockSize = samplesPerBlockExpected;
+
+        inputBuffer.setSize (numChannels, blockSize);
+        discardBuffer.calloc ((size_t) blockSize);
+
+        isPrepared = true;
+        seekTo (position);
+    }
+
+    updatePreparedItems();
+
+    if (readAheadThread != nullptr)
+    {
+        readAheadThread->addTimeSliceClient (this);
+        waitForCurrentItem();
+    }
+}
+
+void SRCPlaylistSource::releaseResources()
+{
+    if (readAheadThread != nullptr)
+        readAheadThread->removeTimeSliceClient (this);
+
+    {
+        const ScopedLock sl (lock);
+
+        inputBuffer.setSize (numChannels, 0);
+        discardBuffer.free();
+        isPrepared = false;
+    }
+
+    updatePreparedItems();
+}
+
+void SRCPlaylistSource::getNextAudioBlock (const AudioSourceChannelInfo& info)
+{
+    const ScopedLock sl (lock);
+
+    const auto channelsToProcess = jmin (numChannels, info.buffer->getNumChannels());
+    auto samplesGenerated = 0;
+
+    while (isPrepared && samplesGenerated < info.numSamples)
+    {
+        const auto endOfInput = inputAvailable == 0 && ! readInput();
+
+        // the current item is still being prepared, so the rest of the block is left silent
+        if (endOfInput && currentItem < items.size())
+            break;
+
+        // channels the output has no room for still have to be run, to stay in sync
+        auto numOutputFrames = info.numSamples - samplesGenerated;
+
+        if (channelsToProcess < numChannels)
+            numOutputFrames = jmin (numOutputFrames, blockSize);
+
+        for (auto channel = 0; channel < numChannels; ++channel)
+        {
+            auto& data = data_[channel];
+            data.data_in = inputBuffer.getReadPointer (channel, inputStart);
+            data.input_frames = inputAvailable;
+            data.data_out = channel < channelsToProcess ? info.buffer->getWritePointer (channel, info.startSample + samplesGenerated)
+                                                        : discardBuffer.get();
+            data.output_frames = numOutputFrames;
+            data.src_ratio = currentRatio;
+            data.end_of_input = endOfInput ? 1 : 0;
+
+            const auto src_result = libsamplerate::src_process (resamplers_[channel], &data);
+            jassert (src_result == 0);
+            ignoreUnused (src_result);
+            // this should be the same for all resamplers
+            jassert (data.output_frames_gen == data_[0].output_frames_gen);
+        }
+
+        inputStart += (int) data_[0].input_frames_used;
+        inputAvailable -= (int) data_[0].input_frames_used;
+        samplesGenerated += (int) data_[0].output_frames_gen;
+
+        if (endOfInput)
+        {
+            endOfInputSent = true;
+
+            if (data_[0].output_frames_gen == 0)
+                break;
+        }
+    }
+
+    for (auto channel = info.buffer->getNumChannels(); --channel >= 0;)
+    {
+        const auto numValid = channel < channelsToProcess ? samplesGenerated : 0;
+
+        if (numValid < info.numSamples)
+            info.buffer->clear (channel, info.startSample + numValid, info.numSamples - numValid);
+    }
+
+    position += info.numSamples;
+}
+
+//==============================================================================
+void SRCPlaylistSource::setNextReadPosition (const int64 newPosition)
+{
+    const ScopedLock sl (lock);
+    seekTo (newPosition);
+}
+
+int64 SRCPlaylistSource::getNextReadPosition() const
+{
+    const ScopedLock sl (lock);
+    return position;
+}
+
+int64 SRCPlaylistSource::getTotalLength() const
+{
+    const ScopedLock sl (lock);
+
+    int64 length = 0;
+
+    for (auto* item : items)
+        length += getLengthAtOutputRate (*item);
+
+    return length;
+}
+
+} // namespace juce
@@ -0,0 +1,151 @@
+/*
+ ==============================================================================
+    Copyright (c) 2019, Tal Aviram
+    All rights reserved.
+
+    This code is released under 2-clause BSD license. Please see the
+    file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#pragma once
+
+namespace juce
+{
+
+//==============================================================================
+/**
+ A PositionableAudioSource that plays a list of sources back to back, each corrected
+ from its own sample-rate to the output sample-rate.
+
+ All the items are fed through one set of libsamplerate converters as a single
+ continuous stream: when an item runs out, the same converter call carries on with
+ the first samples of the next item at that item's ratio. So there is no gap, no
+ converter warm-up and no second chain running at the boundaries. As the converter's
+ filter spans the boundary, the last few output samples of an item are computed at
+ the next item's ratio.
+
+ If a TimeSliceThread is given, the current item and the next one are read through
+ their own SRCReadAheadSource, so the next item's read-ahead buffer is already full by
+ the time the current one ends. The items further on hold no buffer and aren't prepared:
+ as playback moves on, that thread prepares the new next item and releases the one that
+ finished. Without a thread, the items are read directly, and are all prepared when
+ they are added (or in prepareToPlay()).
+
+ Items are expected not to loop.
+
+ @see SRCAudioSource, SRCAudioTransportSource
+
+ @tags{Audio}
+ */
+class SRCPlaylistSource  : public PositionableAudioSource,
+                           private TimeSliceClient
+{
+public:
+    typedef libsamplerate::SRC::ResamplerQuality ResamplerQuality;
+
+    //==============================================================================
+    /** Creates an empty playlist.
+
+     @param quality          quality / type of sample rate conversion of libsamplerate
+     @param numChannels      the number of channels to play
+     @param readAheadThread  if not nullptr, the thread that items read ahead on. It
+                             must not be deleted while this object uses it.
+     @param readAheadSize    the size of each item's read-ahead buffer, in samples
+     */
+    SRCPlaylistSource (ResamplerQuality quality = ResamplerQuality::SRC_SINC_MEDIUM_QUALITY,
+                       int numChannels = 2,
+                       TimeSliceThread* readAheadThread = nullptr,
+                       int readAheadSize = 32768);
+
+    /** Destructor. */
+    ~SRCPlaylistSource() override;
+
+    //==============================================================================
+    /** Adds a source to the end of the playlist.
+
+     If the playlist has been prepared and the source is one that should be, it is
+     prepared on the calling thread, after it is added and without holding up playback.
+
+     @param source               the source to add
+     @param sourceSampleRate     the sample-rate of the source
+     @param deleteWhenRemoved    if true, the source is deleted when it is removed from
+                                 the playlist
+     */
+    void addItem (PositionableAudioSource* source, double sourceSampleRate, bool deleteWhenRemoved);
+
+    /** Removes every item. */
+    void clear();
+
+    /** Returns the number of items in the playlist. */
+    int getNumItems() const;
+
+    /** Returns the index of the item being fed to the converters, which is the one
+        being heard, give or take the converter's latency. */
+    int getCurrentItemIndex() const;
+
+    //==============================================================================
+    void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock (const AudioSourceChannelInfo&) override;
+
+    void setNextReadPosition (int64 newPosition) override;
+    int64 getNextReadPosition() const override;
+    int64 getTotalLength() const override;
+    bool isLooping() const override                         { return false; }
+
+private:
+    //==============================================================================
+    struct Item
+    {
+        OptionalScopedPointer<PositionableAudioSource> source;
+        std::unique_ptr<SRCReadAheadSource> bufferingSource; // only while the item is current or next
+        PositionableAudioSource* reader = nullptr;
+        double sourceSampleRate = 0;
+        int64 startPosition = 0;    // where the reader starts, kept for when it's prepared later
+        int preparedBlockSize = 0;  // 0 until the reader is prepared; getNextAudioBlock() skips it until then
+    };
+
+    int useTimeSlice() override;
+    void updatePreparedItems();
+    bool shouldBePrepared (int index) const noexcept;
+    void waitForCurrentItem();
+    void seekTo (int64 newPosition);
+    void startItem (int index, int64 positionInItem);
+    bool readInput();
+    double getRatio (const Item&) const noexcept;
+    int64 getLengthAtOutputRate (const Item&) const;
+
+    //==============================================================================
+    const int numChannels;
+    TimeSliceThread* const readAheadThread;
+    const int readAheadSize;
+
+    OwnedArray<Item> items;
+    CriticalSection lock;
+
+    // held while items are prepared or released, outside lock, so the audio thread
+    // isn't held up. Items are only deleted while it's held.
+    CriticalSection preparationLock;
+    std::atomic<bool> preparedItemsChanged { false };
+
+    HeapBlock<libsamplerate::SRC_STATE*> resamplers_;
+    HeapBlock<libsamplerate::SRC_DATA> data_;
+    AudioBuffer<float> inputBuffer;
+    HeapBlock<float> discardBuffer;
+    int inputStart = 0, inputAvailable = 0;
+
+    int currentItem = 0, ratioItem = -1;
+    double currentRatio = 1.0;
+    bool endOfInputSent = false;
+    int64 position = 0;
+    double sampleRate = 0;
+    int blockSize = 0;
+    bool isPrepared = false;
+
+    enum { updateIntervalMs = 10 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SRCPlaylistSource)
+};
+
+} // namespace juce
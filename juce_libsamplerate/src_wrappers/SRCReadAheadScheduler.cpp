@@ -0,0 +1,223 @@
+/*
+ ==============================================================================
+ Copyright (c) 2019, Tal Aviram
+ All rights reserved.
+
+ This code is released under 2-clause BSD license. Please see the
+ file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#include "SRCReadAheadScheduler.h"
+
+namespace juce
+{
+
+//==============================================================================
+class SRCReadAheadScheduler::Worker  : public Thread
+{
+public:
+    Worker (SRCReadAheadScheduler& s, const String& name)
+        : Thread (name),
+          scheduler (s)
+    {
+        startThread();
+    }
+
+    ~Worker() override
+    {
+        signalThreadShouldExit();
+        wake();
+        stopThread (4000);
+    }
+
+    void wake()
+    {
+        workEvent.signal();
+    }
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            batch.clearQuick();
+            const auto waitMs = scheduler.claimBatch (batch);
+
+            if (batch.isEmpty())
+            {
+                workEvent.wait (waitMs);
+                continue;
+            }
+
+            for (auto* source : batch)
+                source->readAhead();
+
+            scheduler.finishBatch (batch);
+        }
+    }
+
+private:
+    SRCReadAheadScheduler& scheduler;
+    Array<SRCReadAheadSource*> batch;
+    WaitableEvent workEvent;
+
+    JUCE_DECLARE_NON_COPYABLE (Worker)
+};
+
+//==============================================================================
+SRCReadAheadScheduler::SRCReadAheadScheduler (const int numThreads, const String& threadName)
+{
+    jassert (numThreads > 0);
+
+    for (auto i = 0; i < numThreads; ++i)
+        workers.add (new Worker (*this, threadName + " " + String (i + 1)));
+}
+
+SRCReadAheadScheduler::~SRCReadAheadScheduler()
+{
+    // every buffer must be released before the scheduler it's read by is deleted
+    jassert (entries.isEmpty());
+
+    workers.clear();
+}
+
+int SRCReadAheadScheduler::getNumSources() const
+{
+    const ScopedLock sl (lock);
+    return entries.size();
+}
+
+//==============================================================================
+void SRCReadAheadScheduler::addSource (SRCReadAheadSource& source)
+{
+    Entry entry;
+    entry.source = &source;
+    entry.group = source.readGroup;
+
+    {
+        const ScopedLock sl (lock);
+        entries.add (entry);
+    }
+
+    wake();
+}
+
+void SRCReadAheadScheduler::removeSource (SRCReadAheadSource& source)
+{
+    for (;;)
+    {
+        {
+            const ScopedLock sl (lock);
+            auto isBeingRead = false;
+
+            for (auto i = entries.size(); --i >= 0;)
+            {
+                if (entries.getReference (i).source != &source)
+                    continue;
+
+                isBeingRead = entries.getReference (i).isBeingRead;
+
+                if (! isBeingRead)
+                    entries.remove (i);
+
+                break;
+            }
+
+            if (! isBeingRead)
+                return;
+        }
+
+        // a thread is reading for it, which never takes long
+        readFinishedEvent.wait (10);
+    }
+}
+
+void SRCReadAheadScheduler::wake()
+{
+    // several buffers may need reading at once, so every idle worker has a look; the ones
+    // that find nothing left to claim go back to waiting
+    for (auto* worker : workers)
+        worker->wake();
+}
+
+int SRCReadAheadScheduler::claimBatch (Array<SRCReadAheadSource*>& batch)
+{
+    const auto now = Time::getMillisecondCounter();
+    const ScopedLock sl (lock);
+
+    auto mostUrgent = -1;
+    auto leastTimeLeft = 0.0, leastTimeLeftOfAll = (double) maxWaitMs;
+
+    for (auto i = 0; i < entries.size(); ++i)
+    {
+        const auto& entry = entries.getReference (i);
+
+        if (entry.isBeingRead)
+            continue;
+
+        const auto timeLeft = entry.source->getSecondsUntilUnderrun();
+        leastTimeLeftOfAll = jmin (leastTimeLeftOfAll, timeLeft * 1000.0);
+
+        if (! entry.source->needsReading() && now - entry.lastReadTime < (uint32) idleIntervalMs)
+            continue;
+
+        if (mostUrgent < 0 || timeLeft < leastTimeLeft)
+        {
+            mostUrgent = i;
+            leastTimeLeft = timeLeft;
+        }
+    }
+
+    // with nothing to read, look again well before the emptiest buffer could run out
+    if (mostUrgent < 0)
+        return jlimit (1, (int) maxWaitMs, roundToInt (leastTimeLeftOfAll / 8.0));
+
+    auto& claimed = entries.getReference (mostUrgent);
+    claimed.isBeingRead = true;
+    batch.add (claimed.source);
+
+    if (claimed.group.isEmpty())
+        return 0;
+
+    // the rest of the group comes along as long as that doesn't hold up a buffer outside it
+    // that's closer to running out
+    auto leastTimeLeftOutside = std::numeric_limits<double>::max();
+
+    for (auto& entry : entries)
+        if (! entry.isBeingRead && entry.group != claimed.group && entry.source->needsReading())
+            leastTimeLeftOutside = jmin (leastTimeLeftOutside, entry.source->getSecondsUntilUnderrun());
+
+    for (auto& entry : entries)
+    {
+        if (! entry.isBeingRead && entry.group == claimed.group && entry.source->needsReading()
+             && entry.source->getSecondsUntilUnderrun() <= leastTimeLeftOutside)
+        {
+            entry.isBeingRead = true;
+            batch.add (entry.source);
+        }
+    }
+
+    return 0;
+}
+
+void SRCReadAheadScheduler::finishBatch (const Array<SRCReadAheadSource*>& batch)
+{
+    const auto now = Time::getMillisecondCounter();
+
+    {
+        const ScopedLock sl (lock);
+
+        for (auto& entry : entries)
+        {
+            if (batch.contains (entry.source))
+            {
+                entry.isBeingRead = false;
+                entry.lastReadTime = now;
+            }
+        }
+    }
+
+    readFinishedEvent.signal();
+}
+
+} // namespace juce
@@ -0,0 +1,92 @@
+/*
+ ==============================================================================
+    Copyright (c) 2019, Tal Aviram
+    All rights reserved.
+
+    This code is released under 2-clause BSD license. Please see the
+    file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#pragma once
+
+namespace juce
+{
+
+//==============================================================================
+/**
+ Reads ahead for many SRCReadAheadSources, refilling whichever is closest to running out
+ first.
+
+ A TimeSliceThread gives each of its clients a turn in order, however full their
+ buffers are, so with many streams a nearly empty one can wait behind full ones. This
+ instead works out each buffer's time until an underrun, from its fill level and the
+ rate it's played at (see SRCReadAheadSource::setPlaybackRate), and always reads for
+ the one with the least time left.
+
+ The reads can be spread over several threads. Buffers that share a read group, e.g.
+ because they read the same file, are read together: when one of them is the most
+ urgent, the others that need reading are read straight after it, on the same thread.
+
+ A buffer that's created with a scheduler registers itself when it's prepared and
+ leaves when it's released. The scheduler must outlive the buffers that use it.
+
+ @see SRCReadAheadSource, SRCAudioTransportSource::setReadAheadScheduler
+
+ @tags{Audio}
+ */
+class SRCReadAheadScheduler
+{
+public:
+    //==============================================================================
+    /** Starts the reading threads.
+
+     @param numThreads       the number of threads reading at once
+     @param threadName       the name of the threads, numbered from 1
+     */
+    explicit SRCReadAheadScheduler (int numThreads = 1, const String& threadName = "SRC read-ahead");
+
+    /** Destructor. Stops the reading threads. */
+    ~SRCReadAheadScheduler();
+
+    /** Returns the number of reading threads. */
+    int getNumThreads() const noexcept                      { return workers.size(); }
+
+    /** Returns the number of buffers being read for. */
+    int getNumSources() const;
+
+private:
+    //==============================================================================
+    friend class SRCReadAheadSource;
+    class Worker;
+
+    enum
+    {
+        idleIntervalMs = 100,   // how often a buffer that needs nothing is looked at, as a TimeSliceThread does
+        maxWaitMs = 100
+    };
+
+    struct Entry
+    {
+        SRCReadAheadSource* source = nullptr;
+        String group;
+        uint32 lastReadTime = 0;
+        bool isBeingRead = false;
+    };
+
+    void addSource (SRCReadAheadSource&);
+    void removeSource (SRCReadAheadSource&);
+    void wake();
+    int claimBatch (Array<SRCReadAheadSource*>& batch);
+    void finishBatch (const Array<SRCReadAheadSource*>& batch);
+
+    //==============================================================================
+    CriticalSection lock;
+    Array<Entry> entries;
+    WaitableEvent readFinishedEvent;
+    OwnedArray<Worker> workers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SRCReadAheadScheduler)
+};
+
+} // namespace juce
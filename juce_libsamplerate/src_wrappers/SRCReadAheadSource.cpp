@@ -0,0 +1,607 @@
+/*
+ ==============================================================================
+ Copyright (c) 2019, Tal Aviram
+ All rights reserved.
+
+ This code is released under 2-clause BSD license. Please see the
+ file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#include "SRCReadAheadSource.h"
+
+namespace juce
+{
+
+namespace SRCReadAheadHelpers
+{
+    // copies the positions [start, end) between two circular buffers of different sizes
+    static void copyRange (const AudioBuffer<float>& from, AudioBuffer<float>& to, const int64 start, const int64 end)
+    {
+        const auto fromSize = from.getNumSamples();
+        const auto toSize = to.getNumSamples();
+        const auto numChannels = jmin (from.getNumChannels(), to.getNumChannels());
+
+        for (auto position = start; position < end;)
+        {
+            const auto fromIndex = (int) (position % fromSize);
+            const auto toIndex = (int) (position % toSize);
+            const auto numToCopy = (int) jmin (end - position, (int64) (fromSize - fromIndex), (int64) (toSize - toIndex));
+
+            for (auto channel = 0; channel < numChannels; ++channel)
+                to.copyFrom (channel, toIndex, from, channel, fromIndex, numToCopy);
+
+            position += numToCopy;
+        }
+    }
+}
+
+//==============================================================================
+SRCReadAheadSource::Budget::Budget (const size_t maxBytesToUse)
+    : maxBytes (maxBytesToUse)
+{
+}
+
+void SRCReadAheadSource::Budget::setMaxBytes (const size_t newMaxBytes)
+{
+    const SpinLock::ScopedLockType sl (lock);
+    maxBytes = newMaxBytes;
+}
+
+size_t SRCReadAheadSource::Budget::getMaxBytes() const noexcept
+{
+    const SpinLock::ScopedLockType sl (lock);
+    return maxBytes;
+}
+
+size_t SRCReadAheadSource::Budget::getBytesInUse() const noexcept
+{
+    const SpinLock::ScopedLockType sl (lock);
+    return bytesInUse;
+}
+
+size_t SRCReadAheadSource::Budget::reserve (const size_t currentBytes, const size_t wantedBytes, const size_t minimumBytes)
+{
+    const SpinLock::ScopedLockType sl (lock);
+    jassert (bytesInUse >= currentBytes);
+
+    const auto usedByOthers = bytesInUse - currentBytes;
+    const auto available = maxBytes > usedByOthers ? maxBytes - usedByOthers : 0;
+    const auto granted = jmin (wantedBytes, jmax (minimumBytes, available));
+
+    bytesInUse = usedByOthers + granted;
+    return granted;
+}
+
+//==============================================================================
+SRCReadAheadSource::SRCReadAheadSource (PositionableAudioSource* const s,
+                                        TimeSliceThread& thread,
+                                        const bool deleteSourceWhenDeleted,
+                                        const int bufferSizeSamples,
+                                        const int numberOfChannels,
+                                        Budget* const budgetToUse)
+    : SRCReadAheadSource (s, &thread, nullptr, deleteSourceWhenDeleted, bufferSizeSamples, numberOfChannels, budgetToUse)
+{
+}
+
+SRCReadAheadSource::SRCReadAheadSource (PositionableAudioSource* const s,
+                                        SRCReadAheadScheduler& schedulerToUse,
+                                        const bool deleteSourceWhenDeleted,
+                                        const int bufferSizeSamples,
+                                        const int numberOfChannels,
+                                        Budget* const budgetToUse)
+    : SRCReadAheadSource (s, nullptr, &schedulerToUse, deleteSourceWhenDeleted, bufferSizeSamples, numberOfChannels, budgetToUse)
+{
+}
+
+SRCReadAheadSource::SRCReadAheadSource (PositionableAudioSource* const s,
+                                        TimeSliceThread* const thread,
+                                        SRCReadAheadScheduler* const schedulerToUse,
+                                        const bool deleteSourceWhenDeleted,
+                                        const int bufferSizeSamples,
+                                        const int numberOfChannels,
+                                        Budget* const budgetToUse)
+    : source (s, deleteSourceWhenDeleted),
+      backgroundThread (thread),
+      scheduler (schedulerToUse),
+      numChannels (numberOfChannels),
+      budget (budgetToUse),
+      targetSize (bufferSizeSamples)
+{
+    jassert (source != nullptr);
+
+    // not much point using this class if you're not using a larger buffer..
+    jassert (bufferSizeSamples > 1024);
+    jassert (numChannels > 0);
+}
+
+SRCReadAheadSource::~SRCReadAheadSource()
+{
+    releaseResources();
+}
+
+//==============================================================================
+void SRCReadAheadSource::setBufferSize (const int numSamples)
+{
+    jassert (numSamples > 0);
+    targetSize = numSamples;
+    resizePending = true;
+    wakeReader();
+}
+
+void SRCReadAheadSource::setAdaptive (const bool shouldAdapt, const int minimumSize, const int maximumSize)
+{
+    jassert (! shouldAdapt || (minimumSize > 0 && maximumSize >= minimumSize));
+
+    {
+        const ScopedLock sl (bufferStartPosLock);
+        minimumAdaptiveSize = minimumSize;
+        maximumAdaptiveSize = maximumSize;
+    }
+
+    adaptive = shouldAdapt;
+}
+
+SRCReadAheadSource::Statistics SRCReadAheadSource::getStatistics() const
+{
+    Statistics statistics;
+    statistics.bufferSize = currentSize;
+    statistics.targetSize = targetSize;
+    statistics.minimumFillLevel = minimumFillLevel;
+    statistics.numUnderruns = numUnderruns;
+    return statistics;
+}
+
+void SRCReadAheadSource::setPlaybackRate (const double outputSampleRate, const double samplesInPerOutputSample)
+{
+    jassert (outputSampleRate > 0 && samplesInPerOutputSample > 0);
+    playbackRate = outputSampleRate * samplesInPerOutputSample;
+}
+
+void SRCReadAheadSource::setReadGroup (const String& groupName)
+{
+    // the scheduler takes the group when the buffer is prepared
+    jassert (! isPrepared);
+    readGroup = groupName;
+}
+
+double SRCReadAheadSource::getSecondsUntilUnderrun() const noexcept
+{
+    const auto pos = nextPlayPos.load();
+    const auto start = bufferValidStart.load();
+    const auto end = bufferValidEnd.load();
+    const auto rate = playbackRate > 0.0 ? playbackRate.load() : sampleRate;
+
+    if (pos < start || pos >= end || rate <= 0.0)
+        return 0.0;
+
+    return (double) (end - pos) / rate;
+}
+
+//==============================================================================
+void SRCReadAheadSource::startReading()
+{
+    if (scheduler != nullptr)
+        scheduler->addSource (*this);
+    else
+        backgroundThread->addTimeSliceClient (this);
+}
+
+void SRCReadAheadSource::stopReading()
+{
+    if (scheduler != nullptr)
+        scheduler->removeSource (*this);
+    else
+        backgroundThread->removeTimeSliceClient (this);
+}
+
+void SRCReadAheadSource::wakeReader()
+{
+    if (scheduler != nullptr)
+        scheduler->wake();
+    else
+        backgroundThread->moveToFrontOfQueue (this);
+}
+
+//==============================================================================
+void SRCReadAheadSource::prepareToPlay (const int samplesPerBlockExpected, const double newSampleRate)
+{
+    stopReading();
+
+    blockSize = samplesPerBlockExpected;
+    sampleRate = newSampleRate;
+    source->prepareToPlay (samplesPerBlockExpected, newSampleRate);
+
+    {
+        const ScopedLock sl (bufferStartPosLock);
+        bufferValidStart = 0;
+        bufferValidEnd = 0;
+    }
+
+    isPrepared = true;
+    sourceLength = source->getTotalLength();
+    applyBufferSize();
+    buffer.clear();
+    seekPending = true;
+
+    startReading();
+
+    if (! prepareWaitsForBuffer)
+    {
+        wakeReader();
+        return;
+    }
+
+    // a source that can't be read in time is left to fill the buffer in the background,
+    // like BufferingAudioSource does
+    const auto startTime = Time::getMillisecondCounter();
+
+    do
+    {
+        wakeReader();
+        Thread::sleep (5);
+    }
+    while (! isReadyToPlay() && Time::getMillisecondCounter() - startTime < prepareTimeoutMs);
+}
+
+bool SRCReadAheadSource::isReadyToPlay() const noexcept
+{
+    return isPrepared && bufferValidEnd - bufferValidStart >= jmin (((int) sampleRate) / 4, buffer.getNumSamples() / 2);
+}
+
+void SRCReadAheadSource::releaseResources()
+{
+    stopReading();
+
+    if (! isPrepared)
+        return;
+
+    isPrepared = false;
+
+    {
+        const ScopedLock sl (bufferStartPosLock);
+        buffer.setSize (numChannels, 0);
+        bufferValidStart = 0;
+        bufferValidEnd = 0;
+    }
+
+    currentSize = 0;
+
+    if (budget != nullptr)
+        reservedBytes = budget->reserve (reservedBytes, 0, 0);
+
+    source->releaseResources();
+}
+
+void SRCReadAheadSource::getNextAudioBlock (const AudioSourceChannelInfo& info)
+{
+    const ScopedLock sl (bufferStartPosLock);
+
+    const auto start = bufferValidStart.load();
+    const auto end = bufferValidEnd.load();
+    const auto pos = nextPlayPos.load();
+
+    const auto validStart = (int) (jlimit (start, end, pos) - pos);
+    const auto validEnd = (int) (jlimit (start, end, pos + info.numSamples) - pos);
+
+    if (validStart == validEnd)
+    {
+        // total cache miss
+        info.clearActiveBufferRegion();
+    }
+    else
+    {
+        if (validStart > 0)
+            info.buffer->clear (info.startSample, validStart);  // partial cache miss at start
+
+        if (validEnd < info.numSamples)
+            info.buffer->clear (info.startSample + validEnd,
+                                info.numSamples - validEnd);    // partial cache miss at end
+
+        if (validStart < validEnd)
+        {
+            for (auto chan = jmin (numChannels, info.buffer->getNumChannels()); --chan >= 0;)
+            {
+                jassert (buffer.getNumSamples() > 0);
+                const auto startBufferIndex = (int) ((validStart + pos) % buffer.getNumSamples());
+                const auto endBufferIndex = (int) ((validEnd + pos) % buffer.getNumSamples());
+
+                if (startBufferIndex < endBufferIndex)
+                {
+                    info.buffer->copyFrom (chan, info.startSample + validStart,
+                                           buffer, chan, startBufferIndex,
+                                           validEnd - validStart);
+                }
+                else
+                {
+                    const auto initialSize = buffer.getNumSamples() - startBufferIndex;
+
+                    info.buffer->copyFrom (chan, info.startSample + validStart,
+                                           buffer, chan, startBufferIndex,
+                                           initialSize);
+
+                    info.buffer->copyFrom (chan, info.startSample + validStart + initialSize,
+                                           buffer, chan, 0,
+                                           (validEnd - validStart) - initialSize);
+                }
+            }
+        }
+    }
+
+    // a block that was short while the source still had audio is an underrun, unless
+    // the reader is still catching up with a seek
+    const auto isComplete = validStart == 0 && validEnd == info.numSamples;
+    const auto sourceHadMore = isLooping() || pos + info.numSamples <= sourceLength;
+
+    if (isComplete)
+        seekPending = false;
+    else if (sourceHadMore && ! seekPending)
+        ++numUnderruns;
+
+    const auto fillLevel = (int) jmax ((int64) 0, end - (pos + info.numSamples));
+    auto lowest = minimumFillLevel.load();
+
+    while ((lowest < 0 || fillLevel < lowest) && ! minimumFillLevel.compare_exchange_weak (lowest, fillLevel))
+    {
+    }
+
+    nextPlayPos += info.numSamples;
+}
+
+bool SRCReadAheadSource::waitForNextAudioBlockReady (const AudioSourceChannelInfo& info, const uint32 timeout)
+{
+    if (source == nullptr || source->getTotalLength() <= 0)
+        return false;
+
+    if (nextPlayPos + info.numSamples < 0)
+        return true;
+
+    if (! isLooping() && nextPlayPos > getTotalLength())
+        return true;
+
+    const auto startTime = Time::getMillisecondCounter();
+    auto elapsed = (uint32) 0;
+
+    while (elapsed <= timeout)
+    {
+        {
+            const ScopedLock sl (bufferStartPosLock);
+
+            const auto start = bufferValidStart.load();
+            const auto end = bufferValidEnd.load();
+            const auto pos = nextPlayPos.load();
+
+            const auto validStart = (int) (jlimit (start, end, pos) - pos);
+            const auto validEnd = (int) (jlimit (start, end, pos + info.numSamples) - pos);
+
+            if (validStart <= 0 && validStart < validEnd && validEnd >= info.numSamples)
+                return true;
+        }
+
+        if (elapsed < timeout && ! bufferReadyEvent.wait ((int) (timeout - elapsed)))
+            return false;
+
+        elapsed = Time::getMillisecondCounter() - startTime;
+    }
+
+    return false;
+}
+
+int64 SRCReadAheadSource::getNextReadPosition() const
+{
+    jassert (source->getTotalLength() > 0);
+    const auto pos = nextPlayPos.load();
+
+    return (source->isLooping() && pos > 0)
+                ? pos % source->getTotalLength()
+                : pos;
+}
+
+void SRCReadAheadSource::setNextReadPosition (const int64 newPosition)
+{
+    const ScopedLock sl (bufferStartPosLock);
+
+    nextPlayPos = newPosition;
+    seekPending = true;
+    wakeReader();
+}
+
+//==============================================================================
+void SRCReadAheadSource::adaptBufferSize()
+{
+    const auto now = Time::getMillisecondCounter();
+
+    if (! adaptive || now - lastAdaptTime < adaptIntervalMs)
+        return;
+
+    lastAdaptTime = now;
+
+    const auto underruns = numUnderruns.load();
+    const auto lowestFill = minimumFillLevel.exchange (-1);
+    auto size = targetSize.load();
+
+    // grow while the source can't keep up, shrink while half the buffer is never used
+    if (underruns != underrunsAtLastAdapt)
+        size += size / 2;
+    else if (lowestFill > currentSize / 2)
+        size -= size / 4;
+
+    underrunsAtLastAdapt = underruns;
+
+    int minimumSize, maximumSize;
+
+    {
+        const ScopedLock sl (bufferStartPosLock);
+        minimumSize = minimumAdaptiveSize;
+        maximumSize = maximumAdaptiveSize;
+    }
+
+    targetSize = jlimit (minimumSize, maximumSize, size);
+}
+
+void SRCReadAheadSource::applyBufferSize()
+{
+    resizePending = false;
+
+    const auto minimumSize = getMinimumBufferSize();
+    auto newSize = jmax (minimumSize, targetSize.load());
+
+    if (budget != nullptr)
+    {
+        reservedBytes = budget->reserve (reservedBytes, getBytesFor (newSize), getBytesFor (minimumSize));
+        newSize = (int) (reservedBytes / getBytesFor (1));
+    }
+
+    if (newSize == buffer.getNumSamples())
+        return;
+
+    int64 start, end;
+
+    {
+        const ScopedLock sl (bufferStartPosLock);
+        start = bufferValidStart;
+        end = bufferValidEnd;
+    }
+
+    // Only this thread writes to the buffer or moves its valid range, so what's
+    // already been read can be carried over before the lock is taken again.
+    end = jmin (end, start + newSize - 4);
+
+    AudioBuffer<float> newBuffer (numChannels, newSize);
+
+    if (end > start && buffer.getNumSamples() > 0)
+        SRCReadAheadHelpers::copyRange (buffer, newBuffer, start, end);
+
+    {
+        const ScopedLock sl (bufferStartPosLock);
+        std::swap (buffer, newBuffer);
+        bufferValidStart = start;
+        bufferValidEnd = jmax (start, end);
+    }
+
+    currentSize = newSize;
+}
+
+//==============================================================================
+int SRCReadAheadSource::useTimeSlice()
+{
+    return readAhead() ? 1 : 100;
+}
+
+bool SRCReadAheadSource::readAhead()
+{
+    sourceLength = source->getTotalLength();
+
+    adaptBufferSize();
+    applyBufferSize();
+
+    return readNextBufferChunk();
+}
+
+bool SRCReadAheadSource::needsReading() const noexcept
+{
+    if (resizePending)
+        return true;
+
+    // the same test readNextBufferChunk() makes, on the atomics instead of under the lock
+    const auto newBVS = jmax ((int64) 0, nextPlayPos.load());
+    const auto newBVE = newBVS + currentSize.load() - 4;
+    const auto start = bufferValidStart.load();
+    const auto end = bufferValidEnd.load();
+
+    return newBVS < start || newBVS >= end
+            || std::abs (newBVS - start) > 512
+            || std::abs (newBVE - end) > 512;
+}
+
+bool SRCReadAheadSource::readNextBufferChunk()
+{
+    int64 newBVS, newBVE, sectionToReadStart, sectionToReadEnd;
+
+    {
+        const ScopedLock sl (bufferStartPosLock);
+
+        if (wasSourceLooping != isLooping())
+        {
+            wasSourceLooping = isLooping();
+            bufferValidStart = 0;
+            bufferValidEnd = 0;
+        }
+
+        newBVS = jmax ((int64) 0, nextPlayPos.load());
+        newBVE = newBVS + buffer.getNumSamples() - 4;
+        sectionToReadStart = 0;
+        sectionToReadEnd = 0;
+
+        const int maxChunkSize = 2048;
+
+        if (newBVS < bufferValidStart || newBVS >= bufferValidEnd)
+        {
+            newBVE = jmin (newBVE, newBVS + maxChunkSize);
+
+            sectionToReadStart = newBVS;
+            sectionToReadEnd = newBVE;
+
+            bufferValidStart = 0;
+            bufferValidEnd = 0;
+        }
+        else if (std::abs ((int) (newBVS - bufferValidStart)) > 512
+                  || std::abs ((int) (newBVE - bufferValidEnd)) > 512)
+        {
+            newBVE = jmin (newBVE, bufferValidEnd + maxChunkSize);
+
+            sectionToReadStart = bufferValidEnd;
+            sectionToReadEnd = newBVE;
+
+            bufferValidStart = newBVS;
+            bufferValidEnd = jmin (bufferValidEnd.load(), newBVE);
+        }
+    }
+
+    if (sectionToReadStart == sectionToReadEnd)
+        return false;
+
+    jassert (buffer.getNumSamples() > 0);
+    const auto bufferIndexStart = (int) (sectionToReadStart % buffer.getNumSamples());
+    const auto bufferIndexEnd = (int) (sectionToReadEnd % buffer.getNumSamples());
+
+    if (bufferIndexStart < bufferIndexEnd)
+    {
+        readBufferSection (sectionToReadStart,
+                           (int) (sectionToReadEnd - sectionToReadStart),
+                           bufferIndexStart);
+    }
+    else
+    {
+        const auto initialSize = buffer.getNumSamples() - bufferIndexStart;
+
+        readBufferSection (sectionToReadStart,
+                           initialSize,
+                           bufferIndexStart);
+
+        readBufferSection (sectionToReadStart + initialSize,
+                           (int) (sectionToReadEnd - sectionToReadStart) - initialSize,
+                           0);
+    }
+
+    {
+        const ScopedLock sl2 (bufferStartPosLock);
+
+        bufferValidStart = newBVS;
+        bufferValidEnd = newBVE;
+    }
+
+    bufferReadyEvent.signal();
+    return true;
+}
+
+void SRCReadAheadSource::readBufferSection (const int64 start, const int length, const int bufferOffset)
+{
+    if (source->getNextReadPosition() != start)
+        source->setNextReadPosition (start);
+
+    AudioSourceChannelInfo info (&buffer, bufferOffset, length);
+    source->getNextAudioBlock (info);
+}
+
+} // namespace juce
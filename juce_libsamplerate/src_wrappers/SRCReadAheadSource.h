@@ -0,0 +1,222 @@
+/*
+ ==============================================================================
+    Copyright (c) 2019, Tal Aviram
+    All rights reserved.
+
+    This code is released under 2-clause BSD license. Please see the
+    file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#pragma once
+
+namespace juce
+{
+
+class SRCReadAheadScheduler;
+
+//==============================================================================
+/**
+ A read-ahead buffer like BufferingAudioSource, whose size can change while it plays.
+
+ The source is read on a TimeSliceThread into a circular buffer, exactly as
+ BufferingAudioSource does. On top of that:
+ - setBufferSize() resizes the buffer on the reading thread, keeping the audio that
+   has already been read.
+ - the buffer can adapt itself: it grows after an underrun, and shrinks when its fill
+   level never dropped below half for a while.
+ - the memory of many of these can be capped by a shared Budget.
+ - instead of a TimeSliceThread, it can be read by an SRCReadAheadScheduler, which
+   refills whichever of its buffers is closest to running out first.
+
+ @see BufferingAudioSource, SRCReadAheadScheduler, SRCAudioTransportSource
+
+ @tags{Audio}
+ */
+class SRCReadAheadSource  : public PositionableAudioSource,
+                            private TimeSliceClient
+{
+public:
+    //==============================================================================
+    /**
+     A memory limit shared by several SRCReadAheadSources.
+
+     A source that asks for more than is left gets what is left, but never less than the
+     minimum it needs to play (twice its block size), so the limit can be exceeded by that.
+     The budget must outlive every source that uses it.
+     */
+    class Budget
+    {
+    public:
+        explicit Budget (size_t maxBytes);
+
+        void setMaxBytes (size_t newMaxBytes);
+        size_t getMaxBytes() const noexcept;
+
+        /** Returns the bytes held by all the sources using this budget. */
+        size_t getBytesInUse() const noexcept;
+
+    private:
+        friend class SRCReadAheadSource;
+        size_t reserve (size_t currentBytes, size_t wantedBytes, size_t minimumBytes);
+
+        mutable SpinLock lock;
+        size_t maxBytes, bytesInUse = 0;
+
+        JUCE_DECLARE_NON_COPYABLE (Budget)
+    };
+
+    /** What the buffer has been doing, e.g. for a meter or for logging. */
+    struct Statistics
+    {
+        int bufferSize = 0;         // the current size, in samples of the source
+        int targetSize = 0;         // the size asked for, before the budget
+        int minimumFillLevel = -1;  // the lowest fill level since the buffer last adapted, or -1
+        int numUnderruns = 0;       // blocks that couldn't be filled, not counting seeks
+    };
+
+    //==============================================================================
+    /** Creates a read-ahead buffer.
+
+     @param source                   the source to read from
+     @param backgroundThread         the thread that reads ahead. It must not be deleted while
+                                     this object uses it.
+     @param deleteSourceWhenDeleted  if true, the source is deleted with this object
+     @param bufferSizeSamples        the size of buffer to start with, in samples of the source
+     @param numberOfChannels         the number of channels to buffer
+     @param budget                   if not nullptr, a budget the buffer's memory is taken from
+     */
+    SRCReadAheadSource (PositionableAudioSource* source,
+                        TimeSliceThread& backgroundThread,
+                        bool deleteSourceWhenDeleted,
+                        int bufferSizeSamples,
+                        int numberOfChannels = 2,
+                        Budget* budget = nullptr);
+
+    /** Creates a read-ahead buffer that's read by a scheduler shared with other buffers.
+        The scheduler must not be deleted while this object uses it. The other parameters
+        are the same as above.
+     */
+    SRCReadAheadSource (PositionableAudioSource* source,
+                        SRCReadAheadScheduler& scheduler,
+                        bool deleteSourceWhenDeleted,
+                        int bufferSizeSamples,
+                        int numberOfChannels = 2,
+                        Budget* budget = nullptr);
+
+    /** Destructor. */
+    ~SRCReadAheadSource() override;
+
+    //==============================================================================
+    /** Changes the size of the buffer, in samples of the source.
+        It is applied on the reading thread, keeping what was already read. With
+        adaptation on, this is where the buffer adapts from.
+     */
+    void setBufferSize (int numSamples);
+
+    /** Lets the buffer grow after underruns and shrink while it stays well filled,
+        between the given sizes in samples of the source.
+     */
+    void setAdaptive (bool shouldAdapt, int minimumSize, int maximumSize);
+
+    /** Returns the current size, fill level and underrun count. */
+    Statistics getStatistics() const;
+
+    /** Tells the buffer how fast it's played, for an SRCReadAheadScheduler to work out how
+        long it has until it runs out. Until this is called, the sample-rate given to
+        prepareToPlay() is used, which is only right if nothing changes the rate after it.
+
+     @param outputSampleRate             the rate of the audio the buffer's audio ends up in
+     @param samplesInPerOutputSample     the conversion ratio between the buffer and that
+                                         output, e.g. SRCAudioSource::getResamplingRatio()
+     */
+    void setPlaybackRate (double outputSampleRate, double samplesInPerOutputSample);
+
+    /** Puts the buffer in a group whose buffers an SRCReadAheadScheduler refills together,
+        such as buffers of the same file. Call it before prepareToPlay().
+     */
+    void setReadGroup (const String& groupName);
+
+    /** Returns the time until the buffer runs out at its playback rate, or 0 if it has
+        nothing ready to play. */
+    double getSecondsUntilUnderrun() const noexcept;
+
+    /** Sets whether prepareToPlay() waits for the first part of the buffer to be read, as
+        BufferingAudioSource does. It does by default; a caller that mustn't block, such as
+        a thread shared by several users, can turn it off and poll isReadyToPlay() instead.
+     */
+    void setPrepareWaitsForBuffer (bool shouldWait) noexcept   { prepareWaitsForBuffer = shouldWait; }
+
+    /** Returns true once the part of the buffer that prepareToPlay() waits for has been
+        read, which is a quarter of a second or half the buffer, whichever is less. */
+    bool isReadyToPlay() const noexcept;
+
+    /** Returns how long prepareToPlay() waits for the buffer at most, in milliseconds. */
+    static constexpr uint32 getPrepareTimeoutMs() noexcept      { return prepareTimeoutMs; }
+
+    /** Waits until the next block can be read without an underrun, or the timeout expires. */
+    bool waitForNextAudioBlockReady (const AudioSourceChannelInfo&, uint32 timeoutMs);
+
+    //==============================================================================
+    void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock (const AudioSourceChannelInfo&) override;
+
+    void setNextReadPosition (int64 newPosition) override;
+    int64 getNextReadPosition() const override;
+    int64 getTotalLength() const override                   { return source->getTotalLength(); }
+    bool isLooping() const override                         { return source->isLooping(); }
+
+private:
+    //==============================================================================
+    friend class SRCReadAheadScheduler;
+    enum { adaptIntervalMs = 1000, prepareTimeoutMs = 30000 };
+
+    SRCReadAheadSource (PositionableAudioSource*, TimeSliceThread*, SRCReadAheadScheduler*, bool, int, int, Budget*);
+
+    void startReading();
+    void stopReading();
+    void wakeReader();
+    bool needsReading() const noexcept;
+    bool readAhead();
+    int useTimeSlice() override;
+    bool readNextBufferChunk();
+    void readBufferSection (int64 start, int length, int bufferOffset);
+    void applyBufferSize();
+    void adaptBufferSize();
+    int getMinimumBufferSize() const noexcept               { return jmax (1024, blockSize * 2); }
+    size_t getBytesFor (int numSamples) const noexcept      { return sizeof (float) * (size_t) (numChannels * numSamples); }
+
+    //==============================================================================
+    OptionalScopedPointer<PositionableAudioSource> source;
+    TimeSliceThread* const backgroundThread;
+    SRCReadAheadScheduler* const scheduler;
+    const int numChannels;
+    Budget* const budget;
+
+    AudioBuffer<float> buffer;
+    CriticalSection bufferStartPosLock;
+    WaitableEvent bufferReadyEvent;
+    std::atomic<int64> bufferValidStart { 0 }, bufferValidEnd { 0 }, nextPlayPos { 0 };
+    std::atomic<int64> sourceLength { 0 }; // kept up to date by the reading thread, for the audio thread
+    double sampleRate = 0;
+    int blockSize = 0;
+    bool wasSourceLooping = false, isPrepared = false, prepareWaitsForBuffer = true;
+    size_t reservedBytes = 0;
+
+    std::atomic<int> targetSize, currentSize { 0 };
+    std::atomic<bool> adaptive { false }, resizePending { false };
+    std::atomic<double> playbackRate { 0.0 };
+    String readGroup;
+    int minimumAdaptiveSize = 0, maximumAdaptiveSize = 0;
+    uint32 lastAdaptTime = 0;
+    int underrunsAtLastAdapt = 0;
+
+    // written by the audio thread
+    std::atomic<int> numUnderruns { 0 }, minimumFillLevel { -1 };
+    std::atomic<bool> seekPending { true };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SRCReadAheadSource)
+};
+
+} // namespace juce
@@ -0,0 +1,392 @@
+/*
+ ==============================================================================
+ Copyright (c) 2019, Tal Aviram
+ All rights reserved.
+
+ This code is released under 2-clause BSD license. Please see the
+ file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#include "SRCResampledAssetCache.h"
+
+namespace juce
+{
+
+namespace SRCAssetCacheHelpers
+{
+    static const char* const fileExtension = ".srcf";
+
+    /** Header of an on-disk asset. The planar float samples follow it, one channel after
+        the other, so the file can be mapped and referred to without copying.
+     */
+    struct FileHeader
+    {
+        char magic[4];
+        int32 version;
+        int32 numChannels;
+        int32 numSamples;
+        double sampleRate;
+        double sourceSampleRate;
+        int64 sourceHash;
+        int64 sourceIdHash;
+        int32 quality;
+        char reserved[12];
+
+        static FileHeader create (const SRCResampledAssetCache::Key& key, const AudioBuffer<float>& buffer) noexcept
+        {
+            FileHeader header;
+            zerostruct (header);
+            memcpy (header.magic, "SRCf", 4);
+            header.version = currentVersion;
+            header.numChannels = buffer.getNumChannels();
+            header.numSamples = buffer.getNumSamples();
+            header.sampleRate = key.targetSampleRate;
+            header.sourceSampleRate = key.sourceSampleRate;
+            header.sourceHash = key.sourceHash;
+            header.sourceIdHash = key.sourceId.hashCode64();
+            header.quality = (int32) key.quality;
+            return header;
+        }
+
+        bool matches (const SRCResampledAssetCache::Key& key) const noexcept
+        {
+            return memcmp (magic, "SRCf", 4) == 0
+                && version == currentVersion
+                && numChannels > 0 && numSamples >= 0
+                && sampleRate == key.targetSampleRate
+                && sourceSampleRate == key.sourceSampleRate
+                && sourceHash == key.sourceHash
+                && sourceIdHash == key.sourceId.hashCode64()
+                && quality == (int32) key.quality;
+        }
+
+        size_t getFileSize() const noexcept
+        {
+            return sizeof (FileHeader) + sizeof (float) * (size_t) numChannels * (size_t) numSamples;
+        }
+
+        static constexpr int32 currentVersion = 1;
+    };
+
+    static_assert (sizeof (FileHeader) == 64, "The header keeps the samples 16-byte aligned in the mapped file");
+}
+
+//==============================================================================
+bool SRCResampledAssetCache::Key::operator== (const Key& other) const noexcept
+{
+    return sourceHash == other.sourceHash
+        && sourceSampleRate == other.sourceSampleRate
+        && targetSampleRate == other.targetSampleRate
+        && quality == other.quality
+        && sourceId == other.sourceId;
+}
+
+String SRCResampledAssetCache::Key::getCacheFileName() const
+{
+    return String::toHexString (sourceId.hashCode64())
+            + "_" + String::toHexString (sourceHash)
+            + "_" + String (roundToInt (sourceSampleRate))
+            + "_" + String (roundToInt (targetSampleRate))
+            + "_q" + String ((int) quality)
+            + SRCAssetCacheHelpers::fileExtension;
+}
+
+//==============================================================================
+SRCResampledAssetCache::Asset::Asset (AudioBuffer<float>&& resampled, const double rate)
+    : buffer (std::move (resampled)),
+      sampleRate (rate)
+{
+}
+
+SRCResampledAssetCache::Asset::Asset (MemoryMappedFile* const file, const int numChannels, const int numSamples, const double rate)
+    : mappedFile (file),
+      sampleRate (rate)
+{
+    auto* samples = static_cast<float*> (addBytesToPointer (mappedFile->getData(), sizeof (SRCAssetCacheHelpers::FileHeader)));
+
+    mappedChannels.malloc ((size_t) numChannels);
+
+    for (auto channel = 0; channel < numChannels; ++channel)
+        mappedChannels[channel] = samples + (size_t) channel * (size_t) numSamples;
+
+    buffer.setDataToReferTo (mappedChannels, numChannels, numSamples);
+}
+
+size_t SRCResampledAssetCache::Asset::getSizeInBytes() const noexcept
+{
+    return sizeof (float) * (size_t) buffer.getNumChannels() * (size_t) buffer.getNumSamples();
+}
+
+//==============================================================================
+SRCResampledAssetCache::AssetSource::AssetSource (Asset::Ptr assetToPlay, const bool shouldLoop)
+    : asset (assetToPlay),
+      looping (shouldLoop)
+{
+    jassert (asset != nullptr);
+}
+
+int64 SRCResampledAssetCache::AssetSource::getTotalLength() const
+{
+    return asset->getBuffer().getNumSamples();
+}
+
+void SRCResampledAssetCache::AssetSource::getNextAudioBlock (const AudioSourceChannelInfo& info)
+{
+    const auto& source = asset->getBuffer();
+    const int64 length = source.getNumSamples();
+    const auto channelsToCopy = jmin (info.buffer->getNumChannels(), source.getNumChannels());
+
+    auto pos = position;
+    auto samplesDone = 0;
+
+    while (samplesDone < info.numSamples)
+    {
+        if (looping && length > 0)
+            pos %= length;
+
+        if (pos >= length)
+        {
+            info.buffer->clear (info.startSample + samplesDone, info.numSamples - samplesDone);
+            pos += info.numSamples - samplesDone;
+            break;
+        }
+
+        const auto numToCopy = (int) jmin ((int64) (info.numSamples - samplesDone), length - pos);
+
+        for (auto channel = 0; channel < channelsToCopy; ++channel)
+            info.buffer->copyFrom (channel, info.startSample + samplesDone, source, channel, (int) pos, numToCopy);
+
+        for (auto channel = channelsToCopy; channel < info.buffer->getNumChannels(); ++channel)
+            info.buffer->clear (channel, info.startSample + samplesDone, numToCopy);
+
+        samplesDone += numToCopy;
+        pos += numToCopy;
+    }
+
+    position = pos;
+}
+
+//==============================================================================
+SRCResampledAssetCache::SRCResampledAssetCache (const size_t maxBytesInMemory, const File& diskCacheDirectory)
+    : directory (diskCacheDirectory),
+      maxBytes (maxBytesInMemory)
+{
+}
+
+SRCResampledAssetCache::~SRCResampledAssetCache()
+{
+}
+
+SRCResampledAssetCache::Asset::Ptr SRCResampledAssetCache::getResampled (const Key& key, const AudioBuffer<float>& source)
+{
+    if (auto cached = findCached (key))
+        return cached;
+
+    // converted straight from the caller's buffer, which is only read
+    return convertAndAdd (key, source);
+}
+
+SRCResampledAssetCache::Asset::Ptr SRCResampledAssetCache::getResampled (const Key& key, std::function<bool (AudioBuffer<float>&)> loadSource)
+{
+    if (auto cached = findCached (key))
+        return cached;
+
+    AudioBuffer<float> source;
+
+    if (! loadSource (source))
+        return nullptr;
+
+    return convertAndAdd (key, source);
+}
+
+SRCResampledAssetCache::Asset::Ptr SRCResampledAssetCache::findCached (const Key& key)
+{
+    {
+        const ScopedLock sl (lock);
+
+        if (auto asset = findInMemory (key))
+            return asset;
+    }
+
+    if (auto asset = loadFromDisk (key))
+        return addToMemory (key, asset);
+
+    return nullptr;
+}
+
+//==============================================================================
+void SRCResampledAssetCache::setMaxBytesInMemory (const size_t newMaxBytes)
+{
+    const ScopedLock sl (lock);
+    maxBytes = newMaxBytes;
+    evictIfNeeded();
+}
+
+size_t SRCResampledAssetCache::getBytesInMemory() const
+{
+    const ScopedLock sl (lock);
+    return bytesInMemory;
+}
+
+void SRCResampledAssetCache::clearMemoryTier()
+{
+    const ScopedLock sl (lock);
+    entries.clear();
+    bytesInMemory = 0;
+}
+
+void SRCResampledAssetCache::clearDiskTier()
+{
+    if (! directory.isDirectory())
+        return;
+
+    for (auto& file : directory.findChildFiles (File::findFiles, false, String ("*") + SRCAssetCacheHelpers::fileExtension))
+        file.deleteFile();
+}
+
+//==============================================================================
+SRCResampledAssetCache::Asset::Ptr SRCResampledAssetCache::findInMemory (const Key& key)
+{
+    for (auto i = entries.size(); --i >= 0;)
+    {
+        if (entries.getReference (i).key == key)
+        {
+            // move it to the most recently used end
+            auto entry = entries.getReference (i);
+            entries.remove (i);
+            entries.add (entry);
+            return entry.asset;
+        }
+    }
+
+    return nullptr;
+}
+
+SRCResampledAssetCache::Asset::Ptr SRCResampledAssetCache::addToMemory (const Key& key, Asset::Ptr asset)
+{
+    const ScopedLock sl (lock);
+
+    // another thread may have added the same asset meanwhile
+    if (auto existing = findInMemory (key))
+        return existing;
+
+    entries.add ({ key, asset });
+    bytesInMemory += asset->getSizeInBytes();
+    evictIfNeeded();
+
+    return asset;
+}
+
+void SRCResampledAssetCache::evictIfNeeded()
+{
+    // the most recent asset is always kept, even if it's larger than the budget on its own.
+    while (bytesInMemory > maxBytes && entries.size() > 1)
+    {
+        bytesInMemory -= entries.getReference (0).asset->getSizeInBytes();
+        entries.remove (0);
+    }
+}
+
+SRCResampledAssetCache::Asset::Ptr SRCResampledAssetCache::loadFromDisk (const Key& key)
+{
+    using namespace SRCAssetCacheHelpers;
+
+    if (directory == File())
+        return nullptr;
+
+    auto file = directory.getChildFile (key.getCacheFileName());
+
+    if (! file.existsAsFile())
+        return nullptr;
+
+    std::unique_ptr<MemoryMappedFile> mapped (new MemoryMappedFile (file, MemoryMappedFile::readOnly));
+
+    if (mapped->getData() == nullptr || mapped->getSize() < sizeof (FileHeader))
+        return nullptr;
+
+    const auto& header = *static_cast<const FileHeader*> (mapped->getData());
+
+    if (! header.matches (key) || mapped->getSize() < header.getFileSize())
+        return nullptr;
+
+    return new Asset (mapped.release(), header.numChannels, header.numSamples, header.sampleRate);
+}
+
+bool SRCResampledAssetCache::writeToDisk (const Key& key, const Asset& asset) const
+{
+    using namespace SRCAssetCacheHelpers;
+
+    if (directory == File() || ! directory.createDirectory())
+        return false;
+
+    const auto& buffer = asset.getBuffer();
+    auto file = directory.getChildFile (key.getCacheFileName());
+    auto tempFile = file.withFileExtension (".tmp").getNonexistentSibling();
+
+    {
+        FileOutputStream out (tempFile);
+
+        if (out.failedToOpen())
+            return false;
+
+        const auto header = FileHeader::create (key, buffer);
+        auto ok = out.write (&header, sizeof (header));
+
+        for (auto channel = 0; ok && channel < buffer.getNumChannels(); ++channel)
+            ok = out.write (buffer.getReadPointer (channel), sizeof (float) * (size_t) buffer.getNumSamples());
+
+        out.flush();
+
+        if (! ok)
+        {
+            tempFile.deleteFile();
+            return false;
+        }
+    }
+
+    // written aside and moved, so a reader never maps a half-written file
+    return tempFile.moveFileTo (file);
+}
+
+SRCResampledAssetCache::Asset::Ptr SRCResampledAssetCache::convertAndAdd (const Key& key, const AudioBuffer<float>& source)
+{
+    if (source.getNumChannels() == 0)
+        return nullptr;
+
+    auto converted = convert (key, source);
+
+    if (converted == nullptr)
+        return nullptr;
+
+    writeToDisk (key, *converted);
+    return addToMemory (key, converted);
+}
+
+SRCResampledAssetCache::Asset::Ptr SRCResampledAssetCache::convert (const Key& key, const AudioBuffer<float>& source)
+{
+    jassert (key.sourceSampleRate > 0 && key.targetSampleRate > 0);
+
+    const auto samplesInPerOutputSample = key.sourceSampleRate / key.targetSampleRate;
+    const auto numOutputSamples = (int) std::ceil (source.getNumSamples() / samplesInPerOutputSample);
+
+    AudioBuffer<float> resampled (source.getNumChannels(), numOutputSamples);
+
+    // SRC::resample treats its buffer as interleaved, so each channel is converted on its own.
+    for (auto channel = 0; channel < source.getNumChannels(); ++channel)
+    {
+        auto* inputChannel = const_cast<float*> (source.getReadPointer (channel));
+        auto* outputChannel = resampled.getWritePointer (channel);
+        FloatVectorOperations::clear (outputChannel, numOutputSamples);
+
+        const AudioBuffer<float> input (&inputChannel, 1, source.getNumSamples());
+        AudioBuffer<float> output (&outputChannel, 1, numOutputSamples);
+
+        if (libsamplerate::SRC::resample (input, output, samplesInPerOutputSample, key.quality) != 0)
+            return nullptr;
+    }
+
+    return new Asset (std::move (resampled), key.targetSampleRate);
+}
+
+} // namespace juce
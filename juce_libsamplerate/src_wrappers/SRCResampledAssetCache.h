@@ -0,0 +1,203 @@
+/*
+ ==============================================================================
+    Copyright (c) 2019, Tal Aviram
+    All rights reserved.
+
+    This code is released under 2-clause BSD license. Please see the
+    file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#pragma once
+
+namespace juce
+{
+
+//==============================================================================
+/**
+ A cache of resampled audio assets, keyed by source identity, target sample-rate and quality.
+
+ Lookups go through two tiers:
+ - an in-memory tier that keeps the most recently used assets up to a byte budget.
+ - an optional on-disk tier that stores each asset as raw planar floats, so it can be
+   memory-mapped back instead of being decoded or converted again.
+
+ When both tiers miss, the source is converted with libsamplerate and the result is
+ added to both tiers.
+
+ The cache works on whole clips, so it sits in front of the transport rather than
+ inside it: look up the asset for the device's sample-rate, once it is known, and
+ play it through an AssetSource given to SRCAudioTransportSource::setSource() with
+ no sample-rate correction.
+
+ @see SRC::resample, SRCAudioTransportSource
+
+ @tags{Audio}
+ */
+class SRCResampledAssetCache
+{
+public:
+    typedef libsamplerate::SRC::ResamplerQuality ResamplerQuality;
+
+    //==============================================================================
+    /** Identifies a single resampled version of a source asset. */
+    struct Key
+    {
+        /** Something that identifies the source, e.g. the full path of its file. */
+        String sourceId;
+        /** A hash of the source content (or its size and modification time).
+            Change this whenever the source changes so stale entries are not used.
+         */
+        int64 sourceHash = 0;
+        double sourceSampleRate = 0.0;
+        double targetSampleRate = 0.0;
+        ResamplerQuality quality = ResamplerQuality::SRC_SINC_MEDIUM_QUALITY;
+
+        bool operator== (const Key& other) const noexcept;
+        bool operator!= (const Key& other) const noexcept     { return ! operator== (other); }
+
+        /** Returns the file name used for this key in the on-disk tier. */
+        String getCacheFileName() const;
+    };
+
+    //==============================================================================
+    /** A resampled asset.
+
+     The samples are either owned by the asset or memory-mapped from the on-disk tier,
+     so they must be treated as read-only.
+     */
+    class Asset  : public ReferenceCountedObject
+    {
+    public:
+        typedef ReferenceCountedObjectPtr<Asset> Ptr;
+
+        /** Returns the resampled audio. */
+        const AudioBuffer<float>& getBuffer() const noexcept        { return buffer; }
+
+        /** Returns the sample-rate of the resampled audio. */
+        double getSampleRate() const noexcept                       { return sampleRate; }
+
+        /** Returns true if the samples are mapped from the on-disk tier. */
+        bool isMemoryMapped() const noexcept                        { return mappedFile != nullptr; }
+
+        /** Returns the number of bytes used by the samples. */
+        size_t getSizeInBytes() const noexcept;
+
+    private:
+        friend class SRCResampledAssetCache;
+
+        Asset (AudioBuffer<float>&& resampled, double rate);
+        Asset (MemoryMappedFile* file, int numChannels, int numSamples, double rate);
+
+        std::unique_ptr<MemoryMappedFile> mappedFile;
+        HeapBlock<float*> mappedChannels;
+        AudioBuffer<float> buffer;
+        const double sampleRate;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Asset)
+    };
+
+    //==============================================================================
+    /** A PositionableAudioSource that plays a cached asset.
+
+     Use it with SRCAudioTransportSource without any sample-rate correction, as the
+     asset is already at the target rate.
+     */
+    class AssetSource  : public PositionableAudioSource
+    {
+    public:
+        explicit AssetSource (Asset::Ptr assetToPlay, bool shouldLoop = false);
+
+        void prepareToPlay (int, double) override {}
+        void releaseResources() override {}
+        void getNextAudioBlock (const AudioSourceChannelInfo&) override;
+
+        void setNextReadPosition (int64 newPosition) override   { position = newPosition; }
+        int64 getNextReadPosition() const override              { return position; }
+        int64 getTotalLength() const override;
+        bool isLooping() const override                         { return looping; }
+        void setLooping (bool shouldLoop) override              { looping = shouldLoop; }
+
+    private:
+        Asset::Ptr asset;
+        int64 position = 0;
+        bool looping;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AssetSource)
+    };
+
+    //==============================================================================
+    /** Creates a cache.
+
+     @param maxBytesInMemory        the budget of the in-memory tier
+     @param diskCacheDirectory      where the on-disk tier is kept. If this is File(),
+                                    only the in-memory tier is used.
+     */
+    SRCResampledAssetCache (size_t maxBytesInMemory, const File& diskCacheDirectory = File());
+
+    /** Destructor. */
+    ~SRCResampledAssetCache();
+
+    //==============================================================================
+    /** Returns the resampled version of a source, converting it if it isn't cached.
+
+     @param key         identifies the source and the wanted conversion
+     @param source      the source audio, at key.sourceSampleRate
+     */
+    Asset::Ptr getResampled (const Key& key, const AudioBuffer<float>& source);
+
+    /** Returns the resampled version of a source, converting it if it isn't cached.
+
+     The source is only loaded when both tiers miss, which avoids decoding it at all
+     on a hit.
+
+     @param key             identifies the source and the wanted conversion
+     @param loadSource      fills the buffer with the source audio and returns true,
+                            or returns false if it couldn't be loaded
+     */
+    Asset::Ptr getResampled (const Key& key, std::function<bool (AudioBuffer<float>&)> loadSource);
+
+    /** Returns the asset if either tier has it, without converting anything. */
+    Asset::Ptr findCached (const Key& key);
+
+    //==============================================================================
+    /** Changes the budget of the in-memory tier, evicting assets if needed. */
+    void setMaxBytesInMemory (size_t newMaxBytes);
+
+    /** Returns the number of bytes currently held by the in-memory tier. */
+    size_t getBytesInMemory() const;
+
+    /** Drops every asset from the in-memory tier.
+        Assets that are still referenced elsewhere stay valid.
+     */
+    void clearMemoryTier();
+
+    /** Deletes every file of the on-disk tier. */
+    void clearDiskTier();
+
+private:
+    //==============================================================================
+    struct Entry
+    {
+        Key key;
+        Asset::Ptr asset;
+    };
+
+    Asset::Ptr findInMemory (const Key&);
+    Asset::Ptr loadFromDisk (const Key&);
+    Asset::Ptr addToMemory (const Key&, Asset::Ptr);
+    Asset::Ptr convertAndAdd (const Key&, const AudioBuffer<float>& source);
+    bool writeToDisk (const Key&, const Asset&) const;
+    void evictIfNeeded();
+
+    static Asset::Ptr convert (const Key&, const AudioBuffer<float>& source);
+
+    File directory;
+    size_t maxBytes, bytesInMemory = 0;
+    Array<Entry> entries; // least recently used first
+    CriticalSection lock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SRCResampledAssetCache)
+};
+
+} // namespace juce
@@ -0,0 +1,178 @@
+/*
+ ==============================================================================
+ Copyright (c) 2019, Tal Aviram
+ All rights reserved.
+
+ This code is released under 2-clause BSD license. Please see the
+ file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#include "SRCResamplingWriter.h"
+
+#if JUCE_MODULE_AVAILABLE_juce_audio_formats
+
+namespace juce
+{
+
+SRCResamplingWriter::SRCResamplingWriter (AudioFormatWriter* const w,
+                                          TimeSliceThread& thread,
+                                          const double inputSampleRate,
+                                          const int numSamplesToBuffer,
+                                          const ResamplerQuality quality)
+    : writer (w),
+      backgroundThread (thread),
+      numChannels ((int) w->getNumChannels()),
+      samplesInPerOutputSample (inputSampleRate / w->getSampleRate()),
+      fifo (numSamplesToBuffer),
+      buffer (numChannels, numSamplesToBuffer),
+      outputBuffer (numChannels, (int) std::ceil (maxChunkSize / samplesInPerOutputSample) + 64),
+      inputPointers ((size_t) numChannels)
+{
+    jassert (inputSampleRate > 0 && writer->getSampleRate() > 0 && numChannels > 0);
+
+    if (SRCFastInterpolator::supportsQuality (quality))
+    {
+        fastInterpolator.reset (new SRCFastInterpolator (quality, numChannels));
+        fastInterpolator->setResamplingRatio (samplesInPerOutputSample);
+    }
+    else
+    {
+        sincConverter.reset (new SRCSincConverter (SRCCoefficientTable::getTable (quality, SRCCoefficientTable::exactHalfTable),
+                                                   numChannels, samplesInPerOutputSample));
+        sincConverter->setResamplingRatio (samplesInPerOutputSample);
+    }
+
+    backgroundThread.addTimeSliceClient (this);
+}
+
+SRCResamplingWriter::~SRCResamplingWriter()
+{
+    backgroundThread.removeTimeSliceClient (this);
+
+    while (writePendingData() > 0)
+    {}
+
+    flushTail();
+    writer->flush();
+}
+
+//==============================================================================
+bool SRCResamplingWriter::write (const float* const* data, const int numSamples)
+{
+    if (numSamples <= 0)
+        return true;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite (numSamples, start1, size1, start2, size2);
+
+    if (size1 + size2 < numSamples)
+    {
+        overflowed = true;
+        return false;
+    }
+
+    for (auto channel = numChannels; --channel >= 0;)
+    {
+        buffer.copyFrom (channel, start1, data[channel], size1);
+        buffer.copyFrom (channel, start2, data[channel] + size1, size2);
+    }
+
+    fifo.finishedWrite (size1 + size2);
+    return true;
+}
+
+//==============================================================================
+int SRCResamplingWriter::useTimeSlice()
+{
+    return writePendingData() == 0 ? 10 : 0;
+}
+
+int SRCResamplingWriter::writePendingData()
+{
+    const auto numToDo = jmin ((int) maxChunkSize, fifo.getNumReady());
+
+    if (numToDo <= 0)
+        return 0;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToRead (numToDo, start1, size1, start2, size2);
+
+    if (size1 > 0)
+        convert (start1, size1);
+
+    if (size2 > 0)
+        convert (start2, size2);
+
+    fifo.finishedRead (size1 + size2);
+    return numToDo;
+}
+
+int SRCResamplingWriter::process (const float* const* input, const int numInputFrames, int& inputFramesUsed)
+{
+    auto** output = outputBuffer.getArrayOfWritePointers();
+    const auto numOutputFrames = outputBuffer.getNumSamples();
+
+    if (fastInterpolator != nullptr)
+        return fastInterpolator->process (input, numInputFrames, output, numOutputFrames,
+                                          samplesInPerOutputSample, inputFramesUsed);
+
+    return sincConverter->process (input, numInputFrames, output, numOutputFrames,
+                                   samplesInPerOutputSample, inputFramesUsed);
+}
+
+void SRCResamplingWriter::convert (const int start, const int numFrames)
+{
+    auto used = 0;
+
+    for (;;)
+    {
+        for (auto channel = 0; channel < numChannels; ++channel)
+            inputPointers[channel] = buffer.getReadPointer (channel, start + used);
+
+        auto inputFramesUsed = 0;
+        const auto generated = process (inputPointers, numFrames - used, inputFramesUsed);
+        used += inputFramesUsed;
+
+        if (generated > 0)
+        {
+            writer->writeFromAudioSampleBuffer (outputBuffer, 0, generated);
+            outputFramesWritten += generated;
+        }
+
+        if (generated == 0 && inputFramesUsed == 0)
+            break;
+    }
+
+    inputFramesConverted += numFrames;
+}
+
+void SRCResamplingWriter::flushTail()
+{
+    // the converter holds back the last half filter of input; silence pushes it out,
+    // and the file is cut to the length the recording converts to
+    const auto expectedLength = (int64) std::llround ((double) inputFramesConverted / samplesInPerOutputSample);
+
+    AudioBuffer<float> silence (numChannels, maxChunkSize);
+    silence.clear();
+
+    while (outputFramesWritten < expectedLength)
+    {
+        auto inputFramesUsed = 0;
+        const auto generated = process (silence.getArrayOfReadPointers(), maxChunkSize, inputFramesUsed);
+        const auto numToWrite = (int) jmin ((int64) generated, expectedLength - outputFramesWritten);
+
+        if (numToWrite > 0)
+        {
+            writer->writeFromAudioSampleBuffer (outputBuffer, 0, numToWrite);
+            outputFramesWritten += numToWrite;
+        }
+
+        if (generated == 0 && inputFramesUsed == 0)
+            break;
+    }
+}
+
+} // namespace juce
+
+#endif
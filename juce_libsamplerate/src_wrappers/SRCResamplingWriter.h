@@ -0,0 +1,111 @@
+/*
+ ==============================================================================
+    Copyright (c) 2019, Tal Aviram
+    All rights reserved.
+
+    This code is released under 2-clause BSD license. Please see the
+    file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#pragma once
+
+#if JUCE_MODULE_AVAILABLE_juce_audio_formats
+
+namespace juce
+{
+
+//==============================================================================
+/**
+ Records audio from the audio callback to an AudioFormatWriter at a different sample-rate.
+
+ Like AudioFormatWriter::ThreadedWriter, write() only copies the audio into a lock-free
+ FIFO and never allocates or blocks, so it can be called from the audio callback. A
+ TimeSliceThread drains the FIFO, converts it from the input sample-rate to the writer's
+ sample-rate, and writes the result. Sinc qualities are run by SRCSincConverter (with
+ the exact coefficient layout, so the result matches libsamplerate) and SRC_LINEAR and
+ SRC_ZERO_ORDER_HOLD by SRCFastInterpolator.
+
+ When this object is deleted, whatever is left in the FIFO is written, the converter's
+ tail is flushed so the file is exactly as long as the recording, and the writer is
+ deleted.
+
+ @see AudioFormatWriter::ThreadedWriter, SRCSincConverter
+
+ @tags{Audio}
+ */
+class SRCResamplingWriter  : private TimeSliceClient
+{
+public:
+    typedef libsamplerate::SRC::ResamplerQuality ResamplerQuality;
+
+    //==============================================================================
+    /** Creates a writer.
+
+     @param writer                   the writer to write to, at its own sample-rate. This
+                                     object takes ownership of it.
+     @param backgroundThread         the thread that converts and writes. It must not be
+                                     deleted while this object uses it.
+     @param inputSampleRate          the sample-rate of the audio passed to write()
+     @param numSamplesToBuffer       the size of the FIFO, in samples at the input rate
+     @param quality                  quality / type of sample rate conversion
+     */
+    SRCResamplingWriter (AudioFormatWriter* writer,
+                         TimeSliceThread& backgroundThread,
+                         double inputSampleRate,
+                         int numSamplesToBuffer,
+                         ResamplerQuality quality = ResamplerQuality::SRC_SINC_MEDIUM_QUALITY);
+
+    /** Destructor. Writes what's left, then deletes the writer. */
+    ~SRCResamplingWriter() override;
+
+    //==============================================================================
+    /** Pushes some audio into the FIFO, to be converted and written on the background thread.
+
+     This never allocates or waits, so it can be called from the audio callback.
+
+     @param data         one pointer per channel of the writer
+     @param numSamples   the number of samples, at the input rate
+     @returns false if the FIFO didn't have room for it; the audio is then dropped
+     */
+    bool write (const float* const* data, int numSamples);
+
+    /** Returns the number of samples written to the file so far, at the writer's rate. */
+    int64 getNumSamplesWritten() const noexcept             { return outputFramesWritten; }
+
+    /** Returns true if write() ever had to drop audio. */
+    bool hasOverflowed() const noexcept                     { return overflowed; }
+
+private:
+    //==============================================================================
+    enum { maxChunkSize = 4096 };
+
+    int useTimeSlice() override;
+    int writePendingData();
+    void convert (int fifoStart, int numFrames);
+    void flushTail();
+    int process (const float* const* input, int numInputFrames, int& inputFramesUsed);
+
+    //==============================================================================
+    std::unique_ptr<AudioFormatWriter> writer;
+    TimeSliceThread& backgroundThread;
+    const int numChannels;
+    const double samplesInPerOutputSample;
+
+    AbstractFifo fifo;
+    AudioBuffer<float> buffer, outputBuffer;
+    HeapBlock<const float*> inputPointers;
+
+    std::unique_ptr<SRCSincConverter> sincConverter;
+    std::unique_ptr<SRCFastInterpolator> fastInterpolator;
+
+    int64 inputFramesConverted = 0;
+    std::atomic<int64> outputFramesWritten { 0 };
+    std::atomic<bool> overflowed { false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SRCResamplingWriter)
+};
+
+} // namespace juce
+
+#endif
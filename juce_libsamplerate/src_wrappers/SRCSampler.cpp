@@ -0,0 +1,207 @@
+/*
+ ==============================================================================
+ Copyright (c) 2019, Tal Aviram
+ All rights reserved.
+
+ This code is released under 2-clause BSD license. Please see the
+ file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#include "SRCSampler.h"
+
+namespace juce
+{
+
+SRCSamplerSound::SRCSamplerSound (const String& soundName,
+                                  const AudioBuffer<float>& sampleData,
+                                  const double sampleRate,
+                                  const BigInteger& notes,
+                                  const int midiNoteForNormalPitch,
+                                  const double attackTimeSecs,
+                                  const double releaseTimeSecs)
+    : name (soundName),
+      sourceSampleRate (sampleRate),
+      midiNotes (notes),
+      midiRootNote (midiNoteForNormalPitch)
+{
+    jassert (sampleData.getNumChannels() > 0 && sourceSampleRate > 0);
+
+    data.makeCopyOf (sampleData);
+
+    params.attack  = static_cast<float> (attackTimeSecs);
+    params.release = static_cast<float> (releaseTimeSecs);
+}
+
+SRCSamplerSound::~SRCSamplerSound()
+{
+}
+
+bool SRCSamplerSound::appliesToNote (int midiNoteNumber)
+{
+    return midiNotes[midiNoteNumber];
+}
+
+bool SRCSamplerSound::appliesToChannel (int /*midiChannel*/)
+{
+    return true;
+}
+
+//==============================================================================
+SRCSamplerVoice::SRCSamplerVoice (const ResamplerQuality quality, const int channels, const int maxChunkSize)
+    : numChannels (channels),
+      scratch (channels, maxChunkSize)
+{
+    jassert (numChannels > 0 && maxChunkSize > 0);
+
+    resamplers_.malloc ((size_t) numChannels);
+    data_.calloc ((size_t) numChannels);
+
+    for (auto channel = 0; channel < numChannels; channel++)
+    {
+        int src_error = 0;
+        resamplers_[channel] = libsamplerate::src_new (quality, 1, &src_error);
+        jassert (resamplers_[channel] != nullptr);
+    }
+}
+
+SRCSamplerVoice::~SRCSamplerVoice()
+{
+    for (auto channel = 0; channel < numChannels; channel++)
+        resamplers_[channel] = libsamplerate::src_delete (resamplers_[channel]);
+}
+
+void SRCSamplerVoice::addVoicesTo (Synthesiser& synth, const int numVoices, const ResamplerQuality quality,
+                                   const int numChannels, const int maxChunkSize)
+{
+    for (auto i = 0; i < numVoices; ++i)
+        synth.addVoice (new SRCSamplerVoice (quality, numChannels, maxChunkSize));
+}
+
+bool SRCSamplerVoice::canPlaySound (SynthesiserSound* sound)
+{
+    return dynamic_cast<const SRCSamplerSound*> (sound) != nullptr;
+}
+
+//==============================================================================
+void SRCSamplerVoice::startNote (const int midiNoteNumber, const float velocity,
+                                 SynthesiserSound* s, const int currentPitchWheelPosition)
+{
+    if (auto* sound = dynamic_cast<const SRCSamplerSound*> (s))
+    {
+        currentNote = midiNoteNumber;
+        noteGain = velocity;
+        sourcePosition = 0;
+
+        pitchBendSemitones = pitchBendRange * (currentPitchWheelPosition - 8192) / 8192.0;
+        updateRatio (*sound);
+
+        // a stolen voice may still hold the previous note's history
+        resetConverters();
+
+        for (auto channel = 0; channel < numChannels; channel++)
+            libsamplerate::src_set_ratio (resamplers_[channel], 1.0 / samplesInPerOutputSample);
+
+        adsr.setSampleRate (getSampleRate());
+        adsr.setParameters (sound->getEnvelopeParameters());
+        adsr.noteOn();
+    }
+    else
+    {
+        jassertfalse; // this object can only play SRCSamplerSounds!
+    }
+}
+
+void SRCSamplerVoice::stopNote (float /*velocity*/, const bool allowTailOff)
+{
+    if (allowTailOff)
+    {
+        adsr.noteOff();
+    }
+    else
+    {
+        clearCurrentNote();
+        adsr.reset();
+    }
+}
+
+void SRCSamplerVoice::pitchWheelMoved (const int newValue)
+{
+    pitchBendSemitones = pitchBendRange * (newValue - 8192) / 8192.0;
+
+    if (auto* sound = dynamic_cast<const SRCSamplerSound*> (getCurrentlyPlayingSound().get()))
+        updateRatio (*sound);
+}
+
+void SRCSamplerVoice::controllerMoved (int /*controllerNumber*/, int /*newValue*/)
+{
+}
+
+void SRCSamplerVoice::updateRatio (const SRCSamplerSound& sound) noexcept
+{
+    const auto semitones = currentNote - sound.getMidiRootNote() + pitchBendSemitones;
+    samplesInPerOutputSample = std::pow (2.0, semitones / 12.0) * sound.getSourceSampleRate() / getSampleRate();
+}
+
+void SRCSamplerVoice::resetConverters() noexcept
+{
+    for (auto channel = 0; channel < numChannels; channel++)
+        libsamplerate::src_reset (resamplers_[channel]);
+}
+
+//==============================================================================
+void SRCSamplerVoice::renderNextBlock (AudioBuffer<float>& outputBuffer, int startSample, int numSamples)
+{
+    auto* playingSound = static_cast<const SRCSamplerSound*> (getCurrentlyPlayingSound().get());
+
+    if (playingSound == nullptr)
+        return;
+
+    const auto& sample = playingSound->getAudioData();
+    const auto sampleChannels = sample.getNumChannels();
+    const auto sampleLength = (int64) sample.getNumSamples();
+    const auto outputChannels = outputBuffer.getNumChannels();
+
+    while (numSamples > 0)
+    {
+        const auto numToDo = jmin (numSamples, scratch.getNumSamples());
+
+        for (auto channel = 0; channel < numChannels; ++channel)
+        {
+            // the converter gets everything that is left of the sample, so it can flush its tail
+            auto& data = data_[channel];
+            data.data_in = sample.getReadPointer (jmin (channel, sampleChannels - 1)) + sourcePosition;
+            data.input_frames = (long) (sampleLength - sourcePosition);
+            data.data_out = scratch.getWritePointer (channel);
+            data.output_frames = numToDo;
+            data.src_ratio = 1.0 / samplesInPerOutputSample;
+            data.end_of_input = 1;
+
+            const auto src_result = libsamplerate::src_process (resamplers_[channel], &data);
+            jassert (src_result == 0);
+            ignoreUnused (src_result);
+            // this should be the same for all resamplers
+            jassert (data.output_frames_gen == data_[0].output_frames_gen);
+        }
+
+        const auto numGenerated = (int) data_[0].output_frames_gen;
+        sourcePosition += data_[0].input_frames_used;
+
+        adsr.applyEnvelopeToBuffer (scratch, 0, numGenerated);
+
+        for (auto channel = 0; channel < outputChannels; ++channel)
+            outputBuffer.addFrom (channel, startSample, scratch, jmin (channel, numChannels - 1), 0, numGenerated, noteGain);
+
+        if (numGenerated < numToDo || ! adsr.isActive())
+        {
+            // either the sample or the release has ended
+            stopNote (0.0f, false);
+            break;
+        }
+
+        startSample += numGenerated;
+        numSamples -= numGenerated;
+    }
+}
+
+} // namespace juce
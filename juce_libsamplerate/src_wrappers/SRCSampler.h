@@ -0,0 +1,178 @@
+/*
+ ==============================================================================
+    Copyright (c) 2019, Tal Aviram
+    All rights reserved.
+
+    This code is released under 2-clause BSD license. Please see the
+    file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#pragma once
+
+namespace juce
+{
+
+//==============================================================================
+/**
+ A subclass of SynthesiserSound that holds a sample to be played by SRCSamplerVoice.
+
+ The sample data is owned by the sound and only read by the voices playing it, so any
+ number of voices can play the same sound without copying it.
+
+ @see SRCSamplerVoice, Synthesiser, SamplerSound
+
+ @tags{Audio}
+ */
+class SRCSamplerSound  : public SynthesiserSound
+{
+public:
+    //==============================================================================
+    /** Creates a sampled sound.
+
+     @param name                     a name for the sample
+     @param sampleData               the audio to play, copied into the sound
+     @param sourceSampleRate         the sample-rate of sampleData
+     @param midiNotes                the set of midi keys that this sound should be played on
+     @param midiNoteForNormalPitch   the midi note at which the sample should be played
+                                     at its natural pitch
+     @param attackTimeSecs           the attack (fade-in) time, in seconds
+     @param releaseTimeSecs          the decay (fade-out) time, in seconds
+     */
+    SRCSamplerSound (const String& name,
+                     const AudioBuffer<float>& sampleData,
+                     double sourceSampleRate,
+                     const BigInteger& midiNotes,
+                     int midiNoteForNormalPitch,
+                     double attackTimeSecs,
+                     double releaseTimeSecs);
+
+    /** Destructor. */
+    ~SRCSamplerSound() override;
+
+    //==============================================================================
+    /** Returns the sample's name */
+    const String& getName() const noexcept                  { return name; }
+
+    /** Returns the audio sample data. */
+    const AudioBuffer<float>& getAudioData() const noexcept { return data; }
+
+    /** Returns the sample-rate of the audio sample data. */
+    double getSourceSampleRate() const noexcept             { return sourceSampleRate; }
+
+    /** Returns the midi note at which the sample plays at its natural pitch. */
+    int getMidiRootNote() const noexcept                    { return midiRootNote; }
+
+    //==============================================================================
+    /** Changes the parameters of the ADSR envelope which will be applied to the sample. */
+    void setEnvelopeParameters (ADSR::Parameters parametersToUse)    { params = parametersToUse; }
+
+    /** Returns the parameters of the ADSR envelope. */
+    const ADSR::Parameters& getEnvelopeParameters() const noexcept   { return params; }
+
+    //==============================================================================
+    bool appliesToNote (int midiNoteNumber) override;
+    bool appliesToChannel (int midiChannel) override;
+
+private:
+    //==============================================================================
+    String name;
+    AudioBuffer<float> data;
+    double sourceSampleRate;
+    BigInteger midiNotes;
+    int midiRootNote = 0;
+
+    ADSR::Parameters params;
+
+    JUCE_LEAK_DETECTOR (SRCSamplerSound)
+};
+
+
+//==============================================================================
+/**
+ A subclass of SynthesiserVoice that plays a SRCSamplerSound through libsamplerate.
+
+ Every converter state and work buffer a voice needs is allocated when the voice is
+ created, and is reset rather than reallocated when a note starts. So once a
+ Synthesiser has been given its voices, playing notes and stealing voices doesn't
+ touch the allocator. The converters read straight from the sound's data, so no
+ per-voice copy or input buffering is involved.
+
+ The pitch of each note is taken from its distance to the sound's root note plus the
+ current pitch-wheel position, and is corrected for the sample-rate of the sound.
+
+ @see SRCSamplerSound, Synthesiser, SamplerVoice
+
+ @tags{Audio}
+ */
+class SRCSamplerVoice  : public SynthesiserVoice
+{
+public:
+    typedef libsamplerate::SRC::ResamplerQuality ResamplerQuality;
+
+    //==============================================================================
+    /** Creates a SRCSamplerVoice.
+
+     @param quality          quality / type of sample rate conversion of libsamplerate
+     @param numChannels      the maximum number of channels the voice renders
+     @param maxChunkSize     the number of samples converted at a time. Larger blocks are
+                             rendered in several chunks, so this only trades memory
+                             for the number of converter calls.
+     */
+    SRCSamplerVoice (ResamplerQuality quality = ResamplerQuality::SRC_SINC_MEDIUM_QUALITY,
+                     int numChannels = 2,
+                     int maxChunkSize = 512);
+
+    /** Destructor. */
+    ~SRCSamplerVoice() override;
+
+    /** Adds a number of voices to a Synthesiser, all allocated up front.
+
+     @see Synthesiser::addVoice
+     */
+    static void addVoicesTo (Synthesiser& synth,
+                             int numVoices,
+                             ResamplerQuality quality = ResamplerQuality::SRC_SINC_MEDIUM_QUALITY,
+                             int numChannels = 2,
+                             int maxChunkSize = 512);
+
+    //==============================================================================
+    /** Sets the range of the pitch-wheel, in semitones either side of its centre. */
+    void setPitchBendRange (double semitones) noexcept      { pitchBendRange = semitones; }
+
+    /** Returns the range of the pitch-wheel, in semitones. */
+    double getPitchBendRange() const noexcept               { return pitchBendRange; }
+
+    //==============================================================================
+    bool canPlaySound (SynthesiserSound*) override;
+
+    void startNote (int midiNoteNumber, float velocity, SynthesiserSound*, int pitchWheel) override;
+    void stopNote (float velocity, bool allowTailOff) override;
+
+    void pitchWheelMoved (int newValue) override;
+    void controllerMoved (int controllerNumber, int newValue) override;
+
+    void renderNextBlock (AudioBuffer<float>&, int startSample, int numSamples) override;
+
+private:
+    //==============================================================================
+    void updateRatio (const SRCSamplerSound&) noexcept;
+    void resetConverters() noexcept;
+
+    const int numChannels;
+    HeapBlock<libsamplerate::SRC_STATE*> resamplers_;
+    HeapBlock<libsamplerate::SRC_DATA> data_;
+    AudioBuffer<float> scratch;
+
+    int64 sourcePosition = 0;
+    int currentNote = 0;
+    double pitchBendSemitones = 0.0, pitchBendRange = 2.0;
+    double samplesInPerOutputSample = 1.0;
+    float noteGain = 0.0f;
+
+    ADSR adsr;
+
+    JUCE_LEAK_DETECTOR (SRCSamplerVoice)
+};
+
+} // namespace juce
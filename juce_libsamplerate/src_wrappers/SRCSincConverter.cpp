@@ -0,0 +1,723 @@
+/*
+ ==============================================================================
+ Copyright (c) 2019, Tal Aviram
+ All rights reserved.
+
+ This code is released under 2-clause BSD license. Please see the
+ file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#include "SRCSincConverter.h"
+
+namespace juce
+{
+
+namespace SRCSincHelpers
+{
+    // libsamplerate's fixed-point filter index
+    enum { shiftBits = 12, fixedOne = 1 << shiftBits, fixedMask = fixedOne - 1 };
+    static const double inverseFixedOne = 1.0 / fixedOne;
+
+    static inline int toFixed (const double x) noexcept             { return (int) lrint (x * fixedOne); }
+    static inline double fractionOf (const int x) noexcept          { return (x & fixedMask) * inverseFixedOne; }
+
+    static inline double fmodOne (const double x) noexcept
+    {
+        const auto result = x - lrint (x);
+        return result < 0.0 ? result + 1.0 : result;
+    }
+
+    // the input copied in at a time: a few filters' worth, so the history moved before each
+    // copy stays small next to it, up to libsamplerate's own minimum buffer
+    static int getChunkSize (const int maxHalfFilterLength) noexcept
+    {
+        return jlimit (256, 4096, 4 * maxHalfFilterLength);
+    }
+
+    // Reads the linearly interpolated half-table, exactly as calc_output() does
+    struct OriginalCoefficients
+    {
+        const float* coeffs;
+
+        double operator() (const int filterIndex) const noexcept
+        {
+            const auto fraction = fractionOf (filterIndex);
+            const auto index = filterIndex >> shiftBits;
+            return coeffs[index] + fraction * (coeffs[index + 1] - coeffs[index]);
+        }
+    };
+
+    // Evaluates the thinned-out half-table with 4-point Lagrange interpolation
+    struct ReducedCoefficients
+    {
+        const float* points;
+        double scale;
+
+        double operator() (const int filterIndex) const noexcept
+        {
+            const auto position = filterIndex * scale;
+            const auto index = (int) position;
+            const auto t = position - index;
+            const auto* p = points + index;
+
+            return p[-1] * (-t * (t - 1.0) * (t - 2.0) / 6.0)
+                 + p[0]  * ((t + 1.0) * (t - 1.0) * (t - 2.0) / 2.0)
+                 + p[1]  * (-(t + 1.0) * t * (t - 2.0) / 2.0)
+                 + p[2]  * ((t + 1.0) * t * (t - 1.0) / 6.0);
+        }
+    };
+
+    // An in-place radix-2 FFT, only used while building a minimum-phase table
+    static void fft (std::complex<double>* data, const int size, const bool inverse) noexcept
+    {
+        for (int i = 1, j = 0; i < size; ++i)
+        {
+            auto bit = size >> 1;
+
+            for (; (j & bit) != 0; bit >>= 1)
+                j ^= bit;
+
+            j ^= bit;
+
+            if (i < j)
+                std::swap (data[i], data[j]);
+        }
+
+        for (auto length = 2; length <= size; length <<= 1)
+        {
+            const auto angle = (inverse ? 2.0 : -2.0) * MathConstants<double>::pi / length;
+            const std::complex<double> step (std::cos (angle), std::sin (angle));
+
+            for (auto start = 0; start < size; start += length)
+            {
+                std::complex<double> w (1.0);
+
+                for (auto k = 0; k < length / 2; ++k)
+                {
+                    const auto even = data[start + k];
+                    const auto odd = data[start + k + length / 2] * w;
+                    data[start + k] = even + odd;
+                    data[start + k + length / 2] = even - odd;
+                    w *= step;
+                }
+            }
+        }
+
+        if (inverse)
+            for (auto i = 0; i < size; ++i)
+                data[i] /= (double) size;
+    }
+
+    // Turns a symmetric filter into the minimum-phase one with the same magnitude response,
+    // by folding its real cepstrum onto the positive times
+    static void makeMinimumPhase (const double* symmetric, double* result, const int length)
+    {
+        // padded well past the filter so the cepstrum doesn't wrap around onto itself
+        const auto size = (int) nextPowerOfTwo (8 * length);
+        std::vector<std::complex<double>> spectrum ((size_t) size);
+
+        for (auto i = 0; i < length; ++i)
+            spectrum[(size_t) i] = symmetric[i];
+
+        fft (spectrum.data(), size, false);
+
+        // the stopband is floored well below the filter's own rejection so its log is finite
+        auto peak = 0.0;
+
+        for (auto& bin : spectrum)
+            peak = jmax (peak, std::abs (bin));
+
+        const auto floor = peak * 1.0e-12;
+
+        for (auto& bin : spectrum)
+            bin = std::log (jmax (floor, std::abs (bin)));
+
+        fft (spectrum.data(), size, true);
+
+        for (auto i = 1; i < size / 2; ++i)
+        {
+            spectrum[(size_t) i] *= 2.0;
+            spectrum[(size_t) (size - i)] = 0.0;
+        }
+
+        fft (spectrum.data(), size, false);
+
+        for (auto& bin : spectrum)
+            bin = std::exp (bin);
+
+        fft (spectrum.data(), size, true);
+
+        for (auto i = 0; i < length; ++i)
+            result[i] = spectrum[(size_t) i].real();
+    }
+
+    // The two halves of calc_output(), with the coefficient fetch swapped out
+    template <typename CoefficientType>
+    static double calcOutput (const float* data, const int current, const int maxFilterIndex,
+                              const int increment, const int startFilterIndex, const CoefficientType& coefficient) noexcept
+    {
+        auto filterIndex = startFilterIndex;
+        auto coeffCount = (maxFilterIndex - filterIndex) / increment;
+        filterIndex += coeffCount * increment;
+        auto dataIndex = current - coeffCount;
+
+        auto left = 0.0;
+
+        do
+        {
+            left += coefficient (filterIndex) * data[dataIndex];
+            filterIndex -= increment;
+            ++dataIndex;
+        }
+        while (filterIndex >= 0);
+
+        filterIndex = increment - startFilterIndex;
+        coeffCount = (maxFilterIndex - filterIndex) / increment;
+        filterIndex += coeffCount * increment;
+        dataIndex = current + 1 + coeffCount;
+
+        auto right = 0.0;
+
+        do
+        {
+            right += coefficient (filterIndex) * data[dataIndex];
+            filterIndex -= increment;
+            --dataIndex;
+        }
+        while (filterIndex > 0);
+
+        return left + right;
+    }
+}
+
+//==============================================================================
+SRCCoefficientTable::SRCCoefficientTable (const ResamplerQuality quality, const Layout layoutToUse)
+    : layout (layoutToUse)
+{
+    int numPoints = 0;
+
+    // the decimations keep at least 150 points per input sample for the reduced layout
+    switch (quality)
+    {
+        case ResamplerQuality::SRC_SINC_BEST_QUALITY:
+            originalCoefficients = libsamplerate::slow_high_qual_coeffs.coeffs;
+            numPoints = numElementsInArray (libsamplerate::slow_high_qual_coeffs.coeffs);
+            increment = libsamplerate::slow_high_qual_coeffs.increment;
+            decimation = 16;
+            break;
+
+        case ResamplerQuality::SRC_SINC_MEDIUM_QUALITY:
+            originalCoefficients = libsamplerate::slow_mid_qual_coeffs.coeffs;
+            numPoints = numElementsInArray (libsamplerate::slow_mid_qual_coeffs.coeffs);
+            increment = libsamplerate::slow_mid_qual_coeffs.increment;
+            decimation = 8;
+            break;
+
+        case ResamplerQuality::SRC_SINC_FASTEST:
+            originalCoefficients = libsamplerate::fastest_coeffs.coeffs;
+            numPoints = numElementsInArray (libsamplerate::fastest_coeffs.coeffs);
+            increment = libsamplerate::fastest_coeffs.increment;
+            decimation = 2;
+            break;
+
+        default:
+            jassertfalse;
+            return;
+    }
+
+    // as in sinc_set_converter()
+    halfLength = numPoints - 2;
+
+    if (layout == exactHalfTable)
+    {
+        // rows 0 ... increment + 1, so the row after any phase exists too
+        rowLength = halfLength / increment + 2;
+        numCoefficients = (size_t) ((increment + 2) * rowLength);
+        coefficients.calloc (numCoefficients);
+
+        for (auto phase = 0; phase < increment + 2; ++phase)
+            for (auto k = 0; k < rowLength && phase + k * increment < numPoints; ++k)
+                coefficients[phase * rowLength + k] = originalCoefficients[phase + k * increment];
+    }
+    else if (layout == reducedTable)
+    {
+        // one point before the centre (mirrored, as the sinc is symmetric) and two after the end
+        const auto numReduced = (numPoints - 1) / decimation + 1;
+        numCoefficients = (size_t) (numReduced + 3);
+        coefficients.calloc (numCoefficients);
+
+        coefficients[0] = originalCoefficients[decimation];
+
+        for (auto i = 0; i < numReduced; ++i)
+            coefficients[1 + i] = originalCoefficients[i * decimation];
+    }
+    else if (layout == minimumPhase)
+    {
+        // the whole filter, both halves of the reduced points, made causal: one point of
+        // silence before it for the interpolation and two after
+        const auto numReduced = (numPoints - 1) / decimation + 1;
+        minimumPhaseLength = 2 * numReduced - 1;
+        numCoefficients = (size_t) (minimumPhaseLength + 3);
+        coefficients.calloc (numCoefficients);
+
+        std::vector<double> symmetric ((size_t) minimumPhaseLength), causal ((size_t) minimumPhaseLength);
+
+        for (auto i = 0; i < minimumPhaseLength; ++i)
+            symmetric[(size_t) i] = originalCoefficients[std::abs (i - (numReduced - 1)) * decimation];
+
+        SRCSincHelpers::makeMinimumPhase (symmetric.data(), causal.data(), minimumPhaseLength);
+
+        auto sum = 0.0, moment = 0.0;
+
+        for (auto i = 0; i < minimumPhaseLength; ++i)
+        {
+            coefficients[1 + i] = (float) causal[(size_t) i];
+            sum += causal[(size_t) i];
+            moment += i * causal[(size_t) i];
+        }
+
+        groupDelay = moment / sum * decimation / increment;
+    }
+    else
+    {
+        decimation = 1;
+        numCoefficients = (size_t) numPoints;
+    }
+}
+
+template <int quality, int layout>
+const SRCCoefficientTable& SRCCoefficientTable::getSharedTable()
+{
+    static const SRCCoefficientTable table ((ResamplerQuality) quality, (Layout) layout);
+    return table;
+}
+
+const SRCCoefficientTable& SRCCoefficientTable::getTable (const ResamplerQuality quality, const Layout layoutToUse)
+{
+    jassert (supportsQuality (quality));
+
+    // only the tables that are asked for get built
+    switch (quality)
+    {
+        case ResamplerQuality::SRC_SINC_BEST_QUALITY:
+            return layoutToUse == original       ? getSharedTable<ResamplerQuality::SRC_SINC_BEST_QUALITY, original>()
+                 : layoutToUse == exactHalfTable ? getSharedTable<ResamplerQuality::SRC_SINC_BEST_QUALITY, exactHalfTable>()
+                 : layoutToUse == reducedTable   ? getSharedTable<ResamplerQuality::SRC_SINC_BEST_QUALITY, reducedTable>()
+                                                 : getSharedTable<ResamplerQuality::SRC_SINC_BEST_QUALITY, minimumPhase>();
+
+        case ResamplerQuality::SRC_SINC_MEDIUM_QUALITY:
+            return layoutToUse == original       ? getSharedTable<ResamplerQuality::SRC_SINC_MEDIUM_QUALITY, original>()
+                 : layoutToUse == exactHalfTable ? getSharedTable<ResamplerQuality::SRC_SINC_MEDIUM_QUALITY, exactHalfTable>()
+                 : layoutToUse == reducedTable   ? getSharedTable<ResamplerQuality::SRC_SINC_MEDIUM_QUALITY, reducedTable>()
+                                                 : getSharedTable<ResamplerQuality::SRC_SINC_MEDIUM_QUALITY, minimumPhase>();
+
+        case ResamplerQuality::SRC_SINC_FASTEST:
+        default:
+            return layoutToUse == original       ? getSharedTable<ResamplerQuality::SRC_SINC_FASTEST, original>()
+                 : layoutToUse == exactHalfTable ? getSharedTable<ResamplerQuality::SRC_SINC_FASTEST, exactHalfTable>()
+                 : layoutToUse == reducedTable   ? getSharedTable<ResamplerQuality::SRC_SINC_FASTEST, reducedTable>()
+                                                 : getSharedTable<ResamplerQuality::SRC_SINC_FASTEST, minimumPhase>();
+    }
+}
+
+bool SRCCoefficientTable::supportsQuality (const ResamplerQuality quality) noexcept
+{
+    return quality == ResamplerQuality::SRC_SINC_BEST_QUALITY
+        || quality == ResamplerQuality::SRC_SINC_MEDIUM_QUALITY
+        || quality == ResamplerQuality::SRC_SINC_FASTEST;
+}
+
+size_t SRCCoefficientTable::getSizeInBytes() const noexcept
+{
+    return numCoefficients * sizeof (float);
+}
+
+//==============================================================================
+SRCSincConverter::SRCSincConverter (const SRCCoefficientTable& tableToUse, const int channels,
+                                    const double maxSamplesInPerOutputSample)
+    : table (tableToUse),
+      numChannels (channels),
+      maxRatio (jlimit (1.0 / SRC_MAX_RATIO, (double) SRC_MAX_RATIO, maxSamplesInPerOutputSample)),
+      isMinimumPhase (table.getLayout() == SRCCoefficientTable::minimumPhase),
+      maxHalfFilterLength (getHalfFilterLength (1.0 / maxRatio)),
+      capacity (2 * maxHalfFilterLength + SRCSincHelpers::getChunkSize (maxHalfFilterLength)),
+      historyLength (isMinimumPhase ? 2 * maxHalfFilterLength : maxHalfFilterLength)
+{
+    jassert (numChannels > 0 && maxSamplesInPerOutputSample > 0);
+
+    buffer.calloc ((size_t) (numChannels * capacity));
+    reset();
+}
+
+SRCSincConverter::~SRCSincConverter()
+{
+}
+
+size_t SRCSincConverter::getSizeInBytes() const noexcept
+{
+    return sizeof (*this) + sizeof (float) * (size_t) (numChannels * capacity);
+}
+
+double SRCSincConverter::getLatency (const double samplesInPerOutputSample) const noexcept
+{
+    const auto srcRatio = 1.0 / jmin (samplesInPerOutputSample, maxRatio);
+    return isMinimumPhase ? getDelay (srcRatio) : (double) getHalfFilterLength (srcRatio);
+}
+
+double SRCSincConverter::getDelay (const double srcRatio) const noexcept
+{
+    // the filter is stretched over more input when downsampling
+    return isMinimumPhase ? table.getGroupDelay() / jlimit (1.0 / SRC_MAX_RATIO, 1.0, srcRatio) : 0.0;
+}
+
+void SRCSincConverter::setResamplingRatio (const double samplesInPerOutputSample) noexcept
+{
+    jassert (samplesInPerOutputSample > 0 && samplesInPerOutputSample <= maxRatio);
+    lastRatio = 1.0 / jmin (samplesInPerOutputSample, maxRatio);
+}
+
+void SRCSincConverter::reset() noexcept
+{
+    // like libsamplerate, start with a filter's reach of silence before the first input
+    FloatVectorOperations::clear (buffer, numChannels * capacity);
+    current = buffered = historyLength;
+    inputIndex = 0.0;
+    passThrough = passThroughTarget = 0.0f;
+    passThroughRampRemaining = 0;
+}
+
+void SRCSincConverter::setPassThrough (const float amount, const int numOutputFramesToRamp) noexcept
+{
+    jassert (amount >= 0.0f && amount <= 1.0f);
+
+    passThroughTarget = amount;
+    passThroughRampRemaining = jmax (0, numOutputFramesToRamp);
+
+    if (passThroughRampRemaining > 0)
+        passThroughStep = (amount - passThrough) / (float) passThroughRampRemaining;
+    else
+        passThrough = amount;
+}
+
+float SRCSincConverter::getNextPassThrough() noexcept
+{
+    const auto amount = passThrough;
+
+    if (passThroughRampRemaining > 0)
+        passThrough = --passThroughRampRemaining > 0 ? passThrough + passThroughStep : passThroughTarget;
+
+    return amount;
+}
+
+int SRCSincConverter::takeHeldInput (float* const* destination, const int numFrames) noexcept
+{
+    // the next output plays the nearest frame, so the phase is rounded to it
+    const auto delay = getDelay (lastRatio);
+    current += (int) std::floor (inputIndex - delay + 0.5);
+    inputIndex = 0.0;
+
+    const auto numToCopy = jlimit (0, jmax (0, buffered - current), numFrames);
+
+    for (auto channel = 0; channel < numChannels; ++channel)
+        FloatVectorOperations::copy (destination[channel], buffer + channel * capacity + current, numToCopy);
+
+    current += numToCopy;
+    skipDelay (delay);
+    return numToCopy;
+}
+
+void SRCSincConverter::primeHistory (const float* const* source, const int numFrames) noexcept
+{
+    reset();
+
+    // the history ends just before the first frame the next call will take
+    const auto numToCopy = jmin (numFrames, historyLength);
+
+    for (auto channel = 0; channel < numChannels; ++channel)
+        FloatVectorOperations::copy (buffer + channel * capacity + current - numToCopy, source[channel] + numFrames - numToCopy, numToCopy);
+
+    skipDelay (getDelay (lastRatio));
+}
+
+void SRCSincConverter::skipDelay (const double delay) noexcept
+{
+    // a minimum-phase output plays the input from its delay ago, so to carry on from the
+    // frames that were passed through, the converter starts that far ahead of them; the
+    // frames in between are taken from the next call before any output is made
+    const auto wholeFrames = (int) delay;
+    current += wholeFrames;
+    inputIndex = delay - wholeFrames;
+}
+
+int SRCSincConverter::getHalfFilterLength (const double srcRatio) const noexcept
+{
+    // as in sinc_mono_vari_process()
+    auto count = (table.getHalfLength() + 2.0) / table.getIncrement();
+
+    if (srcRatio < 1.0)
+        count /= srcRatio;
+
+    return (int) lrint (count) + 1;
+}
+
+void SRCSincConverter::keepHistory() noexcept
+{
+    const auto shift = current - historyLength;
+
+    if (shift <= 0)
+        return;
+
+    for (auto channel = 0; channel < numChannels; ++channel)
+    {
+        auto* data = buffer + channel * capacity;
+        std::memmove (data, data + shift, sizeof (float) * (size_t) (buffered - shift));
+    }
+
+    current -= shift;
+    buffered -= shift;
+}
+
+double SRCSincConverter::calcOutput (const float* data, const int increment, const int startFilterIndex) const noexcept
+{
+    using namespace SRCSincHelpers;
+
+    const auto maxFilterIndex = table.getHalfLength() << shiftBits;
+
+    if (table.getLayout() == SRCCoefficientTable::reducedTable)
+    {
+        const ReducedCoefficients coefficient { table.getReducedCoefficients(), inverseFixedOne / table.getDecimation() };
+        return SRCSincHelpers::calcOutput (data, current, maxFilterIndex, increment, startFilterIndex, coefficient);
+    }
+
+    const OriginalCoefficients coefficient { table.getOriginalCoefficients() };
+    return SRCSincHelpers::calcOutput (data, current, maxFilterIndex, increment, startFilterIndex, coefficient);
+}
+
+double SRCSincConverter::calcOutputMinimumPhase (const float* data, const double step, const double start) const noexcept
+{
+    // The filter is causal: its taps run back from the current frame, none ahead of it. The
+    // positions count points of the thinned-out table, evaluated as the reduced layout is.
+    const auto* points = table.getMinimumPhaseCoefficients();
+    const auto end = (double) (table.getMinimumPhaseLength() - 1);
+    const auto* in = data + current;
+
+    auto sum = 0.0;
+
+    for (auto position = start; position < end; position += step)
+    {
+        const auto index = (int) position;
+        const auto t = position - index;
+        const auto* p = points + index;
+
+        const auto coefficient = p[-1] * (-t * (t - 1.0) * (t - 2.0) / 6.0)
+                               + p[0]  * ((t + 1.0) * (t - 1.0) * (t - 2.0) / 2.0)
+                               + p[1]  * (-(t + 1.0) * t * (t - 2.0) / 2.0)
+                               + p[2]  * ((t + 1.0) * t * (t - 1.0) / 6.0);
+
+        sum += coefficient * *in--;
+    }
+
+    return sum;
+}
+
+double SRCSincConverter::calcOutputExactRows (const float* data, const int startFilterIndex) const noexcept
+{
+    using namespace SRCSincHelpers;
+
+    // With an increment of a whole number of points, every tap of a half sits on the same
+    // phase, so its coefficients are one contiguous row and the fraction is constant.
+    const auto increment = table.getIncrement() << shiftBits;
+    const auto maxFilterIndex = table.getHalfLength() << shiftBits;
+
+    auto coeffCount = (maxFilterIndex - startFilterIndex) / increment;
+    auto fraction = fractionOf (startFilterIndex);
+    auto phase = startFilterIndex >> shiftBits;
+    const float* c0 = table.getRow (phase);
+    const float* c1 = table.getRow (phase + 1);
+    const float* in = data + current - coeffCount;
+
+    auto left = 0.0;
+
+    for (auto k = coeffCount; k >= 0; --k)
+        left += (c0[k] + fraction * (c1[k] - c0[k])) * *in++;
+
+    const auto rightStart = increment - startFilterIndex;
+    coeffCount = (maxFilterIndex - rightStart) / increment;
+    fraction = fractionOf (rightStart);
+    phase = rightStart >> shiftBits;
+    c0 = table.getRow (phase);
+    c1 = table.getRow (phase + 1);
+    in = data + current + 1 + coeffCount;
+
+    auto right = 0.0;
+    const auto lastK = rightStart > 0 ? 0 : 1;
+
+    for (auto k = coeffCount; k >= lastK; --k)
+        right += (c0[k] + fraction * (c1[k] - c0[k])) * *in--;
+
+    return left + right;
+}
+
+//==============================================================================
+int SRCSincConverter::process (const float* const* input, const int numInputFrames,
+                               float* const* output, const int numOutputFrames,
+                               const double samplesInPerOutputSample, int& inputFramesUsed) noexcept
+{
+    using namespace SRCSincHelpers;
+
+    // the history only holds the filter of the largest ratio the converter was sized for
+    jassert (samplesInPerOutputSample > 0 && samplesInPerOutputSample <= maxRatio);
+
+    const auto targetRatio = 1.0 / jmin (samplesInPerOutputSample, maxRatio);
+
+    if (lastRatio < 1.0 / SRC_MAX_RATIO)
+        lastRatio = targetRatio;
+
+    // a causal filter only needs the frame an output falls after
+    const auto lookahead = isMinimumPhase ? 0 : getHalfFilterLength (jmin (lastRatio, targetRatio));
+    const auto tableIncrement = table.getIncrement();
+    const auto useRows = table.getLayout() == SRCCoefficientTable::exactHalfTable;
+
+    auto srcRatio = lastRatio;
+    auto used = 0, generated = 0;
+
+    while (generated < numOutputFrames)
+    {
+        if (buffered - current <= lookahead)
+        {
+            keepHistory();
+
+            const auto numToCopy = jmin (numInputFrames - used, capacity - buffered);
+
+            if (numToCopy <= 0)
+                break;
+
+            for (auto channel = 0; channel < numChannels; ++channel)
+                FloatVectorOperations::copy (buffer + channel * capacity + buffered, input[channel] + used, numToCopy);
+
+            buffered += numToCopy;
+            used += numToCopy;
+            continue;
+        }
+
+        if (std::abs (lastRatio - targetRatio) > 1e-10)
+            srcRatio = lastRatio + generated * (targetRatio - lastRatio) / numOutputFrames;
+
+        const auto floatIncrement = tableIncrement * (srcRatio < 1.0 ? srcRatio : 1.0);
+        const auto increment = toFixed (floatIncrement);
+        const auto startFilterIndex = toFixed (inputIndex * floatIncrement);
+        const auto scale = floatIncrement / tableIncrement;
+
+        // an index that rounds up to a whole increment adds a tap to the left half, which
+        // doesn't fit in a row, so that rare case takes the general path
+        const auto rowsFit = useRows && srcRatio >= 1.0 && startFilterIndex < increment;
+
+        const auto passThroughAmount = getNextPassThrough();
+        const auto nearestFrame = current + (int) std::floor (inputIndex - getDelay (srcRatio) + 0.5);
+
+        // the minimum-phase table is thinned out, so its positions are in its own points
+        const auto minimumPhaseStep = floatIncrement / table.getDecimation();
+
+        for (auto channel = 0; channel < numChannels; ++channel)
+        {
+            const auto* data = buffer + channel * capacity;
+            const auto sum = isMinimumPhase ? calcOutputMinimumPhase (data, minimumPhaseStep, inputIndex * minimumPhaseStep)
+                           : rowsFit        ? calcOutputExactRows (data, startFilterIndex)
+                                            : calcOutput (data, increment, startFilterIndex);
+            auto sample = (float) (scale * sum);
+
+            if (passThroughAmount > 0.0f)
+                sample += passThroughAmount * (data[nearestFrame] - sample);
+
+            output[channel][generated] = sample;
+        }
+
+        ++generated;
+
+        inputIndex += 1.0 / srcRatio;
+        const auto rem = fmodOne (inputIndex);
+        current += (int) lrint (inputIndex - rem);
+        inputIndex = rem;
+    }
+
+    lastRatio = srcRatio;
+    inputFramesUsed = used;
+
+    return generated;
+}
+
+//==============================================================================
+double SRCSincConverter::measureDeviation (const ResamplerQuality quality, const SRCCoefficientTable::Layout layout,
+                                           const double samplesInPerOutputSample, const int numInputFrames)
+{
+    jassert (samplesInPerOutputSample > 0 && numInputFrames > 0);
+
+    // a fixed mix of tones and noise, so the results are repeatable
+    HeapBlock<float> input ((size_t) numInputFrames);
+    Random random (0x5eed);
+
+    for (auto i = 0; i < numInputFrames; ++i)
+        input[i] = 0.4f * (float) std::sin (0.031 * i) + 0.3f * (float) std::sin (1.7 * i + 0.5)
+                     + 0.2f * (random.nextFloat() * 2.0f - 1.0f);
+
+    const auto maxOutputFrames = (int) (numInputFrames / samplesInPerOutputSample) + 64;
+    HeapBlock<float> expected ((size_t) maxOutputFrames, true), actual ((size_t) maxOutputFrames, true);
+    const auto blockSize = 512;
+
+    int src_error = 0;
+    auto* state = libsamplerate::src_new (quality, 1, &src_error);
+    jassert (state != nullptr);
+
+    auto numExpected = 0;
+
+    for (auto numRead = 0;;)
+    {
+        libsamplerate::SRC_DATA data;
+        zerostruct (data);
+        data.data_in = input + numRead;
+        data.input_frames = jmin (blockSize, numInputFrames - numRead);
+        data.data_out = expected + numExpected;
+        data.output_frames = jmin (blockSize, maxOutputFrames - numExpected);
+        data.src_ratio = 1.0 / samplesInPerOutputSample;
+
+        if (libsamplerate::src_process (state, &data) != 0 || (data.input_frames_used == 0 && data.output_frames_gen == 0))
+            break;
+
+        numRead += (int) data.input_frames_used;
+        numExpected += (int) data.output_frames_gen;
+    }
+
+    libsamplerate::src_delete (state);
+
+    SRCSincConverter converter (SRCCoefficientTable::getTable (quality, layout), 1);
+    auto numActual = 0;
+
+    for (auto numRead = 0;;)
+    {
+        const float* in = input + numRead;
+        float* out = actual + numActual;
+        auto used = 0;
+        const auto generated = converter.process (&in, jmin (blockSize, numInputFrames - numRead),
+                                                  &out, jmin (blockSize, maxOutputFrames - numActual),
+                                                  samplesInPerOutputSample, used);
+
+        if (used == 0 && generated == 0)
+            break;
+
+        numRead += used;
+        numActual += generated;
+    }
+
+    // a minimum-phase output is late by its delay, in output frames
+    const auto offset = roundToInt (converter.getLatency (samplesInPerOutputSample) / samplesInPerOutputSample);
+    const auto delay = layout == SRCCoefficientTable::minimumPhase ? offset : 0;
+    auto deviation = 0.0;
+
+    for (auto i = 0; i < jmin (numExpected, numActual - delay); ++i)
+        deviation = jmax (deviation, (double) std::abs (expected[i] - actual[i + delay]));
+
+    return deviation;
+}
+
+} // namespace juce
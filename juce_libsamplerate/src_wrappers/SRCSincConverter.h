@@ -0,0 +1,271 @@
+/*
+ ==============================================================================
+    Copyright (c) 2019, Tal Aviram
+    All rights reserved.
+
+    This code is released under 2-clause BSD license. Please see the
+    file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#pragma once
+
+namespace juce
+{
+
+//==============================================================================
+/**
+ One of libsamplerate's sinc coefficient tables, rearranged to be cheaper on the cache.
+
+ libsamplerate stores the right half of each windowed sinc oversampled by getIncrement()
+ points per input sample, and each output reads it at a stride of getIncrement(), so every
+ tap touches a different cache line of a table of up to 1.3MB (SRC_SINC_BEST_QUALITY).
+ The layouts are:
+
+ - original: libsamplerate's table, read in place.
+ - exactHalfTable: the same half-table stored phase-major, one row of taps per
+   oversampled phase. When upsampling the taps of an output all come from two adjacent
+   rows, so they are read contiguously. The output is bit-identical to libsamplerate.
+ - reducedTable: only every getDecimation()-th point of the half-table, evaluated with
+   4-point Lagrange interpolation instead of linear interpolation. The tables shrink to
+   about 85KB (best), 11KB (medium) and 5KB (fastest), which stay in L2 even with many
+   streams; use SRCSincConverter::measureDeviation() to check the cost for a given ratio.
+ - minimumPhase: the minimum-phase filter with the same magnitude response, thinned out
+   and interpolated as the reduced table is. The filter is causal, so an output needs no
+   input beyond its own position: instead of holding back half a filter of input
+   (46 samples for medium, 143 for best), the output is delayed by getGroupDelay()
+   (a few samples), which suits live monitoring and drift correction. The phase
+   response is no longer linear, so transients smear slightly in time.
+
+ Tables are built once, on first use, and shared. Building a minimum-phase table takes a
+ few FFTs of its size, so it's best asked for before playback starts.
+
+ @see SRCSincConverter
+
+ @tags{Audio}
+ */
+class SRCCoefficientTable
+{
+public:
+    typedef libsamplerate::SRC::ResamplerQuality ResamplerQuality;
+
+    enum Layout
+    {
+        original,
+        exactHalfTable,
+        reducedTable,
+        minimumPhase
+    };
+
+    /** Returns the shared table for one of the sinc qualities. */
+    static const SRCCoefficientTable& getTable (ResamplerQuality quality, Layout layout);
+
+    /** Returns true for the qualities that have coefficient tables. */
+    static bool supportsQuality (ResamplerQuality quality) noexcept;
+
+    //==============================================================================
+    Layout getLayout() const noexcept                       { return layout; }
+
+    /** Returns the number of half-table points per input sample, as in libsamplerate. */
+    int getIncrement() const noexcept                       { return increment; }
+
+    /** Returns the index of the last point a filter reaches, as in libsamplerate. */
+    int getHalfLength() const noexcept                      { return halfLength; }
+
+    /** Returns the factor the reduced and minimum-phase tables are thinned out by, 1 for
+        the other layouts. */
+    int getDecimation() const noexcept                      { return decimation; }
+
+    /** Returns the delay of the minimum-phase filter at DC, in input samples when
+        upsampling, or 0 for the linear-phase layouts. */
+    double getGroupDelay() const noexcept                   { return groupDelay; }
+
+    /** Returns the number of bytes the coefficients of this layout occupy. */
+    size_t getSizeInBytes() const noexcept;
+
+    //==============================================================================
+    /** Returns the original half-table, for the original layout and for the strided reads
+        of the exact layout when downsampling. */
+    const float* getOriginalCoefficients() const noexcept   { return originalCoefficients; }
+
+    /** Returns the taps of one phase of the exact layout: getRow (p)[k] is point p + k * increment. */
+    const float* getRow (int phase) const noexcept          { return coefficients + phase * rowLength; }
+
+    /** Returns the points of the reduced layout, with one leading point of padding. */
+    const float* getReducedCoefficients() const noexcept    { return coefficients + 1; }
+
+    /** Returns the points of the minimum-phase filter, with one leading point of padding. */
+    const float* getMinimumPhaseCoefficients() const noexcept   { return coefficients + 1; }
+
+    /** Returns the number of points of the minimum-phase filter, not counting the padding. */
+    int getMinimumPhaseLength() const noexcept              { return minimumPhaseLength; }
+
+private:
+    SRCCoefficientTable (ResamplerQuality quality, Layout layout);
+
+    template <int quality, int layout>
+    static const SRCCoefficientTable& getSharedTable();
+
+    const Layout layout;
+    const float* originalCoefficients = nullptr;
+    int increment = 0, halfLength = 0, decimation = 1, rowLength = 0, minimumPhaseLength = 0;
+    double groupDelay = 0.0;
+    HeapBlock<float> coefficients;
+    size_t numCoefficients = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SRCCoefficientTable)
+};
+
+//==============================================================================
+/**
+ A streaming port of libsamplerate's sinc converter that reads its coefficients from a
+ SRCCoefficientTable.
+
+ The arithmetic follows libsamplerate's calc_output() step for step (fixed-point filter
+ index, double accumulation, the same ratio ramp), so with the original or exactHalfTable
+ layout the output matches src_process() exactly.
+
+ The calling convention is the one of SRCFastInterpolator: every call consumes as much of
+ the given input as it can and reports it in inputFramesUsed. Like libsamplerate, output
+ is held back until half a filter's length of input beyond it has arrived. With the
+ minimumPhase layout nothing is held back, and the output is delayed by the filter
+ instead; getLatency() returns either.
+
+ @see SRCCoefficientTable, SRCAudioSource
+
+ @tags{Audio}
+ */
+class SRCSincConverter
+{
+public:
+    typedef libsamplerate::SRC::ResamplerQuality ResamplerQuality;
+
+    //==============================================================================
+    /** Creates a converter.
+
+     The history buffer is sized for the widest filter the converter will need, which
+     widens with the downsampling ratio. The default covers every ratio libsamplerate
+     accepts, which takes about 110KB per channel for SRC_SINC_MEDIUM_QUALITY and 300KB
+     for SRC_SINC_BEST_QUALITY; a converter that only ever corrects drift, or only runs at
+     a fixed ratio, can declare that and take a few kilobytes instead.
+
+     @param table                        the coefficients to use
+     @param numChannels                  the number of channels to process
+     @param maxSamplesInPerOutputSample  the largest ratio process() will be given, up to
+                                         libsamplerate's limit of 256. Larger ratios are
+                                         converted as this one
+     */
+    SRCSincConverter (const SRCCoefficientTable& table, int numChannels,
+                      double maxSamplesInPerOutputSample = 256.0);
+
+    /** Destructor. */
+    ~SRCSincConverter();
+
+    /** Returns the coefficients the converter reads. */
+    const SRCCoefficientTable& getTable() const noexcept    { return table; }
+
+    /** Returns the largest ratio the converter was sized for. */
+    double getMaxResamplingRatio() const noexcept           { return maxRatio; }
+
+    /** Returns the number of bytes this converter uses, not counting the shared table. */
+    size_t getSizeInBytes() const noexcept;
+
+    /** Returns how long after an input frame arrives the output that plays it can be made,
+        in input frames, at a given ratio.
+
+        For the linear-phase layouts this is the half filter of input held back; their
+        output isn't delayed. For minimumPhase nothing is held back, and this is how late
+        the output plays the input, the table's group delay widened by any downsampling.
+     */
+    double getLatency (double samplesInPerOutputSample) const noexcept;
+
+    //==============================================================================
+    /** Changes the ratio immediately, without ramping from the previous one. */
+    void setResamplingRatio (double samplesInPerOutputSample) noexcept;
+
+    /** Clears the history, phase and pass-through. */
+    void reset() noexcept;
+
+    /** Converts a block.
+
+     The ratio ramps linearly from the one of the previous call (or the one given to
+     setResamplingRatio()) towards samplesInPerOutputSample across numOutputFrames.
+
+     @param input                    one pointer per channel
+     @param numInputFrames           the number of frames available in input
+     @param output                   one pointer per channel
+     @param numOutputFrames          the space available in output
+     @param samplesInPerOutputSample the ratio to reach at the end of the block
+     @param inputFramesUsed          receives the number of input frames consumed
+     @returns the number of output frames generated
+     */
+    int process (const float* const* input, int numInputFrames,
+                 float* const* output, int numOutputFrames,
+                 double samplesInPerOutputSample, int& inputFramesUsed) noexcept;
+
+    //==============================================================================
+    /** Mixes each output with the input frame nearest to its position, less the delay of
+        a minimumPhase filter, ramping linearly to the given amount over the next outputs.
+
+        At a ratio of exactly 1.0 and an amount of 1, the output is the input itself, which
+        lets SRCAudioSource crossfade between converting and passing the input through.
+     */
+    void setPassThrough (float amount, int numOutputFramesToRamp) noexcept;
+
+    /** Returns true once the pass-through has ramped all the way to 1. */
+    bool isPassingThrough() const noexcept                  { return passThrough >= 1.0f && passThroughRampRemaining == 0; }
+
+    /** Copies out up to numFrames of the input frames taken but not yet played, starting
+        with the one nearest to the next output's position, and returns how many were
+        copied. The converter moves past them, as if it had passed them through.
+     */
+    int takeHeldInput (float* const* destination, int numFrames) noexcept;
+
+    /** Clears the converter and fills its history with the last of the numFrames frames
+        given, so it carries on from audio that was passed through instead of from silence.
+     */
+    void primeHistory (const float* const* source, int numFrames) noexcept;
+
+    //==============================================================================
+    /** Runs a test signal through libsamplerate and through a converter using the given
+        layout, and returns the largest difference between their outputs.
+
+        A minimumPhase converter is compared after its output is moved back by the whole
+        samples of its delay, so what's left is the difference in phase and the fraction
+        of a sample.
+
+        This allocates and takes a while, so call it from a test or at start-up, not on
+        the audio thread.
+     */
+    static double measureDeviation (ResamplerQuality quality, SRCCoefficientTable::Layout layout,
+                                    double samplesInPerOutputSample, int numInputFrames = 32768);
+
+private:
+    //==============================================================================
+    int getHalfFilterLength (double srcRatio) const noexcept;
+    double getDelay (double srcRatio) const noexcept;
+    float getNextPassThrough() noexcept;
+    void keepHistory() noexcept;
+    void skipDelay (double delay) noexcept;
+    double calcOutput (const float* data, int increment, int startFilterIndex) const noexcept;
+    double calcOutputExactRows (const float* data, int startFilterIndex) const noexcept;
+    double calcOutputMinimumPhase (const float* data, double step, double start) const noexcept;
+
+    const SRCCoefficientTable& table;
+    const int numChannels;
+    const double maxRatio;
+    const bool isMinimumPhase;
+    const int maxHalfFilterLength, capacity;
+    const int historyLength; // a causal filter reaches back over its whole length
+
+    HeapBlock<float> buffer;
+    int current = 0, buffered = 0;
+    double inputIndex = 0.0, lastRatio = 0.0;
+
+    float passThrough = 0.0f, passThroughTarget = 0.0f, passThroughStep = 0.0f;
+    int passThroughRampRemaining = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SRCSincConverter)
+};
+
+} // namespace juce
@@ -0,0 +1,339 @@
+/*
+ ==============================================================================
+ Copyright (c) 2019, Tal Aviram
+ All rights reserved.
+
+ This code is released under 2-clause BSD license. Please see the
+ file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#include "SRCTrace.h"
+
+namespace juce
+{
+
+namespace SRCTraceHelpers
+{
+    /** Single producer (the thread it belongs to), single consumer (whoever collects). */
+    struct ThreadRing
+    {
+        enum { capacity = 4096 };
+
+        enum State
+        {
+            free,
+            claiming,   // a thread is taking it, and writing its name
+            inUse,
+            retired     // its thread has exited, and it's freed once it's been drained
+        };
+
+        bool push (const SRCTrace::Event& event) noexcept
+        {
+            const auto write = writeIndex.load (std::memory_order_relaxed);
+
+            if (write - readIndex.load (std::memory_order_acquire) >= (uint32) capacity)
+                return false;
+
+            events[write & (capacity - 1)] = event;
+            writeIndex.store (write + 1, std::memory_order_release);
+            return true;
+        }
+
+        int popAll (Array<SRCTrace::Event>& dest)
+        {
+            const auto read = readIndex.load (std::memory_order_relaxed);
+            const auto write = writeIndex.load (std::memory_order_acquire);
+
+            for (auto i = read; i != write; ++i)
+                dest.add (events[i & (capacity - 1)]);
+
+            readIndex.store (write, std::memory_order_release);
+            return (int) (write - read);
+        }
+
+        bool isEmpty() const noexcept
+        {
+            return readIndex.load (std::memory_order_acquire) == writeIndex.load (std::memory_order_acquire);
+        }
+
+        SRCTrace::Event events[capacity];
+        std::atomic<uint32> writeIndex { 0 }, readIndex { 0 };
+        std::atomic<int> state { free };
+        uint32 threadIndex = 0;
+        String threadName;
+    };
+
+    struct Registry
+    {
+        enum { maxRings = 64 };
+
+        ~Registry()
+        {
+            for (auto i = 0; i < numRings; ++i)
+                delete rings[i];
+        }
+
+        // held while rings are added or freed, never by a thread recording a span
+        CriticalSection lock;
+
+        // slots below numRings are never changed, so they can be read without the lock
+        ThreadRing* rings[maxRings] = {};
+        std::atomic<int> numRings { 0 };
+
+        std::atomic<int64> numDropped { 0 };
+        std::atomic<uint32> nextStreamId { 1 }, nextThreadIndex { 0 };
+    };
+
+    static Registry& getRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    /** Hands the thread's ring back when the thread exits. */
+    struct RingOwner
+    {
+        ~RingOwner()
+        {
+            if (ring != nullptr)
+                ring->state.store (ThreadRing::retired, std::memory_order_release);
+        }
+
+        ThreadRing* ring = nullptr;
+    };
+
+    // takes a ring that reserveThreadRings() set aside, without allocating or locking
+    static ThreadRing* claimRing() noexcept
+    {
+        auto& registry = getRegistry();
+        const auto numRings = registry.numRings.load (std::memory_order_acquire);
+
+        for (auto i = 0; i < numRings; ++i)
+        {
+            auto* ring = registry.rings[i];
+            auto expected = (int) ThreadRing::free;
+
+            if (ring->state.compare_exchange_strong (expected, (int) ThreadRing::claiming))
+            {
+                ring->threadIndex = registry.nextThreadIndex++;
+
+                if (auto* thread = Thread::getCurrentThread())
+                    ring->threadName = thread->getThreadName();
+
+                ring->state.store (ThreadRing::inUse, std::memory_order_release);
+                return ring;
+            }
+        }
+
+        return nullptr;
+    }
+
+    static ThreadRing* getRingForThisThread() noexcept
+    {
+        static thread_local RingOwner owner;
+
+        if (owner.ring == nullptr)
+            owner.ring = claimRing();
+
+        return owner.ring;
+    }
+
+    static String escape (const String& text)
+    {
+        return text.replace ("\\", "\\\\").replace ("\"", "\\\"");
+    }
+
+    static String toMicroseconds (int64 ticks)
+    {
+        return String (Time::highResolutionTicksToSeconds (ticks) * 1.0e6, 3);
+    }
+}
+
+//==============================================================================
+SRCTrace::ScopedSpan::ScopedSpan (const char* name, const uint32 streamId) noexcept
+{
+    event.name = name;
+    event.streamId = streamId;
+    event.threadIndex = 0;
+    event.framesIn = event.framesOut = 0;
+    event.ratio = 0.0;
+    event.durationTicks = 0;
+    event.startTicks = Time::getHighResolutionTicks();
+}
+
+SRCTrace::ScopedSpan::~ScopedSpan()
+{
+    event.durationTicks = Time::getHighResolutionTicks() - event.startTicks;
+    SRCTrace::record (event);
+}
+
+void SRCTrace::ScopedSpan::setFrames (const int framesIn, const int framesOut, const double ratio) noexcept
+{
+    event.framesIn = framesIn;
+    event.framesOut = framesOut;
+    event.ratio = ratio;
+}
+
+//==============================================================================
+uint32 SRCTrace::createStreamId() noexcept
+{
+    return SRCTraceHelpers::getRegistry().nextStreamId++;
+}
+
+void SRCTrace::reserveThreadRings (const int numThreads)
+{
+    using namespace SRCTraceHelpers;
+
+    auto& registry = getRegistry();
+    const ScopedLock sl (registry.lock);
+
+    const auto numRings = registry.numRings.load();
+    auto numFree = 0;
+
+    for (auto i = 0; i < numRings; ++i)
+        if (registry.rings[i]->state.load() == ThreadRing::free)
+            ++numFree;
+
+    // past the limit, the spans of threads without a ring are dropped and counted
+    for (auto i = numRings; numFree < numThreads && i < (int) Registry::maxRings; ++i, ++numFree)
+    {
+        registry.rings[i] = new ThreadRing();
+        registry.numRings.store (i + 1, std::memory_order_release);
+    }
+}
+
+void SRCTrace::record (const Event& event) noexcept
+{
+    auto* ring = SRCTraceHelpers::getRingForThisThread();
+
+    auto copy = event;
+    copy.threadIndex = ring != nullptr ? ring->threadIndex : 0;
+
+    if (ring == nullptr || ! ring->push (copy))
+        ++SRCTraceHelpers::getRegistry().numDropped;
+}
+
+int SRCTrace::collect (Array<Event>& dest)
+{
+    using namespace SRCTraceHelpers;
+
+    auto& registry = getRegistry();
+    const auto numRings = registry.numRings.load (std::memory_order_acquire);
+    auto numCollected = 0;
+
+    for (auto i = 0; i < numRings; ++i)
+    {
+        auto* ring = registry.rings[i];
+
+        // the ring of a thread that exited is freed once a previous call has collected its
+        // last spans, so the thread can still be named while they're written
+        if (ring->state.load (std::memory_order_acquire) == ThreadRing::retired && ring->isEmpty())
+        {
+            const ScopedLock sl (registry.lock);
+            ring->threadName = {};
+            ring->state.store (ThreadRing::free, std::memory_order_release);
+        }
+
+        numCollected += ring->popAll (dest);
+    }
+
+    return numCollected;
+}
+
+int64 SRCTrace::getNumDropped() noexcept
+{
+    return SRCTraceHelpers::getRegistry().numDropped;
+}
+
+String SRCTrace::getThreadName (const uint32 threadIndex)
+{
+    using namespace SRCTraceHelpers;
+
+    auto& registry = getRegistry();
+    const ScopedLock sl (registry.lock);
+
+    for (auto i = 0; i < registry.numRings.load(); ++i)
+    {
+        auto* ring = registry.rings[i];
+        const auto state = ring->state.load (std::memory_order_acquire);
+
+        if ((state == ThreadRing::inUse || state == ThreadRing::retired)
+             && ring->threadIndex == threadIndex && ring->threadName.isNotEmpty())
+            return ring->threadName;
+    }
+
+    return "thread " + String (threadIndex);
+}
+
+void SRCTrace::writeChromeEvents (const Array<Event>& events, OutputStream& out)
+{
+    for (auto& event : events)
+    {
+        out << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << String (event.threadIndex)
+            << ",\"ts\":" << SRCTraceHelpers::toMicroseconds (event.startTicks)
+            << ",\"dur\":" << SRCTraceHelpers::toMicroseconds (event.durationTicks)
+            << ",\"args\":{\"stream\":" << String (event.streamId)
+            << ",\"framesIn\":" << String (event.framesIn)
+            << ",\"framesOut\":" << String (event.framesOut)
+            << ",\"ratio\":" << String (event.ratio, 6) << "}},\n";
+    }
+}
+
+//==============================================================================
+SRCTrace::Exporter::Exporter (const File& file, TimeSliceThread& thread, const int interval)
+    : stream (file),
+      backgroundThread (thread),
+      intervalMs (interval)
+{
+    if (stream.openedOk())
+    {
+        stream.setPosition (0);
+        stream.truncate();
+        stream << "[\n";
+    }
+
+    backgroundThread.addTimeSliceClient (this);
+}
+
+SRCTrace::Exporter::~Exporter()
+{
+    backgroundThread.removeTimeSliceClient (this);
+    writePendingEvents();
+
+    // a last event without a trailing comma closes the array
+    stream << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"juce_libsamplerate\",\"dropped\":"
+           << String (getNumDropped()) << "}}\n]\n";
+    stream.flush();
+}
+
+int SRCTrace::Exporter::useTimeSlice()
+{
+    writePendingEvents();
+    return intervalMs;
+}
+
+void SRCTrace::Exporter::writePendingEvents()
+{
+    pending.clearQuick();
+
+    if (collect (pending) == 0 || ! stream.openedOk())
+        return;
+
+    // names each thread before its first span
+    for (auto& event : pending)
+    {
+        if (! namedThreads[(int) event.threadIndex])
+        {
+            namedThreads.setBit ((int) event.threadIndex);
+            stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << String (event.threadIndex)
+                   << ",\"args\":{\"name\":\"" << SRCTraceHelpers::escape (getThreadName (event.threadIndex)) << "\"}},\n";
+        }
+    }
+
+    writeChromeEvents (pending, stream);
+    numWritten += pending.size();
+    stream.flush();
+}
+
+} // namespace juce
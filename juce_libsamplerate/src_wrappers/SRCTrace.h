@@ -0,0 +1,139 @@
+/*
+ ==============================================================================
+    Copyright (c) 2019, Tal Aviram
+    All rights reserved.
+
+    This code is released under 2-clause BSD license. Please see the
+    file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#pragma once
+
+namespace juce
+{
+
+//==============================================================================
+/**
+ Trace events around the conversion calls, for finding out which stream missed a deadline.
+
+ With JUCE_LIBSAMPLERATE_TRACING enabled, SRCAudioSource records a span for every block,
+ every pull from its input and every conversion call (each src_process() call, or the
+ call into SRCSincConverter or SRCFastInterpolator), and SRCAudioTransportSource records
+ one for every block. A span carries the stream it belongs to, the frames it read and
+ wrote and the resampling ratio.
+
+ Spans are recorded into a lock-free ring per thread. The rings are allocated ahead of
+ time by reserveThreadRings(), which prepareToPlay() calls, so the first span on a thread
+ only claims a free ring, and a thread's ring is freed for another thread once the thread
+ has exited and its spans were collected. A span on a thread that finds no free ring, or
+ whose ring is full, is dropped and counted. An Exporter drains the rings on a background
+ thread and writes the spans as Chrome trace JSON, which chrome://tracing and Perfetto
+ can load.
+
+ With tracing disabled (the default) the JUCE_SRC_TRACE macros compile to nothing and no
+ spans are ever recorded.
+
+ @tags{Audio}
+ */
+class SRCTrace
+{
+public:
+    //==============================================================================
+    /** A completed span. */
+    struct Event
+    {
+        const char* name;       // must be a string literal
+        uint32 streamId;
+        uint32 threadIndex;     // a thread that recorded spans, numbered from 0
+        int64 startTicks;       // Time::getHighResolutionTicks()
+        int64 durationTicks;
+        int framesIn, framesOut;
+        double ratio;           // samples in per output sample
+    };
+
+    //==============================================================================
+    /** Records a span from its construction to its destruction. Use JUCE_SRC_TRACE_SPAN. */
+    class ScopedSpan
+    {
+    public:
+        ScopedSpan (const char* name, uint32 streamId) noexcept;
+        ~ScopedSpan();
+
+        void setFrames (int framesIn, int framesOut, double ratio) noexcept;
+
+    private:
+        Event event;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedSpan)
+    };
+
+    //==============================================================================
+    /** Writes the recorded spans to a file, draining the rings on a TimeSliceThread. */
+    class Exporter  : private TimeSliceClient
+    {
+    public:
+        /** Starts writing to the file, replacing it. The thread must outlive this object. */
+        Exporter (const File& file, TimeSliceThread& backgroundThread, int intervalMs = 250);
+
+        /** Drains the rings one last time and finishes the file. */
+        ~Exporter() override;
+
+        /** Returns the number of spans written so far. */
+        int64 getNumEventsWritten() const noexcept          { return numWritten; }
+
+    private:
+        int useTimeSlice() override;
+        void writePendingEvents();
+
+        FileOutputStream stream;
+        TimeSliceThread& backgroundThread;
+        const int intervalMs;
+        Array<Event> pending;
+        BigInteger namedThreads;
+        std::atomic<int64> numWritten { 0 };
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Exporter)
+    };
+
+    //==============================================================================
+    /** Returns a new id for a stream, to tell the spans of different streams apart. */
+    static uint32 createStreamId() noexcept;
+
+    /** Makes sure that at least numThreads rings are free for threads that haven't recorded
+        a span yet. This allocates, so call it before processing, e.g. from prepareToPlay()
+        with the number of threads that will process the blocks.
+     */
+    static void reserveThreadRings (int numThreads);
+
+    /** Records a completed span in the calling thread's ring. */
+    static void record (const Event& event) noexcept;
+
+    /** Moves every recorded span into dest, returning the number moved. */
+    static int collect (Array<Event>& dest);
+
+    /** Returns the number of spans dropped because a ring was full. */
+    static int64 getNumDropped() noexcept;
+
+    /** Returns the name of the thread a ring belongs to. */
+    static String getThreadName (uint32 threadIndex);
+
+    /** Writes spans as Chrome trace events, each followed by a comma and a new line. */
+    static void writeChromeEvents (const Array<Event>& events, OutputStream& out);
+
+private:
+    SRCTrace() = delete;
+};
+
+} // namespace juce
+
+//==============================================================================
+#if JUCE_LIBSAMPLERATE_TRACING
+ #define JUCE_SRC_TRACE_SPAN(span, name, streamId)       juce::SRCTrace::ScopedSpan span (name, streamId);
+ #define JUCE_SRC_TRACE_FRAMES(span, in, out, ratio)     span.setFrames (in, out, ratio);
+ #define JUCE_SRC_TRACE_PREPARE(numThreads)              juce::SRCTrace::reserveThreadRings (numThreads);
+#else
+ #define JUCE_SRC_TRACE_SPAN(span, name, streamId)
+ #define JUCE_SRC_TRACE_FRAMES(span, in, out, ratio)
+ #define JUCE_SRC_TRACE_PREPARE(numThreads)
+#endif
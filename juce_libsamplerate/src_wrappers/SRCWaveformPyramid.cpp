@@ -0,0 +1,452 @@
+/*
+ ==============================================================================
+ Copyright (c) 2019, Tal Aviram
+ All rights reserved.
+
+ This code is released under 2-clause BSD license. Please see the
+ file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#include "SRCWaveformPyramid.h"
+
+namespace juce
+{
+
+namespace SRCWaveformPyramidHelpers
+{
+    static const char* const fileExtension = ".srcw";
+
+    /** Header of a cache file. The bins of every level follow it, level 0 first, in the
+        same layout as in memory, so the file can be mapped and read in place.
+     */
+    struct FileHeader
+    {
+        char magic[4];
+        int32 version;
+        int32 numChannels;
+        int32 samplesPerBin;
+        int64 length;
+        int64 sourceLength;
+        int64 sourceHash;
+        double sourceSampleRate;
+        double overviewSampleRate;
+        int32 quality;
+        char reserved[4];
+
+        static FileHeader create (int numChannels, int samplesPerBin, int64 length, int64 sourceLength, int64 sourceHash,
+                                  double sourceSampleRate, double overviewSampleRate, int quality) noexcept
+        {
+            FileHeader header;
+            zerostruct (header);
+            memcpy (header.magic, "SRCw", 4);
+            header.version = currentVersion;
+            header.numChannels = numChannels;
+            header.samplesPerBin = samplesPerBin;
+            header.length = length;
+            header.sourceLength = sourceLength;
+            header.sourceHash = sourceHash;
+            header.sourceSampleRate = sourceSampleRate;
+            header.overviewSampleRate = overviewSampleRate;
+            header.quality = quality;
+            return header;
+        }
+
+        static constexpr int32 currentVersion = 1;
+    };
+
+    static_assert (sizeof (FileHeader) == 64, "The header keeps the bins aligned in the mapped file");
+
+    static void merge (SRCWaveformPyramid::Bin& bin, const SRCWaveformPyramid::Bin& other) noexcept
+    {
+        bin.minimum = jmin (bin.minimum, other.minimum);
+        bin.maximum = jmax (bin.maximum, other.maximum);
+        bin.sumOfSquares += other.sumOfSquares;
+    }
+}
+
+//==============================================================================
+SRCWaveformPyramid::SRCWaveformPyramid (PositionableAudioSource* const s,
+                                        const bool deleteSourceWhenDeleted,
+                                        const double sourceRate,
+                                        const int channels,
+                                        TimeSliceThread& thread,
+                                        const double overviewRate,
+                                        const ResamplerQuality q,
+                                        const File& file,
+                                        const int64 hash,
+                                        const int binSize)
+    : source (s, deleteSourceWhenDeleted),
+      backgroundThread (thread),
+      numChannels (jmax (1, channels)),
+      samplesPerBin (jmax (1, binSize)),
+      sourceSampleRate (sourceRate),
+      overviewSampleRate (overviewRate),
+      samplesInPerOutputSample (sourceRate / overviewRate),
+      quality (q),
+      cacheFile (file),
+      sourceHash (hash),
+      sourceLength (jmax ((int64) 0, s->getTotalLength()))
+{
+    jassert (sourceRate > 0 && overviewRate > 0);
+
+    const auto needsConversion = samplesInPerOutputSample != 1.0;
+    length = needsConversion ? (int64) std::ceil ((double) sourceLength / samplesInPerOutputSample) : sourceLength;
+
+    createLevels();
+
+    if (levels.isEmpty() || loadFromCache())
+    {
+        numSamplesDone.store (length, std::memory_order_release);
+        return;
+    }
+
+    storage.calloc (totalNumBins);
+    setLevelStorage (storage);
+    currentBin.calloc ((size_t) numChannels);
+    inputPointers.malloc ((size_t) numChannels);
+    sourceBuffer.setSize (numChannels, chunkSize);
+
+    if (needsConversion)
+    {
+        convertedBuffer.setSize (numChannels, (int) std::ceil (chunkSize / samplesInPerOutputSample) + 64);
+
+        if (SRCFastInterpolator::supportsQuality (quality))
+        {
+            fastInterpolator.reset (new SRCFastInterpolator (quality, numChannels));
+            fastInterpolator->setResamplingRatio (samplesInPerOutputSample);
+        }
+        else
+        {
+            sincConverter.reset (new SRCSincConverter (SRCCoefficientTable::getTable (quality, SRCCoefficientTable::exactHalfTable),
+                                                       numChannels, samplesInPerOutputSample));
+            sincConverter->setResamplingRatio (samplesInPerOutputSample);
+        }
+    }
+
+    backgroundThread.addTimeSliceClient (this);
+}
+
+SRCWaveformPyramid::~SRCWaveformPyramid()
+{
+    backgroundThread.removeTimeSliceClient (this);
+
+    if (started && ! isComplete())
+        source->releaseResources();
+}
+
+File SRCWaveformPyramid::getDefaultCacheFileFor (const File& assetFile)
+{
+    return assetFile.getSiblingFile (assetFile.getFileName() + SRCWaveformPyramidHelpers::fileExtension);
+}
+
+//==============================================================================
+int SRCWaveformPyramid::getColumns (const int channel, const double startSample, const double samplesPerPixel,
+                                    Column* const dest, const int numColumns) const noexcept
+{
+    for (auto i = 0; i < numColumns; ++i)
+        dest[i] = { 0.0f, 0.0f, 0.0f };
+
+    if (! isPositiveAndBelow (channel, numChannels) || samplesPerPixel <= 0 || levels.isEmpty())
+        return 0;
+
+    // the coarsest level whose bins still fit in a pixel, so a column merges two or three bins
+    auto levelIndex = 0;
+
+    while (levelIndex + 1 < levels.size() && levels.getReference (levelIndex + 1).binSize <= samplesPerPixel)
+        ++levelIndex;
+
+    const auto& level = levels.getReference (levelIndex);
+    const auto done = numSamplesDone.load (std::memory_order_acquire);
+    const auto numReady = done >= length ? level.numBins : done / level.binSize;
+    const auto binSize = (double) level.binSize;
+    auto numFilled = 0;
+
+    for (auto i = 0; i < numColumns; ++i)
+    {
+        const auto start = startSample + i * samplesPerPixel;
+        const auto first = jmax ((int64) 0, (int64) std::floor (start / binSize));
+
+        if (start + samplesPerPixel <= 0 || start >= (double) length || first >= numReady)
+            continue;
+
+        const auto end = jmin (numReady, jmax (first + 1, (int64) std::ceil ((start + samplesPerPixel) / binSize)));
+
+        auto bin = level.bins[first * numChannels + channel];
+        auto numSamples = getNumSamplesIn (level, first);
+
+        for (auto index = first + 1; index < end; ++index)
+        {
+            SRCWaveformPyramidHelpers::merge (bin, level.bins[index * numChannels + channel]);
+            numSamples += getNumSamplesIn (level, index);
+        }
+
+        dest[i] = { bin.minimum, bin.maximum, std::sqrt (bin.sumOfSquares / (float) numSamples) };
+        ++numFilled;
+    }
+
+    return numFilled;
+}
+
+double SRCWaveformPyramid::getProgress() const noexcept
+{
+    return length > 0 ? jmin (1.0, (double) numSamplesDone.load (std::memory_order_acquire) / (double) length) : 1.0;
+}
+
+//==============================================================================
+int SRCWaveformPyramid::useTimeSlice()
+{
+    if (sourcePosition < sourceLength)
+    {
+        scanChunk();
+        return 0;
+    }
+
+    finishScan();
+    return -1;
+}
+
+void SRCWaveformPyramid::scanChunk()
+{
+    if (! started)
+    {
+        source->setLooping (false);
+        source->setNextReadPosition (0);
+        source->prepareToPlay (chunkSize, sourceSampleRate);
+        started = true;
+    }
+
+    const auto numToRead = (int) jmin ((int64) chunkSize, sourceLength - sourcePosition);
+    source->getNextAudioBlock (AudioSourceChannelInfo (&sourceBuffer, 0, numToRead));
+    sourcePosition += numToRead;
+
+    if (fastInterpolator == nullptr && sincConverter == nullptr)
+    {
+        addToBins (sourceBuffer.getArrayOfReadPointers(), numToRead);
+        return;
+    }
+
+    auto used = 0;
+
+    for (;;)
+    {
+        for (auto channel = 0; channel < numChannels; ++channel)
+            inputPointers[channel] = sourceBuffer.getReadPointer (channel, used);
+
+        auto inputFramesUsed = 0;
+        const auto generated = convert (inputPointers, numToRead - used, inputFramesUsed);
+        used += inputFramesUsed;
+        addToBins (convertedBuffer.getArrayOfReadPointers(), generated);
+
+        if (generated == 0 && inputFramesUsed == 0)
+            break;
+    }
+}
+
+void SRCWaveformPyramid::finishScan()
+{
+    // the converter holds back the last half filter of input; silence pushes it out
+    if (fastInterpolator != nullptr || sincConverter != nullptr)
+    {
+        sourceBuffer.clear();
+
+        while (numSamplesAnalysed < length)
+        {
+            auto inputFramesUsed = 0;
+            const auto generated = convert (sourceBuffer.getArrayOfReadPointers(), chunkSize, inputFramesUsed);
+            addToBins (convertedBuffer.getArrayOfReadPointers(), generated);
+
+            if (generated == 0 && inputFramesUsed == 0)
+                break;
+        }
+    }
+
+    if (samplesInCurrentBin > 0)
+        for (auto channel = 0; channel < numChannels; ++channel)
+            levels.getReference (0).bins[binIndex * numChannels + channel] = currentBin[channel];
+
+    // the last bin of each level may have been waiting for a partner that never came
+    for (auto level = 1; level < levels.size(); ++level)
+        combine (level, levels.getReference (level).numBins - 1);
+
+    numSamplesDone.store (length, std::memory_order_release);
+    source->releaseResources();
+    writeToCache();
+}
+
+int SRCWaveformPyramid::convert (const float* const* input, const int numInputFrames, int& inputFramesUsed)
+{
+    auto** output = convertedBuffer.getArrayOfWritePointers();
+    const auto numOutputFrames = convertedBuffer.getNumSamples();
+
+    if (fastInterpolator != nullptr)
+        return fastInterpolator->process (input, numInputFrames, output, numOutputFrames,
+                                          samplesInPerOutputSample, inputFramesUsed);
+
+    return sincConverter->process (input, numInputFrames, output, numOutputFrames,
+                                   samplesInPerOutputSample, inputFramesUsed);
+}
+
+void SRCWaveformPyramid::addToBins (const float* const* data, int numSamples)
+{
+    numSamples = (int) jmin ((int64) numSamples, length - numSamplesAnalysed);
+    auto offset = 0;
+
+    while (offset < numSamples)
+    {
+        const auto numToDo = jmin (numSamples - offset, samplesPerBin - samplesInCurrentBin);
+
+        for (auto channel = 0; channel < numChannels; ++channel)
+        {
+            const auto* samples = data[channel] + offset;
+            const auto range = FloatVectorOperations::findMinAndMax (samples, numToDo);
+            auto sumOfSquares = 0.0f;
+
+            for (auto i = 0; i < numToDo; ++i)
+                sumOfSquares += samples[i] * samples[i];
+
+            const Bin bin = { range.getStart(), range.getEnd(), sumOfSquares };
+
+            if (samplesInCurrentBin == 0)
+                currentBin[channel] = bin;
+            else
+                SRCWaveformPyramidHelpers::merge (currentBin[channel], bin);
+        }
+
+        samplesInCurrentBin += numToDo;
+        offset += numToDo;
+
+        if (samplesInCurrentBin == samplesPerBin)
+            completeBin();
+    }
+
+    numSamplesAnalysed += numSamples;
+}
+
+void SRCWaveformPyramid::completeBin()
+{
+    for (auto channel = 0; channel < numChannels; ++channel)
+        levels.getReference (0).bins[binIndex * numChannels + channel] = currentBin[channel];
+
+    // a bin completes its parent when it's the second child, and so on up
+    auto index = binIndex;
+
+    for (auto level = 1; level < levels.size() && (index & 1) != 0; ++level)
+    {
+        index >>= 1;
+        combine (level, index);
+    }
+
+    ++binIndex;
+    samplesInCurrentBin = 0;
+
+    // the last bins of the upper levels are only settled by finishScan()
+    numSamplesDone.store (jmin (binIndex * samplesPerBin, length - 1), std::memory_order_release);
+}
+
+void SRCWaveformPyramid::combine (const int levelIndex, const int64 index) noexcept
+{
+    const auto& below = levels.getReference (levelIndex - 1);
+    const auto& level = levels.getReference (levelIndex);
+    const auto first = index * 2;
+
+    for (auto channel = 0; channel < numChannels; ++channel)
+    {
+        auto bin = below.bins[first * numChannels + channel];
+
+        if (first + 1 < below.numBins)
+            SRCWaveformPyramidHelpers::merge (bin, below.bins[(first + 1) * numChannels + channel]);
+
+        level.bins[index * numChannels + channel] = bin;
+    }
+}
+
+int64 SRCWaveformPyramid::getNumSamplesIn (const Level& level, const int64 index) const noexcept
+{
+    return jmin (level.binSize, length - index * level.binSize);
+}
+
+//==============================================================================
+void SRCWaveformPyramid::createLevels()
+{
+    if (length <= 0)
+        return;
+
+    for (auto binSize = (int64) samplesPerBin;; binSize *= 2)
+    {
+        const auto numBins = (length + binSize - 1) / binSize;
+        levels.add ({ nullptr, numBins, binSize });
+        totalNumBins += (size_t) numBins * (size_t) numChannels;
+
+        if (numBins == 1)
+            break;
+    }
+}
+
+void SRCWaveformPyramid::setLevelStorage (Bin* bins) noexcept
+{
+    for (auto& level : levels)
+    {
+        level.bins = bins;
+        bins += level.numBins * numChannels;
+    }
+}
+
+bool SRCWaveformPyramid::loadFromCache()
+{
+    using namespace SRCWaveformPyramidHelpers;
+
+    if (cacheFile == File() || ! cacheFile.existsAsFile())
+        return false;
+
+    std::unique_ptr<MemoryMappedFile> mapped (new MemoryMappedFile (cacheFile, MemoryMappedFile::readOnly));
+
+    if (mapped->getData() == nullptr || mapped->getSize() < sizeof (FileHeader) + sizeof (Bin) * totalNumBins)
+        return false;
+
+    const auto expected = FileHeader::create (numChannels, samplesPerBin, length, sourceLength, sourceHash,
+                                              sourceSampleRate, overviewSampleRate, (int) quality);
+
+    if (memcmp (mapped->getData(), &expected, sizeof (FileHeader)) != 0)
+        return false;
+
+    mappedFile = std::move (mapped);
+    setLevelStorage (static_cast<Bin*> (addBytesToPointer (mappedFile->getData(), sizeof (FileHeader))));
+    return true;
+}
+
+bool SRCWaveformPyramid::writeToCache() const
+{
+    using namespace SRCWaveformPyramidHelpers;
+
+    if (cacheFile == File() || ! cacheFile.getParentDirectory().createDirectory())
+        return false;
+
+    auto tempFile = cacheFile.withFileExtension (".tmp").getNonexistentSibling();
+
+    {
+        FileOutputStream out (tempFile);
+
+        if (out.failedToOpen())
+            return false;
+
+        const auto header = FileHeader::create (numChannels, samplesPerBin, length, sourceLength, sourceHash,
+                                                sourceSampleRate, overviewSampleRate, (int) quality);
+
+        const auto ok = out.write (&header, sizeof (header))
+                     && out.write (storage.getData(), sizeof (Bin) * totalNumBins);
+
+        out.flush();
+
+        if (! ok)
+        {
+            tempFile.deleteFile();
+            return false;
+        }
+    }
+
+    // written aside and moved, so a reader never maps a half-written file
+    return tempFile.moveFileTo (cacheFile);
+}
+
+} // namespace juce
@@ -0,0 +1,185 @@
+/*
+ ==============================================================================
+    Copyright (c) 2019, Tal Aviram
+    All rights reserved.
+
+    This code is released under 2-clause BSD license. Please see the
+    file at : https://github.com/talaviram/juce_libsamplerate/blob/master/COPYING
+ ==============================================================================
+ */
+
+#pragma once
+
+namespace juce
+{
+
+//==============================================================================
+/**
+ A multi-resolution min / max / RMS overview of a source, for drawing its waveform at
+ any zoom level without going back to the audio.
+
+ The source is scanned once, on a TimeSliceThread. It is first converted to the
+ overview's sample-rate (usually the project's rate, so overviews of assets at different
+ rates line up on the same timeline): SRC_ZERO_ORDER_HOLD and SRC_LINEAR run through
+ SRCFastInterpolator for speed, the sinc qualities through SRCSincConverter for accuracy,
+ and nothing is converted when the rates match. Level 0 of the pyramid summarises every
+ samplesPerBin samples, and each level above halves the resolution, up to a single bin.
+
+ getColumns() picks the level whose bins are just finer than a pixel, so a view costs a
+ couple of bins per pixel whatever the zoom. It can be called from any thread while the
+ scan runs; it only reads the bins that are finished.
+
+ When the scan finishes, the pyramid is written to a cache file, usually next to the
+ asset (see getDefaultCacheFileFor()). A later pyramid for the same source, rates,
+ quality and resolution memory-maps that file instead of scanning again.
+
+ @see SRCResampledAssetCache
+
+ @tags{Audio}
+ */
+class SRCWaveformPyramid  : private TimeSliceClient
+{
+public:
+    typedef libsamplerate::SRC::ResamplerQuality ResamplerQuality;
+
+    //==============================================================================
+    /** A summary of one channel over a bin of the pyramid. */
+    struct Bin
+    {
+        float minimum, maximum, sumOfSquares;
+    };
+
+    /** What getColumns() returns for each pixel. */
+    struct Column
+    {
+        float minimum, maximum, rms;
+    };
+
+    //==============================================================================
+    /** Creates a pyramid, loading it from the cache file or starting to scan the source.
+
+     @param source                   the audio to scan. It is only used on the background
+                                     thread, and shouldn't be played by anything else.
+     @param deleteSourceWhenDeleted  if true, the source is deleted with this object
+     @param sourceSampleRate         the sample-rate of the source
+     @param numChannels              the number of channels to summarise
+     @param backgroundThread         the thread that scans. It must not be deleted while
+                                     this object uses it.
+     @param overviewSampleRate       the sample-rate the overview is laid out in
+     @param quality                  quality / type of sample rate conversion
+     @param cacheFile                where the finished pyramid is kept. If this is File(),
+                                     it isn't kept.
+     @param sourceHash               a hash of the source content (or its size and
+                                     modification time), to tell a stale cache file apart
+     @param samplesPerBin            the resolution of level 0, in samples at the overview
+                                     rate
+     */
+    SRCWaveformPyramid (PositionableAudioSource* source,
+                        bool deleteSourceWhenDeleted,
+                        double sourceSampleRate,
+                        int numChannels,
+                        TimeSliceThread& backgroundThread,
+                        double overviewSampleRate,
+                        ResamplerQuality quality = ResamplerQuality::SRC_ZERO_ORDER_HOLD,
+                        const File& cacheFile = File(),
+                        int64 sourceHash = 0,
+                        int samplesPerBin = 256);
+
+    /** Destructor. Stops the scan if it's still running. */
+    ~SRCWaveformPyramid() override;
+
+    /** Returns the cache file kept next to an asset. */
+    static File getDefaultCacheFileFor (const File& assetFile);
+
+    //==============================================================================
+    /** Summarises a range of a channel, one column per pixel.
+
+     Columns that aren't scanned yet (or lie outside the source) are cleared.
+
+     @param channel          the channel to summarise
+     @param startSample      the position of the first pixel, in samples at the overview rate
+     @param samplesPerPixel  the zoom level
+     @param dest             receives numColumns columns
+     @param numColumns       the number of pixels
+     @returns the number of columns filled from the audio
+     */
+    int getColumns (int channel, double startSample, double samplesPerPixel,
+                    Column* dest, int numColumns) const noexcept;
+
+    //==============================================================================
+    /** Returns true once the whole source has been summarised. */
+    bool isComplete() const noexcept                        { return numSamplesDone.load (std::memory_order_acquire) >= length; }
+
+    /** Returns how much of the source has been summarised, between 0 and 1. */
+    double getProgress() const noexcept;
+
+    /** Returns true if the pyramid came from the cache file rather than a scan. */
+    bool wasLoadedFromCache() const noexcept                { return mappedFile != nullptr; }
+
+    /** Returns the length of the overview, in samples at the overview rate. */
+    int64 getLength() const noexcept                        { return length; }
+
+    /** Returns the sample-rate the overview is laid out in. */
+    double getSampleRate() const noexcept                   { return overviewSampleRate; }
+
+    /** Returns the number of channels summarised. */
+    int getNumChannels() const noexcept                     { return numChannels; }
+
+    /** Returns the number of levels, from samplesPerBin up to a single bin. */
+    int getNumLevels() const noexcept                       { return levels.size(); }
+
+private:
+    //==============================================================================
+    struct Level
+    {
+        Bin* bins;          // numBins * numChannels, channels interleaved
+        int64 numBins;
+        int64 binSize;
+    };
+
+    enum { chunkSize = 16384 };
+
+    int useTimeSlice() override;
+    void scanChunk();
+    void finishScan();
+    int convert (const float* const* input, int numInputFrames, int& inputFramesUsed);
+    void addToBins (const float* const* data, int numSamples);
+    void completeBin();
+    void combine (int level, int64 index) noexcept;
+    int64 getNumSamplesIn (const Level&, int64 index) const noexcept;
+
+    void createLevels();
+    void setLevelStorage (Bin* bins) noexcept;
+    bool loadFromCache();
+    bool writeToCache() const;
+
+    //==============================================================================
+    OptionalScopedPointer<PositionableAudioSource> source;
+    TimeSliceThread& backgroundThread;
+    const int numChannels, samplesPerBin;
+    const double sourceSampleRate, overviewSampleRate, samplesInPerOutputSample;
+    const ResamplerQuality quality;
+    const File cacheFile;
+    const int64 sourceHash, sourceLength;
+    int64 length = 0;
+
+    Array<Level> levels;
+    HeapBlock<Bin> storage;
+    std::unique_ptr<MemoryMappedFile> mappedFile;
+    size_t totalNumBins = 0;
+
+    std::unique_ptr<SRCSincConverter> sincConverter;
+    std::unique_ptr<SRCFastInterpolator> fastInterpolator;
+    AudioBuffer<float> sourceBuffer, convertedBuffer;
+    HeapBlock<const float*> inputPointers;
+
+    bool started = false;
+    int64 sourcePosition = 0, numSamplesAnalysed = 0, binIndex = 0;
+    int samplesInCurrentBin = 0;
+    HeapBlock<Bin> currentBin;
+    std::atomic<int64> numSamplesDone { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SRCWaveformPyramid)
+};
+
+} // namespace juce
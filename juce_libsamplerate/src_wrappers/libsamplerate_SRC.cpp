@@ -1,6 +1,10 @@
 
 #include "libsamplerate_SRC.h"
 
+// included here first, so the sources' own #include <stdlib.h> doesn't bring the global
+// calloc() and free() into the namespace below
+#include <stdlib.h>
+
 namespace libsamplerate {
 
     /* Name of package */
@@ -60,12 +64,101 @@ namespace libsamplerate {
     /* The size of `long', as computed by sizeof. */
 #define SIZEOF_LONG __SIZEOF_LONG__
 
+    // libsamplerate's unqualified calloc() and free() calls find these before the global
+    // ones, so its converter state goes through SRCArena and can be placed in an arena
+    static void* calloc (size_t numElements, size_t elementSize) noexcept   { return juce::SRCArena::callocHook (numElements, elementSize); }
+    static void free (void* pointer) noexcept                               { juce::SRCArena::freeHook (pointer); }
+
 #include "../libsamplerate/src/src_linear.c"
 #include "../libsamplerate/src/src_zoh.c"
 #include "../libsamplerate/src/src_sinc.c"
 #include "../libsamplerate/src/samplerate.c"
 
-int SRC::resample (const juce::AudioBuffer<float>& bufferToResample, juce::AudioBuffer<float>& outputBuffer, const double samplesInPerOutputSample, const ResamplerQuality converter_type)
+static int resampleWithFastInterpolator (const juce::AudioBuffer<float>& bufferToResample, juce::AudioBuffer<float>& outputBuffer,
+                                         const double samplesInPerOutputSample, const SRC::ResamplerQuality converter_type)
+{
+    const auto numChannels = juce::jmin (bufferToResample.getNumChannels(), outputBuffer.getNumChannels());
+    const auto numOutputFrames = outputBuffer.getNumSamples();
+
+    juce::SRCFastInterpolator interpolator (converter_type, numChannels);
+    interpolator.setResamplingRatio (samplesInPerOutputSample);
+
+    int inputFramesUsed = 0;
+    auto generated = interpolator.process (bufferToResample.getArrayOfReadPointers(), bufferToResample.getNumSamples(),
+                                           outputBuffer.getArrayOfWritePointers(), numOutputFrames,
+                                           samplesInPerOutputSample, inputFramesUsed);
+
+    // like src_simple() at the end of input, the last outputs are interpolated towards silence
+    juce::HeapBlock<const float*> silence ((size_t) numChannels);
+    juce::HeapBlock<float*> remaining ((size_t) numChannels);
+    const float zero = 0.0f;
+
+    for (auto channel = 0; channel < numChannels; ++channel)
+        silence[channel] = &zero;
+
+    while (generated < numOutputFrames)
+    {
+        for (auto channel = 0; channel < numChannels; ++channel)
+            remaining[channel] = outputBuffer.getWritePointer (channel, generated);
+
+        const auto flushed = interpolator.process (silence, 1, remaining, numOutputFrames - generated,
+                                                   samplesInPerOutputSample, inputFramesUsed);
+
+        if (flushed == 0)
+            break;
+
+        generated += flushed;
+    }
+
+    for (auto channel = 0; channel < numChannels; ++channel)
+        juce::FloatVectorOperations::clear (outputBuffer.getWritePointer (channel, generated), numOutputFrames - generated);
+
+    return 0;
+}
+
+static int resampleWithMultistage (const juce::AudioBuffer<float>& bufferToResample, juce::AudioBuffer<float>& outputBuffer,
+                                   const double samplesInPerOutputSample, const SRC::ResamplerQuality converter_type)
+{
+    const auto numChannels = juce::jmin (bufferToResample.getNumChannels(), outputBuffer.getNumChannels());
+    const auto numOutputFrames = outputBuffer.getNumSamples();
+
+    // the delay of the half-band stages is taken out, so the output lines up as with src_simple()
+    juce::SRCMultistageConverter converter (converter_type, numChannels, samplesInPerOutputSample);
+    converter.setCompensatesLatency (true);
+    converter.reset();
+
+    int inputFramesUsed = 0;
+    auto generated = converter.process (bufferToResample.getArrayOfReadPointers(), bufferToResample.getNumSamples(),
+                                        outputBuffer.getArrayOfWritePointers(), numOutputFrames,
+                                        samplesInPerOutputSample, inputFramesUsed);
+
+    // then silence flushes out the filters' tails, like src_simple() at the end of input
+    juce::AudioBuffer<float> silence (numChannels, 1024);
+    silence.clear();
+    juce::HeapBlock<float*> remaining ((size_t) numChannels);
+
+    while (generated < numOutputFrames)
+    {
+        for (auto channel = 0; channel < numChannels; ++channel)
+            remaining[channel] = outputBuffer.getWritePointer (channel, generated);
+
+        const auto flushed = converter.process (silence.getArrayOfReadPointers(), silence.getNumSamples(), remaining,
+                                                numOutputFrames - generated, samplesInPerOutputSample, inputFramesUsed);
+
+        if (flushed == 0 && inputFramesUsed == 0)
+            break;
+
+        generated += flushed;
+    }
+
+    for (auto channel = 0; channel < numChannels; ++channel)
+        juce::FloatVectorOperations::clear (outputBuffer.getWritePointer (channel, generated), numOutputFrames - generated);
+
+    return 0;
+}
+
+int SRC::resample (const juce::AudioBuffer<float>& bufferToResample, juce::AudioBuffer<float>& outputBuffer, const double samplesInPerOutputSample, const ResamplerQuality converter_type,
+                   const bool useMultistage)
 {
     jassert (bufferToResample.getNumChannels() > 0 && outputBuffer.getNumChannels() >= bufferToResample.getNumChannels());
 
@@ -76,6 +169,12 @@ int SRC::resample (const juce::AudioBuffer<float>& bufferToResample, juce::Audio
         return 0;
     }
 
+    if (useMultistage && juce::SRCMultistageConverter::getNumStagesFor (samplesInPerOutputSample) > 0)
+        return resampleWithMultistage (bufferToResample, outputBuffer, samplesInPerOutputSample, converter_type);
+
+    if (juce::SRCFastInterpolator::supportsQuality (converter_type))
+        return resampleWithFastInterpolator (bufferToResample, outputBuffer, samplesInPerOutputSample, converter_type);
+
     SRC_DATA data;
     data.data_in = bufferToResample.getReadPointer (0);
     data.input_frames = bufferToResample.getNumSamples();
@@ -36,8 +36,12 @@ public:
     //==============================================================================
     /** Resamples an audio buffer.
      Important Note: This callback is not designed to work on small chunks of a larger piece of audio. If you attempt to use it this way you are doing it wrong and will not get the results you want.
-      @see SRCAudioSource
+
+     With useMultistage, ratios of 2 or more (either way) go through SRCMultistageConverter,
+     and its latency is removed from the output to within a fraction of a sample.
+      @see SRCAudioSource, SRCMultistageConverter
      */
-    static int resample (const juce::AudioBuffer<float>& bufferToResample, juce::AudioBuffer<float>& outputBuffer, double samplesInPerOutputSample, ResamplerQuality converter_type);
+    static int resample (const juce::AudioBuffer<float>& bufferToResample, juce::AudioBuffer<float>& outputBuffer, double samplesInPerOutputSample, ResamplerQuality converter_type,
+                         bool useMultistage = false);
 };
 }